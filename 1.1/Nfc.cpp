@@ -133,9 +133,10 @@ Return<V1_0::NfcStatus> Nfc::closeForPowerOffCase() {
 }
 
 Return<void> Nfc::getConfig(getConfig_cb hidl_cb) {
-  NfcConfig nfcVendorConfig;
-  phNxpNciHal_getVendorConfig(nfcVendorConfig);
-  hidl_cb(nfcVendorConfig);
+  /* serialized straight from the cached config */
+  std::shared_ptr<const NfcConfig> pNfcVendorConfig =
+      phNxpNciHal_getVendorConfigCached();
+  hidl_cb(*pNfcVendorConfig);
   return Void();
 }
 
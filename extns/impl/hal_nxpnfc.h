@@ -29,6 +29,15 @@ enum {
     HAL_NFC_ENABLE_I2C_FRAGMENTATION_EVT = 0x08,
     HAL_NFC_POST_MIN_INIT_CPLT_EVT       = 0x09
 };
+/*
+ * ioctl codes handled by this HAL in addition to the hal_nxpese.h ones,
+ * numbered past them
+ */
+enum {
+    HAL_NFC_IOCTL_GET_LATENCY_STATS = 0x1000,
+    HAL_NFC_IOCTL_GET_CONFIG_CHANGES,
+    HAL_NFC_IOCTL_GET_FW_DNLD_STATS
+};
 /*
  * Data structures provided below are used of Hal Ioctl calls
  */
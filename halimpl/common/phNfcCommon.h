@@ -173,8 +173,13 @@ typedef enum {
  **Timer Handle structure containing details of a timer.
  */
 typedef struct phOsalNfc_TimerHandle {
-  uint32_t TimerId;     /* ID of the timer */
-  timer_t hTimerHandle; /* Handle of the timer */
+  uint32_t TimerId; /* ID of the timer */
+  /* Expiry time, in ms of CLOCK_MONOTONIC, while linked in the timer wheel */
+  uint64_t qwExpiryTick;
+  /* Timer wheel slot list links */
+  struct phOsalNfc_TimerHandle* pNext;
+  struct phOsalNfc_TimerHandle* pPrev;
+  struct phOsalNfc_TimerHandle** ppSlot;
   /* Timer callback function to be invoked */
   pphOsalNfc_TimerCallbck_t Application_callback;
   void* pContext; /* Parameter to be passed to the callback function */
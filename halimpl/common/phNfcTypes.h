@@ -75,6 +75,7 @@ typedef enum {
   ENUM_LINK_TYPE_SPI,
   ENUM_LINK_TYPE_USB,
   ENUM_LINK_TYPE_TCP,
+  ENUM_LINK_TYPE_SIM, /* In-process NFCC simulator, see phTmlNfc_sim */
   ENUM_LINK_TYPE_NB
 } phLibNfc_eConfigLinkType;
 
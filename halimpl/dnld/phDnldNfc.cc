@@ -20,6 +20,7 @@
  */
 
 #include <phDnldNfc_Internal.h>
+#include <phDnldNfc_Img.h>
 #include <phTmlNfc.h>
 #include <phNxpLog.h>
 #include <dlfcn.h>
@@ -31,6 +32,7 @@ uint16_t wMwVer = 0; /* Middleware version no */
 uint16_t wFwVer = 0; /* Firmware version no */
 uint8_t gRecFWDwnld; /* flag set to true to indicate dummy FW download */
 static pphDnldNfc_DlContext_t gpphDnldContext = NULL; /* Download contex */
+static bool_t phDnldNfc_IsPipelined(void);
 #undef EEPROM_Read_Mem_IMP
 
 /*******************************************************************************
@@ -419,6 +421,16 @@ NFCSTATUS phDnldNfc_Write(bool_t bRecoverSeq, pphDnldNfc_Buff_t pData,
         (gpphDnldContext->tUserData.pBuff) = pImgPtr;
         (gpphDnldContext->tUserData.wLen) = wLen;
         (gpphDnldContext->bResendLastFrame) = false;
+        (gpphDnldContext->bPipelined) = phDnldNfc_IsPipelined();
+        memset(&(gpphDnldContext->tBusyInfo), 0,
+               sizeof(gpphDnldContext->tBusyInfo));
+        if (NULL != pData) {
+          (gpphDnldContext->tBusyInfo.tSeqType) = phDnldNfc_SeqUser;
+        } else if (true == bRecoverSeq) {
+          (gpphDnldContext->tBusyInfo.tSeqType) = phDnldNfc_SeqRecovery;
+        } else {
+          (gpphDnldContext->tBusyInfo.tSeqType) = phDnldNfc_SeqFw;
+        }
 
         memset(&(gpphDnldContext->tRWInfo), 0,
                sizeof(gpphDnldContext->tRWInfo));
@@ -793,6 +805,12 @@ NFCSTATUS phDnldNfc_InitImgInfo(void) {
       wFwVer = (((uint16_t)(gpphDnldContext->nxp_nfc_fw[5]) << 8U) |
                 (gpphDnldContext->nxp_nfc_fw[4]));
       wStatus = NFCSTATUS_SUCCESS;
+
+      if (NFCSTATUS_SUCCESS !=
+          phDnldNfc_PrepareImgTxFrames(gpphDnldContext->nxp_nfc_fw,
+                                       gpphDnldContext->nxp_nfc_fw_len)) {
+        NXPLOG_FWDNLD_W("FW write frames not prepared");
+      }
     } else {
       NXPLOG_FWDNLD_E("Image details extraction Failed!!");
       wStatus = NFCSTATUS_FAILED;
@@ -851,6 +869,12 @@ NFCSTATUS phDnldNfc_LoadRecInfo(void) {
       NXPLOG_FWDNLD_D("Recovery Image Length - %d", ImageInfoLen);
       NXPLOG_FWDNLD_D("Recovery Image Info Pointer - %p", pImageInfo);
       wStatus = NFCSTATUS_SUCCESS;
+
+      if (NFCSTATUS_SUCCESS !=
+          phDnldNfc_PrepareImgTxFrames(gpphDnldContext->nxp_nfc_fwp,
+                                       gpphDnldContext->nxp_nfc_fwp_len)) {
+        NXPLOG_FWDNLD_W("Recovery write frames not prepared");
+      }
     } else {
       NXPLOG_FWDNLD_E("Recovery Image details extraction Failed!!");
       wStatus = NFCSTATUS_FAILED;
@@ -911,6 +935,12 @@ NFCSTATUS phDnldNfc_LoadPKInfo(void) {
       NXPLOG_FWDNLD_D("PKU Image Length - %d", ImageInfoLen);
       NXPLOG_FWDNLD_D("PKU Image Info Pointer - %p", pImageInfo);
       wStatus = NFCSTATUS_SUCCESS;
+
+      if (NFCSTATUS_SUCCESS !=
+          phDnldNfc_PrepareImgTxFrames(gpphDnldContext->nxp_nfc_fwp,
+                                       gpphDnldContext->nxp_nfc_fwp_len)) {
+        NXPLOG_FWDNLD_W("PKU write frames not prepared");
+      }
     } else {
       NXPLOG_FWDNLD_E("PKU Image details extraction Failed!!");
       wStatus = NFCSTATUS_FAILED;
@@ -975,10 +1005,14 @@ NFCSTATUS phDnldNfc_LoadFW(const char* pathName, uint8_t** pImgInfo,
       }
   }
 
-  /* check if the handle is not NULL then free the library */
-  if (pFwLibHandle != NULL) {
-    phDnldNfc_UnloadFW();
-    pFwLibHandle = NULL;
+  /* free the previously loaded image, library or container */
+  (void)phDnldNfc_UnloadFW();
+
+  /* map the flat image container when one is installed, it needs neither
+   * dynamic linking nor relocation */
+  if (NFCSTATUS_SUCCESS ==
+      phDnldNfc_MapImg(pathName, phDnldNfc_ImgSectFw, pImgInfo, pImgInfoLen)) {
+    return NFCSTATUS_SUCCESS;
   }
 
   /* load the DLL file */
@@ -1048,10 +1082,12 @@ NFCSTATUS phDnldNfc_LoadRecoveryFW(const char* pathName, uint8_t** pImgInfo,
           pathName = "/system/vendor/lib/libpn547_fw.so";
       }
   }
-  /* check if the handle is not NULL then free the library */
-  if (pFwLibHandle != NULL) {
-    phDnldNfc_UnloadFW();
-    pFwLibHandle = NULL;
+  /* free the previously loaded image, library or container */
+  (void)phDnldNfc_UnloadFW();
+  /* map the flat image container when one is installed */
+  if (NFCSTATUS_SUCCESS == phDnldNfc_MapImg(pathName, phDnldNfc_ImgSectDummy,
+                                            pImgInfo, pImgInfoLen)) {
+    return NFCSTATUS_SUCCESS;
   }
   /* load the DLL file */
   pFwLibHandle = dlopen(pathName, RTLD_LAZY);
@@ -1100,6 +1136,11 @@ NFCSTATUS phDnldNfc_UnloadFW(void) {
   NFCSTATUS wStatus = NFCSTATUS_SUCCESS;
   int32_t status;
 
+  /* release the frames prepared from the image and unmap the image
+   * container if the image was taken from it */
+  phDnldNfc_ReleaseImgTxFrames();
+  phDnldNfc_UnmapImg();
+
   /* check if the handle is not NULL then free the library */
   if (pFwLibHandle != NULL) {
     status = dlclose(pFwLibHandle);
@@ -1115,6 +1156,27 @@ NFCSTATUS phDnldNfc_UnloadFW(void) {
   return wStatus;
 }
 
+/*******************************************************************************
+**
+** Function         phDnldNfc_IsPipelined
+**
+** Description      Checks whether write frames are to be pipelined, as per
+**                  NXP_FW_DNLD_PIPELINE. Disabled if not configured.
+**
+** Parameters       None
+**
+** Returns          true if pipelined
+**
+*******************************************************************************/
+static bool_t phDnldNfc_IsPipelined(void) {
+  unsigned long num = 0;
+
+  if (!GetNxpNumValue(NAME_NXP_FW_DNLD_PIPELINE, &num, sizeof(num))) {
+    num = 0;
+  }
+  return (0 != num) ? true : false;
+}
+
 #ifdef EEPROM_Read_Mem_IMP
 static pphDnldNfc_RspCb_t UserCb; /* Upper layer call back function */
 static void* UserCtxt;            /* Pointer to upper layer context */
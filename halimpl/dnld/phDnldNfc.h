@@ -138,4 +138,5 @@ extern NFCSTATUS phDnldNfc_LoadRecoveryFW(const char* pathName,
                                           uint8_t** pImgInfo,
                                           uint16_t* pImgInfoLen);
 extern NFCSTATUS phDnldNfc_UnloadFW(void);
+extern NFCSTATUS phDnldNfc_GetBusyStats(uint8_t* pBuff, uint16_t* pLen);
 #endif /* PHDNLDNFC_H */
@@ -0,0 +1,537 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Download Component
+ * Flat firmware image container routines implementation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <phDnldNfc_Img.h>
+#include <phDnldNfc_Internal.h>
+#include <phDnldNfc_Utils.h>
+#include <phNxpLog.h>
+#include <Nxp_Features.h>
+#include "sparse_crc32.h"
+
+#define PHDNLDNFC_IMG_LIB_SUFFIX ".so"
+#define PHDNLDNFC_IMG_SUFFIX ".bin"
+
+static uint8_t* pImgMap = NULL; /* Mapping of the loaded container */
+static size_t dwImgMapLen = 0;  /* Length of the mapping */
+static const phDnldNfc_ImgSect_t* pImgSect =
+    NULL; /* Section handed out by the last phDnldNfc_MapImg */
+static const uint8_t* pTxImg = NULL; /* Sequence the frames are prepared for */
+static uint8_t* pTxBuff = NULL;      /* Prepared frames */
+static phDnldNfc_ImgTxFrame_t* pTxFrames = NULL; /* Index of pTxBuff */
+static uint32_t dwNbTxFrames = 0;  /* Number of entries in pTxFrames */
+static uint32_t dwTxFrameIdx = 0;  /* Entry returned by the last lookup */
+
+static bool phDnldNfc_GetImgPath(const char* pathName, char* pImgPath,
+                                 size_t wImgPathLen);
+static const phDnldNfc_ImgSect_t* phDnldNfc_FindImgSect(
+    phDnldNfc_ImgSectType_t eType);
+static NFCSTATUS phDnldNfc_CheckImgSect(const phDnldNfc_ImgSect_t* pSect);
+static uint16_t phDnldNfc_AddImgTxFrame(uint8_t* pFrame, uint16_t wHdr,
+                                        const uint8_t* pPld, uint16_t wPldLen,
+                                        const uint16_t* pCrc);
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_MapImg
+**
+** Description      Maps the image container installed next to the given
+**                  firmware library and extracts the requested download
+**                  sequence from it. The container stays mapped until
+**                  phDnldNfc_UnmapImg is called.
+**
+** Parameters       pathName    - Firmware library path
+**                  eType       - Section to extract
+**                  pImgInfo    - Firmware image handle
+**                  pImgInfoLen - Firmware image length
+**
+** Returns          NFC status:
+**                  NFCSTATUS_SUCCESS - sequence extracted from the container
+**                  NFCSTATUS_FAILED - no usable container, the library
+**                                     shall be loaded instead
+**
+*******************************************************************************/
+NFCSTATUS phDnldNfc_MapImg(const char* pathName, phDnldNfc_ImgSectType_t eType,
+                           uint8_t** pImgInfo, uint16_t* pImgInfoLen) {
+  char imgPath[256];
+  const phDnldNfc_ImgHdr_t* pHdr;
+  const phDnldNfc_ImgSect_t* pSect;
+  struct stat st;
+  void* pMap;
+  int fd;
+
+  if ((NULL == pathName) || (NULL == pImgInfo) || (NULL == pImgInfoLen)) {
+    return NFCSTATUS_FAILED;
+  }
+  if (!phDnldNfc_GetImgPath(pathName, imgPath, sizeof(imgPath))) {
+    return NFCSTATUS_FAILED;
+  }
+
+  phDnldNfc_UnmapImg();
+
+  fd = open(imgPath, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno != ENOENT) {
+      NXPLOG_FWDNLD_E("Unable to open %s: %s", imgPath, strerror(errno));
+    }
+    return NFCSTATUS_FAILED;
+  }
+  if ((fstat(fd, &st) != 0) ||
+      (st.st_size < (off_t)sizeof(phDnldNfc_ImgHdr_t))) {
+    NXPLOG_FWDNLD_E("Invalid image container %s", imgPath);
+    close(fd);
+    return NFCSTATUS_FAILED;
+  }
+  pMap = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (pMap == MAP_FAILED) {
+    NXPLOG_FWDNLD_E("Unable to map %s: %s", imgPath, strerror(errno));
+    return NFCSTATUS_FAILED;
+  }
+  pImgMap = (uint8_t*)pMap;
+  dwImgMapLen = (size_t)st.st_size;
+
+  pHdr = (const phDnldNfc_ImgHdr_t*)pImgMap;
+  if ((pHdr->dwMagic != PHDNLDNFC_IMG_MAGIC) ||
+      (pHdr->wFormatVer != PHDNLDNFC_IMG_FORMAT_VER) ||
+      (pHdr->dwImgLen != dwImgMapLen) ||
+      (((size_t)pHdr->wNbSections * sizeof(phDnldNfc_ImgSect_t)) >
+       (dwImgMapLen - sizeof(phDnldNfc_ImgHdr_t)))) {
+    NXPLOG_FWDNLD_E("Invalid image container header in %s", imgPath);
+    phDnldNfc_UnmapImg();
+    return NFCSTATUS_FAILED;
+  }
+  if (pHdr->wChipType != (uint16_t)nfcFL.chipType) {
+    NXPLOG_FWDNLD_E("Image container %s built for chip type %d, expected %d",
+                    imgPath, pHdr->wChipType, nfcFL.chipType);
+    phDnldNfc_UnmapImg();
+    return NFCSTATUS_FAILED;
+  }
+  if (pHdr->dwImgCrc32 !=
+      sparse_crc32(0, pImgMap + sizeof(phDnldNfc_ImgHdr_t),
+                   dwImgMapLen - sizeof(phDnldNfc_ImgHdr_t))) {
+    NXPLOG_FWDNLD_E("Image container %s checksum mismatch", imgPath);
+    phDnldNfc_UnmapImg();
+    return NFCSTATUS_FAILED;
+  }
+
+  pSect = phDnldNfc_FindImgSect(eType);
+  if ((NULL == pSect) || (NFCSTATUS_SUCCESS != phDnldNfc_CheckImgSect(pSect))) {
+    NXPLOG_FWDNLD_E("No valid section %d in image container %s", eType,
+                    imgPath);
+    phDnldNfc_UnmapImg();
+    return NFCSTATUS_FAILED;
+  }
+
+  /* the whole sequence is about to be sent, read it ahead */
+  madvise(pImgMap, dwImgMapLen, MADV_WILLNEED);
+
+  pImgSect = pSect;
+  (*pImgInfo) = pImgMap + pSect->dwDataOffset;
+  (*pImgInfoLen) = (uint16_t)pSect->dwDataLen;
+  NXPLOG_FWDNLD_D("Mapped %s section %d FW version %04x, %d frames", imgPath,
+                  eType, pSect->wFwVer, pSect->dwNbFrames);
+
+  return NFCSTATUS_SUCCESS;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_UnmapImg
+**
+** Description      Unmaps the image container mapped by phDnldNfc_MapImg, if
+**                  any. The sequence handed out becomes invalid.
+**
+** Parameters       None
+**
+** Returns          None
+**
+*******************************************************************************/
+void phDnldNfc_UnmapImg(void) {
+  if (NULL != pImgMap) {
+    munmap(pImgMap, dwImgMapLen);
+    pImgMap = NULL;
+    dwImgMapLen = 0;
+    pImgSect = NULL;
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_GetImgFrames
+**
+** Description      Gets the frame table of a download sequence extracted from
+**                  the mapped image container
+**
+** Parameters       pImgInfo  - Firmware image handle
+**                  pNbFrames - Number of entries in the frame table
+**
+** Returns          Frame table, NULL when the sequence does not come from
+**                  the mapped container (e.g. loaded from the library)
+**
+*******************************************************************************/
+const phDnldNfc_ImgFrame_t* phDnldNfc_GetImgFrames(const uint8_t* pImgInfo,
+                                                   uint32_t* pNbFrames) {
+  if ((NULL == pImgSect) || (NULL == pImgInfo) ||
+      (pImgInfo != (pImgMap + pImgSect->dwDataOffset))) {
+    return NULL;
+  }
+  if (NULL != pNbFrames) {
+    (*pNbFrames) = pImgSect->dwNbFrames;
+  }
+  return (const phDnldNfc_ImgFrame_t*)(pImgMap + pImgSect->dwFrameOffset);
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_PrepareImgTxFrames
+**
+** Description      Walks a download sequence once and prepares all its write
+**                  frames, chunks of the segmented ones included, with their
+**                  header and CRC as sent by phDnldNfc_Write. The CRCs of the
+**                  container frame table are used when the sequence comes
+**                  from the mapped container. The frames previously prepared
+**                  are released.
+**
+** Parameters       pImgInfo    - Firmware image handle
+**                  wImgInfoLen - Firmware image length
+**
+** Returns          NFC status
+**
+*******************************************************************************/
+NFCSTATUS phDnldNfc_PrepareImgTxFrames(const uint8_t* pImgInfo,
+                                       uint16_t wImgInfoLen) {
+  const phDnldNfc_ImgFrame_t* pImgFrames;
+  uint32_t dwNbImgFrames = 0;
+  uint32_t dwBuffLen = 0;
+  uint32_t dwNbFrames = 0;
+  uint32_t dwFrame = 0;
+  uint32_t dwOffset;
+  uint16_t wLen, wRemLen, wChunkLen;
+  uint8_t* pFrame;
+
+  phDnldNfc_ReleaseImgTxFrames();
+  if ((NULL == pImgInfo) || (0 == wImgInfoLen)) {
+    return NFCSTATUS_FAILED;
+  }
+
+  /* size the frames and the index */
+  for (dwOffset = 0; dwOffset < wImgInfoLen;
+       dwOffset += PHDNLDNFC_FRAME_HDR_LEN + wLen) {
+    if ((wImgInfoLen - dwOffset) < PHDNLDNFC_FRAME_HDR_LEN) {
+      return NFCSTATUS_FAILED;
+    }
+    wLen = ((uint16_t)pImgInfo[dwOffset] << 8U) | pImgInfo[dwOffset + 1];
+    if ((0 == wLen) ||
+        ((wImgInfoLen - dwOffset - PHDNLDNFC_FRAME_HDR_LEN) < wLen)) {
+      return NFCSTATUS_FAILED;
+    }
+    if (wLen <= PHDNLDNFC_CMDRESP_MAX_PLD_SIZE) {
+      dwNbFrames++;
+    } else {
+      dwNbFrames += (wLen + PHDNLDNFC_CMDRESP_MAX_PLD_SIZE - 1) /
+                    PHDNLDNFC_CMDRESP_MAX_PLD_SIZE;
+    }
+  }
+  dwBuffLen = wImgInfoLen + (dwNbFrames * (PHDNLDNFC_FRAME_HDR_LEN +
+                                           PHDNLDNFC_FRAME_CRC_LEN));
+
+  pTxBuff = (uint8_t*)malloc(dwBuffLen);
+  pTxFrames = (phDnldNfc_ImgTxFrame_t*)calloc(dwNbFrames,
+                                              sizeof(phDnldNfc_ImgTxFrame_t));
+  if ((NULL == pTxBuff) || (NULL == pTxFrames)) {
+    NXPLOG_FWDNLD_E("Unable to allocate %d prepared frames", dwNbFrames);
+    phDnldNfc_ReleaseImgTxFrames();
+    return NFCSTATUS_INSUFFICIENT_RESOURCES;
+  }
+
+  pImgFrames = phDnldNfc_GetImgFrames(pImgInfo, &dwNbImgFrames);
+  pFrame = pTxBuff;
+  for (dwOffset = 0; dwOffset < wImgInfoLen;
+       dwOffset += PHDNLDNFC_FRAME_HDR_LEN + wLen) {
+    wLen = ((uint16_t)pImgInfo[dwOffset] << 8U) | pImgInfo[dwOffset + 1];
+    if (wLen <= PHDNLDNFC_CMDRESP_MAX_PLD_SIZE) {
+      /* sent as is, its CRC may be known from the container */
+      pTxFrames[dwNbTxFrames].pFrame = pFrame;
+      pTxFrames[dwNbTxFrames].wOffset = (uint16_t)dwOffset;
+      pTxFrames[dwNbTxFrames].wPldLen = PHDNLDNFC_FRAME_HDR_LEN + wLen;
+      pTxFrames[dwNbTxFrames].wFrameLen = phDnldNfc_AddImgTxFrame(
+          pFrame, wLen, &pImgInfo[dwOffset + PHDNLDNFC_FRAME_HDR_LEN], wLen,
+          ((NULL != pImgFrames) && (dwFrame < dwNbImgFrames))
+              ? &pImgFrames[dwFrame].wCrc
+              : NULL);
+      pFrame += pTxFrames[dwNbTxFrames].wFrameLen;
+      dwNbTxFrames++;
+    } else {
+      /* sent in chunks, the header of all but the last one has the chunk
+       * bit set and the first one is sent at the offset of the frame */
+      for (wRemLen = wLen; wRemLen > 0; wRemLen -= wChunkLen) {
+        wChunkLen = (wRemLen > PHDNLDNFC_CMDRESP_MAX_PLD_SIZE)
+                        ? PHDNLDNFC_CMDRESP_MAX_PLD_SIZE
+                        : wRemLen;
+        pTxFrames[dwNbTxFrames].pFrame = pFrame;
+        pTxFrames[dwNbTxFrames].wOffset =
+            (uint16_t)(dwOffset +
+                       ((wRemLen == wLen)
+                            ? 0
+                            : (PHDNLDNFC_FRAME_HDR_LEN + wLen - wRemLen)));
+        pTxFrames[dwNbTxFrames].wPldLen = wChunkLen;
+        pTxFrames[dwNbTxFrames].wChunkedLen = wLen;
+        pTxFrames[dwNbTxFrames].bFirstChunk = (wRemLen == wLen);
+        pTxFrames[dwNbTxFrames].bLastChunk = (wRemLen == wChunkLen);
+        pTxFrames[dwNbTxFrames].wFrameLen = phDnldNfc_AddImgTxFrame(
+            pFrame,
+            (uint16_t)((wRemLen == wChunkLen) ? wChunkLen
+                                              : (wChunkLen | (1U << 10))),
+            &pImgInfo[dwOffset + PHDNLDNFC_FRAME_HDR_LEN + wLen - wRemLen],
+            wChunkLen, NULL);
+        pFrame += pTxFrames[dwNbTxFrames].wFrameLen;
+        dwNbTxFrames++;
+      }
+    }
+    dwFrame++;
+  }
+
+  pTxImg = pImgInfo;
+  NXPLOG_FWDNLD_D("Prepared %d write frames for %d frames of the sequence",
+                  dwNbTxFrames, dwFrame);
+  return NFCSTATUS_SUCCESS;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_GetImgTxFrame
+**
+** Description      Looks up the write frame prepared to be sent at the given
+**                  offset of a download sequence. The frames are looked up
+**                  in sequence order, starting after the last one returned.
+**
+** Parameters       pImgInfo - Firmware image handle
+**                  wOffset  - Write offset within the sequence
+**
+** Returns          Prepared frame, NULL if none is prepared
+**
+*******************************************************************************/
+const phDnldNfc_ImgTxFrame_t* phDnldNfc_GetImgTxFrame(const uint8_t* pImgInfo,
+                                                      uint16_t wOffset) {
+  uint32_t dwLow = 0;
+  uint32_t dwHigh = dwNbTxFrames;
+  uint32_t dwMid;
+
+  if ((NULL == pImgInfo) || (pImgInfo != pTxImg)) {
+    return NULL;
+  }
+  if ((dwTxFrameIdx < dwNbTxFrames) &&
+      (pTxFrames[dwTxFrameIdx].wOffset == wOffset)) {
+    return &pTxFrames[dwTxFrameIdx];
+  }
+  if (((dwTxFrameIdx + 1) < dwNbTxFrames) &&
+      (pTxFrames[dwTxFrameIdx + 1].wOffset == wOffset)) {
+    return &pTxFrames[++dwTxFrameIdx];
+  }
+
+  /* restarted or resumed sequence */
+  while (dwLow < dwHigh) {
+    dwMid = (dwLow + dwHigh) / 2;
+    if (pTxFrames[dwMid].wOffset < wOffset) {
+      dwLow = dwMid + 1;
+    } else {
+      dwHigh = dwMid;
+    }
+  }
+  if ((dwLow < dwNbTxFrames) && (pTxFrames[dwLow].wOffset == wOffset)) {
+    dwTxFrameIdx = dwLow;
+    return &pTxFrames[dwLow];
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_ReleaseImgTxFrames
+**
+** Description      Releases the write frames prepared by
+**                  phDnldNfc_PrepareImgTxFrames, if any
+**
+** Parameters       None
+**
+** Returns          None
+**
+*******************************************************************************/
+void phDnldNfc_ReleaseImgTxFrames(void) {
+  free(pTxBuff);
+  free(pTxFrames);
+  pTxImg = NULL;
+  pTxBuff = NULL;
+  pTxFrames = NULL;
+  dwNbTxFrames = 0;
+  dwTxFrameIdx = 0;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_AddImgTxFrame
+**
+** Description      Writes a prepared frame: header, payload and CRC16 of both
+**
+** Parameters       pFrame  - Buffer receiving the frame
+**                  wHdr    - Frame header value
+**                  pPld    - Frame payload
+**                  wPldLen - Frame payload length
+**                  pCrc    - Precomputed CRC16, NULL to compute it
+**
+** Returns          Frame length
+**
+*******************************************************************************/
+static uint16_t phDnldNfc_AddImgTxFrame(uint8_t* pFrame, uint16_t wHdr,
+                                        const uint8_t* pPld, uint16_t wPldLen,
+                                        const uint16_t* pCrc) {
+  uint16_t wLen = PHDNLDNFC_FRAME_HDR_LEN + wPldLen;
+  uint16_t wCrcVal;
+
+  pFrame[0] = (uint8_t)(wHdr >> 8U);
+  pFrame[1] = (uint8_t)wHdr;
+  memcpy(&pFrame[PHDNLDNFC_FRAME_HDR_LEN], pPld, wPldLen);
+  wCrcVal = (NULL != pCrc) ? (*pCrc) : phDnldNfc_CalcCrc16(pFrame, wLen);
+  pFrame[wLen] = (uint8_t)(wCrcVal >> 8U);
+  pFrame[wLen + 1] = (uint8_t)wCrcVal;
+
+  return wLen + PHDNLDNFC_FRAME_CRC_LEN;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_GetImgPath
+**
+** Description      Builds the image container path from the firmware library
+**                  path
+**
+** Parameters       pathName    - Firmware library path
+**                  pImgPath    - Buffer receiving the container path
+**                  wImgPathLen - Size of pImgPath
+**
+** Returns          true if the path is built
+**
+*******************************************************************************/
+static bool phDnldNfc_GetImgPath(const char* pathName, char* pImgPath,
+                                 size_t wImgPathLen) {
+  size_t len = strlen(pathName);
+  size_t suffixLen = strlen(PHDNLDNFC_IMG_LIB_SUFFIX);
+
+  if ((len <= suffixLen) ||
+      (strcmp(pathName + len - suffixLen, PHDNLDNFC_IMG_LIB_SUFFIX) != 0) ||
+      ((len - suffixLen + sizeof(PHDNLDNFC_IMG_SUFFIX)) > wImgPathLen)) {
+    return false;
+  }
+  memcpy(pImgPath, pathName, len - suffixLen);
+  memcpy(pImgPath + len - suffixLen, PHDNLDNFC_IMG_SUFFIX,
+         sizeof(PHDNLDNFC_IMG_SUFFIX));
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_FindImgSect
+**
+** Description      Looks up a section in the mapped image container
+**
+** Parameters       eType - Section type
+**
+** Returns          Section table entry, NULL if not present
+**
+*******************************************************************************/
+static const phDnldNfc_ImgSect_t* phDnldNfc_FindImgSect(
+    phDnldNfc_ImgSectType_t eType) {
+  const phDnldNfc_ImgHdr_t* pHdr = (const phDnldNfc_ImgHdr_t*)pImgMap;
+  const phDnldNfc_ImgSect_t* pSect =
+      (const phDnldNfc_ImgSect_t*)(pImgMap + sizeof(phDnldNfc_ImgHdr_t));
+  uint16_t i;
+
+  for (i = 0; i < pHdr->wNbSections; i++) {
+    if (pSect[i].wType == (uint16_t)eType) {
+      return &pSect[i];
+    }
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_CheckImgSect
+**
+** Description      Checks that a section of the mapped image container lies
+**                  within the mapping, that its frame table describes its
+**                  download sequence and that its FW version is the one the
+**                  sequence carries (bytes 4 and 5, as read by
+**                  phDnldNfc_InitImgInfo). The frame CRCs are covered by the
+**                  container checksum.
+**
+** Parameters       pSect - Section table entry
+**
+** Returns          NFC status
+**
+*******************************************************************************/
+static NFCSTATUS phDnldNfc_CheckImgSect(const phDnldNfc_ImgSect_t* pSect) {
+  const phDnldNfc_ImgFrame_t* pFrame;
+  const uint8_t* pData;
+  uint32_t dwOffset = 0;
+  uint32_t i;
+
+  if ((0 == pSect->dwDataLen) || (pSect->dwDataLen > 0xFFFFU) ||
+      (pSect->dwDataOffset > dwImgMapLen) ||
+      (pSect->dwDataLen > (dwImgMapLen - pSect->dwDataOffset)) ||
+      (0 != (pSect->dwFrameOffset & 0x03U)) ||
+      (pSect->dwFrameOffset > dwImgMapLen) ||
+      (pSect->dwNbFrames >
+       ((dwImgMapLen - pSect->dwFrameOffset) / sizeof(phDnldNfc_ImgFrame_t)))) {
+    return NFCSTATUS_FAILED;
+  }
+
+  pData = pImgMap + pSect->dwDataOffset;
+  pFrame = (const phDnldNfc_ImgFrame_t*)(pImgMap + pSect->dwFrameOffset);
+  for (i = 0; i < pSect->dwNbFrames; i++) {
+    if ((pFrame[i].dwOffset != dwOffset) ||
+        ((pSect->dwDataLen - dwOffset) < 2U) ||
+        (pFrame[i].wLen !=
+         (((uint16_t)pData[dwOffset] << 8U) | pData[dwOffset + 1])) ||
+        ((pSect->dwDataLen - dwOffset - 2U) < pFrame[i].wLen)) {
+      return NFCSTATUS_FAILED;
+    }
+    dwOffset += 2U + pFrame[i].wLen;
+  }
+
+  if ((dwOffset != pSect->dwDataLen) || (pSect->dwDataLen < 6U)) {
+    return NFCSTATUS_FAILED;
+  }
+  if (pSect->wFwVer != (((uint16_t)pData[5] << 8U) | pData[4])) {
+    NXPLOG_FWDNLD_E("Image container section FW version %04x, sequence %04x",
+                    pSect->wFwVer, (((uint16_t)pData[5] << 8U) | pData[4]));
+    return NFCSTATUS_FAILED;
+  }
+
+  return NFCSTATUS_SUCCESS;
+}
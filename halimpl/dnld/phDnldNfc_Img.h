@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Flat firmware image container
+ *
+ * A container is installed next to the firmware library, with the ".so"
+ * suffix replaced by ".bin" (e.g. libpn553_fw.bin), and is mapped read-only
+ * in place of loading the library. It is built from the library by the
+ * phDnldNfc_mkimg tool (dnld/tools/phDnldNfc_MkImg.cc). All fields are
+ * little endian:
+ *
+ *   phDnldNfc_ImgHdr_t                  container header
+ *   phDnldNfc_ImgSect_t[wNbSections]    section table
+ *   section data and frame tables       at the offsets given by the sections
+ *
+ * The data of a section is the download sequence otherwise exported by the
+ * library (gphDnldNfc_DlSeq or gphDnldNfc_DummyDlSeq): a series of frames,
+ * each one a 2 byte big endian payload length followed by the payload. Its
+ * frame table gives for each frame its offset within the data, its payload
+ * length and the CRC16 of the frame as sent when it is not segmented.
+ *
+ * The container is only used when it is built for the chip type of the
+ * NFCC, its checksum matches and the FW version of the section is the one
+ * carried by its sequence. The checksum covers the frame tables, so their
+ * CRCs are not computed again.
+ *
+ * Once an image is loaded, the write frames of its sequence are prepared
+ * with their header and CRC, so that each one is sent without being copied
+ * or checksummed again.
+ */
+#ifndef PHDNLDNFC_IMG_H
+#define PHDNLDNFC_IMG_H
+
+#include <phDnldNfc.h>
+
+#define PHDNLDNFC_IMG_MAGIC (0x5746584EU) /* "NXFW" */
+#define PHDNLDNFC_IMG_FORMAT_VER (0x0002U)
+
+/*
+ * Enum definition contains the container section types
+ */
+typedef enum phDnldNfc_ImgSectType {
+  phDnldNfc_ImgSectFw = 1U,   /* Firmware download sequence */
+  phDnldNfc_ImgSectDummy = 2U /* Dummy firmware sequence used for recovery */
+} phDnldNfc_ImgSectType_t;
+
+/*
+ * Container header
+ */
+typedef struct phDnldNfc_ImgHdr {
+  uint32_t dwMagic;     /* PHDNLDNFC_IMG_MAGIC */
+  uint16_t wFormatVer;  /* PHDNLDNFC_IMG_FORMAT_VER */
+  uint16_t wNbSections; /* Number of entries in the section table */
+  uint16_t wChipType;   /* tNFC_chipType the image is built for */
+  uint16_t wReserved;
+  uint32_t dwImgLen;   /* Total container length */
+  uint32_t dwImgCrc32; /* sparse_crc32 of the container past the header */
+} phDnldNfc_ImgHdr_t;
+
+/*
+ * Section table entry
+ */
+typedef struct phDnldNfc_ImgSect {
+  uint16_t wType;         /* phDnldNfc_ImgSectType_t */
+  uint16_t wFwVer;        /* Firmware version written by the sequence */
+  uint32_t dwDataOffset;  /* Offset of the download sequence */
+  uint32_t dwDataLen;     /* Length of the download sequence */
+  uint32_t dwFrameOffset; /* Offset of the frame table, 4 byte aligned */
+  uint32_t dwNbFrames;    /* Number of entries in the frame table */
+} phDnldNfc_ImgSect_t;
+
+/*
+ * Frame table entry
+ */
+typedef struct phDnldNfc_ImgFrame {
+  uint32_t dwOffset; /* Offset of the frame length header within the data */
+  uint16_t wLen;     /* Frame payload length */
+  uint16_t wCrc;     /* CRC16 of the frame header and payload */
+} phDnldNfc_ImgFrame_t;
+
+/*
+ * Write frame prepared from a download sequence, sent as is
+ */
+typedef struct phDnldNfc_ImgTxFrame {
+  uint8_t* pFrame;    /* Frame with its header and CRC */
+  uint16_t wFrameLen; /* Length of pFrame */
+  uint16_t wOffset;   /* Sequence write offset the frame is sent at */
+  uint16_t wPldLen;   /* Sequence bytes carried by the frame */
+  uint16_t wChunkedLen; /* Payload length of the segmented frame the chunk is
+                           part of, 0 if the frame is not segmented */
+  bool_t bFirstChunk;   /* Chunk is the first one of its frame */
+  bool_t bLastChunk;    /* Chunk is the last one of its frame */
+} phDnldNfc_ImgTxFrame_t;
+
+/*
+*********************** Function Prototype Declaration *************************
+*/
+
+extern NFCSTATUS phDnldNfc_MapImg(const char* pathName,
+                                  phDnldNfc_ImgSectType_t eType,
+                                  uint8_t** pImgInfo, uint16_t* pImgInfoLen);
+extern void phDnldNfc_UnmapImg(void);
+extern const phDnldNfc_ImgFrame_t* phDnldNfc_GetImgFrames(
+    const uint8_t* pImgInfo, uint32_t* pNbFrames);
+extern NFCSTATUS phDnldNfc_PrepareImgTxFrames(const uint8_t* pImgInfo,
+                                              uint16_t wImgInfoLen);
+extern const phDnldNfc_ImgTxFrame_t* phDnldNfc_GetImgTxFrame(
+    const uint8_t* pImgInfo, uint16_t wOffset);
+extern void phDnldNfc_ReleaseImgTxFrames(void);
+
+#endif /* PHDNLDNFC_IMG_H */
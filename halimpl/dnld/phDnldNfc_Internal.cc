@@ -19,7 +19,10 @@
  * Download Component
  */
 
+#include <time.h>
+#include <mutex>
 #include <phDnldNfc_Internal.h>
+#include <phDnldNfc_Img.h>
 #include <phDnldNfc_Utils.h>
 #include <phTmlNfc.h>
 #include <phNxpLog.h>
@@ -58,8 +61,12 @@
 
 /* Timeout value to wait for response from NFCC */
 #define PHDNLDNFC_RSP_TIMEOUT (2500)
-/* Timeout value to wait before resending the last frame */
+/* Maximum timeout value to wait before resending the last frame */
 #define PHDNLDNFC_RETRY_FRAME_WRITE (50)
+/* Minimum timeout value to wait before resending the last frame */
+#define PHDNLDNFC_RETRY_FRAME_WRITE_MIN (4)
+/* Weight of the last busy duration in the learnt one, as a right shift */
+#define PHDNLDNFC_BUSY_EWMA_SHIFT (2)
 
 /* size of EEPROM user data length */
 #define PHDNLDNFC_USERDATA_EEPROM_LENSIZE (0x02U)
@@ -87,12 +94,32 @@ static NFCSTATUS phDnldNfc_ProcessRecvInfo(void* pContext,
                                            phTmlNfc_TransactInfo_t* pInfo);
 static NFCSTATUS phDnldNfc_BuildFramePkt(pphDnldNfc_DlContext_t pDlContext);
 static NFCSTATUS phDnldNfc_CreateFramePld(pphDnldNfc_DlContext_t pDlContext);
+static bool_t phDnldNfc_UsePreparedFrame(pphDnldNfc_DlContext_t pDlContext);
 static NFCSTATUS phDnldNfc_SetupResendTimer(pphDnldNfc_DlContext_t pDlContext);
 static NFCSTATUS phDnldNfc_UpdateRsp(pphDnldNfc_DlContext_t pDlContext,
                                      phTmlNfc_TransactInfo_t* pInfo,
                                      uint16_t wPldLen);
 static void phDnldNfc_RspTimeOutCb(uint32_t TimerId, void* pContext);
 static void phDnldNfc_ResendTimeOutCb(uint32_t TimerId, void* pContext);
+static uint32_t phDnldNfc_GetResendDelay(pphDnldNfc_DlContext_t pDlContext);
+static void phDnldNfc_BusyDone(pphDnldNfc_DlContext_t pDlContext);
+
+/*
+ * MEM_BSY statistics of a write sequence type
+ */
+typedef struct phDnldNfc_BusyStats {
+  uint32_t dwBusyFrames; /* Frames which got at least one MEM_BSY status */
+  uint32_t dwResends;    /* Frames resent after MEM_BSY status */
+  uint32_t dwBusyMs;     /* Sum of the busy durations */
+  uint32_t dwWaitMs;     /* Sum of the resend wait timeouts */
+  uint32_t dwEwmaUs;     /* Learnt busy duration, 0 until the first one */
+} phDnldNfc_BusyStats_t;
+
+/* Kept across downloads, the busy durations depend on the chip flash.
+ * Updated by the download thread and read by phNxpNciHal_ioctl: protected
+ * by gBusyStatsLock */
+static phDnldNfc_BusyStats_t gtBusyStats[phDnldNfc_SeqMax];
+static std::mutex gBusyStatsLock;
 
 /*
 *************************** Function Definitions ***************************
@@ -389,7 +416,7 @@ static void phDnldNfc_ProcessRWSeqState(void* pContext,
           pDlCtxt->tCurrState = phDnldNfc_StateRecv;
 
           wStatus = phTmlNfc_Write(
-              (pDlCtxt->tCmdRspFrameInfo.aFrameBuff),
+              (pDlCtxt->pSendBuff),
               (uint16_t)(pDlCtxt->tCmdRspFrameInfo.dwSendlength),
               (pphTmlNfc_TransactCompletionCb_t)&phDnldNfc_ProcessRWSeqState,
               pDlCtxt);
@@ -435,8 +462,14 @@ static void phDnldNfc_ProcessRWSeqState(void* pContext,
       case phDnldNfc_StateTimer: {
         if (1 == (pDlCtxt->TimerInfo.TimerStatus)) /*Is Timer Running*/
         {
-          /* Stop Timer */
-          (void)phOsalNfc_Timer_Stop(pDlCtxt->TimerInfo.dwRspTimerId);
+          if ((phDnldNfc_EventWrite == (pDlCtxt->tCurrEvent)) &&
+              (true == (pDlCtxt->bPipelined))) {
+            /* Left running, it is restarted for the next frame or deleted
+             * at the end of the sequence. A late expiry is ignored */
+          } else {
+            /* Stop Timer */
+            (void)phOsalNfc_Timer_Stop(pDlCtxt->TimerInfo.dwRspTimerId);
+          }
           (pDlCtxt->TimerInfo.TimerStatus) = 0; /*timer stopped*/
         }
         pDlCtxt->tCurrState = phDnldNfc_StateResponse;
@@ -446,6 +479,10 @@ static void phDnldNfc_ProcessRWSeqState(void* pContext,
           /* Process response */
           wStatus = phDnldNfc_ProcessFrame(pContext, pInfo);
 
+          if (NFCSTATUS_SUCCESS == wStatus) {
+            phDnldNfc_BusyDone(pDlCtxt);
+          }
+
           if (NFCSTATUS_BUSY == wStatus) {
             /* store the status for use in subsequent processing */
             wIntStatus = wStatus;
@@ -466,11 +503,16 @@ static void phDnldNfc_ProcessRWSeqState(void* pContext,
 
         if ((0 != (pDlCtxt->tRWInfo.wRemBytes)) &&
             (NFCSTATUS_SUCCESS == wStatus)) {
-          /* Abort TML read operation which is always kept open */
-          wIntStatus = phTmlNfc_ReadAbort();
-
-          if (NFCSTATUS_SUCCESS != wIntStatus) {
-            NXPLOG_FWDNLD_W("Tml read abort failed!");
+          /* The response read is complete and re-armed for the next frame
+           * in pipelined mode, an abort would only be consumed by that read */
+          if ((phDnldNfc_EventWrite != (pDlCtxt->tCurrEvent)) ||
+              (true != (pDlCtxt->bPipelined))) {
+            /* Abort TML read operation which is always kept open */
+            wIntStatus = phTmlNfc_ReadAbort();
+
+            if (NFCSTATUS_SUCCESS != wIntStatus) {
+              NXPLOG_FWDNLD_W("Tml read abort failed!");
+            }
           }
 
           wStatus = phDnldNfc_BuildFramePkt(pDlCtxt);
@@ -478,7 +520,7 @@ static void phDnldNfc_ProcessRWSeqState(void* pContext,
           if (NFCSTATUS_SUCCESS == wStatus) {
             pDlCtxt->tCurrState = phDnldNfc_StateRecv;
             wStatus = phTmlNfc_Write(
-                (pDlCtxt->tCmdRspFrameInfo.aFrameBuff),
+                (pDlCtxt->pSendBuff),
                 (uint16_t)(pDlCtxt->tCmdRspFrameInfo.dwSendlength),
                 (pphTmlNfc_TransactCompletionCb_t)&phDnldNfc_ProcessRWSeqState,
                 pDlCtxt);
@@ -503,6 +545,13 @@ static void phDnldNfc_ProcessRWSeqState(void* pContext,
           pDlCtxt->tDnldInProgress = phDnldNfc_TransitionIdle;
           pDlCtxt->tCurrState = phDnldNfc_StateInit;
           pDlCtxt->bResendLastFrame = false;
+          (pDlCtxt->tBusyInfo.qwBusyStartUs) = 0;
+          NXPLOG_FWDNLD_D(
+              "Busy frames %d, resends %d, waited %d ms, learnt %d us",
+              gtBusyStats[pDlCtxt->tBusyInfo.tSeqType].dwBusyFrames,
+              gtBusyStats[pDlCtxt->tBusyInfo.tSeqType].dwResends,
+              gtBusyStats[pDlCtxt->tBusyInfo.tSeqType].dwWaitMs,
+              gtBusyStats[pDlCtxt->tBusyInfo.tSeqType].dwEwmaUs);
 
           /* Delete the timer & reset timer primitives in context */
           (void)phOsalNfc_Timer_Delete(pDlCtxt->TimerInfo.dwRspTimerId);
@@ -591,6 +640,14 @@ static NFCSTATUS phDnldNfc_BuildFramePkt(pphDnldNfc_DlContext_t pDlContext) {
     } else {
     }
 
+    /* write frames of a loaded image are prepared beforehand */
+    if ((NFCSTATUS_SUCCESS == wStatus) &&
+        (phDnldNfc_FTWrite == (pDlContext->FrameInp.Type)) &&
+        (true == phDnldNfc_UsePreparedFrame(pDlContext))) {
+      return wStatus;
+    }
+    (pDlContext->pSendBuff) = (pDlContext->tCmdRspFrameInfo.aFrameBuff);
+
     if (NFCSTATUS_SUCCESS == wStatus) {
       wStatus = phDnldNfc_CreateFramePld(pDlContext);
     }
@@ -666,6 +723,47 @@ static NFCSTATUS phDnldNfc_BuildFramePkt(pphDnldNfc_DlContext_t pDlContext) {
   return wStatus;
 }
 
+/*******************************************************************************
+**
+** Function         phDnldNfc_UsePreparedFrame
+**
+** Description      Selects the prepared write frame to send at the current
+**                  write offset and updates the read/write info as
+**                  phDnldNfc_CreateFramePld would for the same frame
+**
+** Parameters       pDlContext - pointer to the download context structure
+**
+** Returns          true if a prepared frame is selected
+**
+*******************************************************************************/
+static bool_t phDnldNfc_UsePreparedFrame(pphDnldNfc_DlContext_t pDlContext) {
+  const phDnldNfc_ImgTxFrame_t* pTxFrame;
+
+  pTxFrame = phDnldNfc_GetImgTxFrame((pDlContext->tUserData.pBuff),
+                                     (pDlContext->tRWInfo.wOffset));
+  if ((NULL == pTxFrame) ||
+      ((0 != pTxFrame->wChunkedLen) &&
+       (pTxFrame->bFirstChunk == (pDlContext->tRWInfo.bFirstChunkResp)))) {
+    return false;
+  }
+
+  if (0 == pTxFrame->wChunkedLen) {
+    (pDlContext->tRWInfo.wRWPldSize) = 0;
+  } else {
+    if (true == pTxFrame->bFirstChunk) {
+      (pDlContext->tRWInfo.wRWPldSize) = pTxFrame->wChunkedLen;
+      (pDlContext->tRWInfo.wRemChunkBytes) = pTxFrame->wChunkedLen;
+      (pDlContext->tRWInfo.wOffset) += PHDNLDNFC_FRAME_HDR_LEN;
+    }
+    (pDlContext->tRWInfo.bFramesSegmented) = !(pTxFrame->bLastChunk);
+  }
+  (pDlContext->tRWInfo.wBytesToSendRecv) = pTxFrame->wPldLen;
+  (pDlContext->pSendBuff) = pTxFrame->pFrame;
+  (pDlContext->tCmdRspFrameInfo.dwSendlength) = pTxFrame->wFrameLen;
+
+  return true;
+}
+
 /*******************************************************************************
 **
 ** Function         phDnldNfc_CreateFramePld
@@ -947,13 +1045,15 @@ static NFCSTATUS phDnldNfc_ProcessRecvInfo(void* pContext,
 *******************************************************************************/
 static NFCSTATUS phDnldNfc_SetupResendTimer(pphDnldNfc_DlContext_t pDlContext) {
   NFCSTATUS wStatus = NFCSTATUS_SUCCESS;
+  uint32_t dwDelay;
 
+  dwDelay = phDnldNfc_GetResendDelay(pDlContext);
   wStatus = phOsalNfc_Timer_Start((pDlContext->TimerInfo.dwRspTimerId),
-                                  PHDNLDNFC_RETRY_FRAME_WRITE,
-                                  &phDnldNfc_ResendTimeOutCb, pDlContext);
+                                  dwDelay, &phDnldNfc_ResendTimeOutCb,
+                                  pDlContext);
 
   if (NFCSTATUS_SUCCESS == wStatus) {
-    NXPLOG_FWDNLD_D("Frame Resend wait timer started");
+    NXPLOG_FWDNLD_D("Frame Resend wait timer started, %d ms", dwDelay);
     (pDlContext->TimerInfo.TimerStatus) = 1;
     pDlContext->tCurrState = phDnldNfc_StateTimer;
   } else {
@@ -966,6 +1066,151 @@ static NFCSTATUS phDnldNfc_SetupResendTimer(pphDnldNfc_DlContext_t pDlContext) {
   return wStatus;
 }
 
+/*******************************************************************************
+**
+** Function         phDnldNfc_GetResendDelay
+**
+** Description      Gets the time to wait before resending the write frame
+**                  which got a MEM_BSY status. The first resend is scheduled
+**                  after the busy duration learnt for the sequence type, the
+**                  next ones after exponentially growing steps starting at
+**                  PHDNLDNFC_RETRY_FRAME_WRITE_MIN, all of them bounded by
+**                  PHDNLDNFC_RETRY_FRAME_WRITE.
+**
+** Parameters       pDlContext - pointer to the download context structure
+**
+** Returns          Resend wait timeout in milliseconds
+**
+*******************************************************************************/
+static uint32_t phDnldNfc_GetResendDelay(pphDnldNfc_DlContext_t pDlContext) {
+  phDnldNfc_BusyInfo_t* pBusyInfo = &(pDlContext->tBusyInfo);
+  phDnldNfc_BusyStats_t* pStats = &gtBusyStats[pBusyInfo->tSeqType];
+  std::lock_guard<std::mutex> lock(gBusyStatsLock);
+  struct timespec tNow;
+  uint32_t dwDelay;
+
+  if (0 == (pBusyInfo->qwBusyStartUs)) {
+    clock_gettime(CLOCK_MONOTONIC, &tNow);
+    (pBusyInfo->qwBusyStartUs) =
+        ((uint64_t)tNow.tv_sec * 1000000U) + (tNow.tv_nsec / 1000U);
+    (pBusyInfo->bNbResends) = 0;
+    (pStats->dwBusyFrames)++;
+    dwDelay = ((pStats->dwEwmaUs) + 999U) / 1000U;
+  } else {
+    dwDelay = PHDNLDNFC_RETRY_FRAME_WRITE;
+    if ((pBusyInfo->bNbResends) < 8) {
+      dwDelay = PHDNLDNFC_RETRY_FRAME_WRITE_MIN << ((pBusyInfo->bNbResends) - 1);
+    }
+  }
+  if (dwDelay < PHDNLDNFC_RETRY_FRAME_WRITE_MIN) {
+    dwDelay = PHDNLDNFC_RETRY_FRAME_WRITE_MIN;
+  } else if (dwDelay > PHDNLDNFC_RETRY_FRAME_WRITE) {
+    dwDelay = PHDNLDNFC_RETRY_FRAME_WRITE;
+  }
+
+  if ((pBusyInfo->bNbResends) < 0xFFU) {
+    (pBusyInfo->bNbResends)++;
+  }
+  (pStats->dwResends)++;
+  (pStats->dwWaitMs) += dwDelay;
+
+  return dwDelay;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_BusyDone
+**
+** Description      Accounts for the write frame accepted by the NFCC. If it
+**                  got MEM_BSY statuses, the time elapsed since the first
+**                  one updates the busy duration learnt for the sequence type
+**                  (exponentially weighted moving average).
+**
+** Parameters       pDlContext - pointer to the download context structure
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phDnldNfc_BusyDone(pphDnldNfc_DlContext_t pDlContext) {
+  phDnldNfc_BusyInfo_t* pBusyInfo = &(pDlContext->tBusyInfo);
+  phDnldNfc_BusyStats_t* pStats = &gtBusyStats[pBusyInfo->tSeqType];
+  struct timespec tNow;
+  uint64_t qwBusyUs;
+
+  if (0 == (pBusyInfo->qwBusyStartUs)) {
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &tNow);
+  qwBusyUs = ((uint64_t)tNow.tv_sec * 1000000U) + (tNow.tv_nsec / 1000U) -
+             (pBusyInfo->qwBusyStartUs);
+  if (qwBusyUs > (PHDNLDNFC_RSP_TIMEOUT * 1000U)) {
+    qwBusyUs = PHDNLDNFC_RSP_TIMEOUT * 1000U;
+  }
+  (pBusyInfo->qwBusyStartUs) = 0;
+
+  std::lock_guard<std::mutex> lock(gBusyStatsLock);
+  (pStats->dwBusyMs) += (uint32_t)(qwBusyUs / 1000U);
+  if (0 == (pStats->dwEwmaUs)) {
+    (pStats->dwEwmaUs) = (uint32_t)qwBusyUs;
+  } else {
+    (pStats->dwEwmaUs) =
+        (uint32_t)((int64_t)(pStats->dwEwmaUs) +
+                   (((int64_t)qwBusyUs - (int64_t)(pStats->dwEwmaUs)) >>
+                    PHDNLDNFC_BUSY_EWMA_SHIFT));
+  }
+  NXPLOG_FWDNLD_D("Frame busy for %d us after %d resends, learnt %d us",
+                  (uint32_t)qwBusyUs, pBusyInfo->bNbResends,
+                  pStats->dwEwmaUs);
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_GetBusyStats
+**
+** Description      Gets the MEM_BSY statistics of the write sequences. For
+**                  each sequence type (firmware, recovery, caller provided),
+**                  5 little endian 32 bit counters: frames which got a
+**                  MEM_BSY status, resends, sum of the busy durations (ms),
+**                  sum of the resend waits (ms) and learnt busy duration (us)
+**
+** Parameters       pBuff - buffer receiving the statistics
+**                  pLen  - size of pBuff as input, statistics length as output
+**
+** Returns          NFC status
+**
+*******************************************************************************/
+NFCSTATUS phDnldNfc_GetBusyStats(uint8_t* pBuff, uint16_t* pLen) {
+  phDnldNfc_BusyStats_t atStats[phDnldNfc_SeqMax];
+  uint32_t aCounters[5];
+  uint16_t wLen = 0;
+  uint32_t i, j;
+
+  if ((NULL == pBuff) || (NULL == pLen) ||
+      ((*pLen) < (phDnldNfc_SeqMax * sizeof(aCounters)))) {
+    return NFCSTATUS_INVALID_PARAMETER;
+  }
+  {
+    std::lock_guard<std::mutex> lock(gBusyStatsLock);
+    memcpy(atStats, gtBusyStats, sizeof(atStats));
+  }
+  for (i = 0; i < phDnldNfc_SeqMax; i++) {
+    aCounters[0] = atStats[i].dwBusyFrames;
+    aCounters[1] = atStats[i].dwResends;
+    aCounters[2] = atStats[i].dwBusyMs;
+    aCounters[3] = atStats[i].dwWaitMs;
+    aCounters[4] = atStats[i].dwEwmaUs;
+    for (j = 0; j < (sizeof(aCounters) / sizeof(aCounters[0])); j++) {
+      pBuff[wLen++] = (uint8_t)aCounters[j];
+      pBuff[wLen++] = (uint8_t)(aCounters[j] >> 8U);
+      pBuff[wLen++] = (uint8_t)(aCounters[j] >> 16U);
+      pBuff[wLen++] = (uint8_t)(aCounters[j] >> 24U);
+    }
+  }
+  (*pLen) = wLen;
+
+  return NFCSTATUS_SUCCESS;
+}
+
 #if !defined(PH_LIBNFC_VEN_RESET_ON_DOWNLOAD_TIMEOUT)
 #error PH_LIBNFC_VEN_RESET_ON_DOWNLOAD_TIMEOUT has to be defined
 #endif
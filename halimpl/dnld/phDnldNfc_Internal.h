@@ -164,6 +164,28 @@ typedef struct phDnldNfc_RWInfo {
       bFirstChunkResp; /* Flag to indicate if we got the first chunk response */
 } phDnldNfc_RWInfo_t, *pphDnldNfc_RWInfo_t; /* pointer to #phDnldNfc_RWInfo_t */
 
+/*
+ * Enum definition contains the write sequence types, busy durations are
+ * learnt separately for each of them
+ */
+typedef enum phDnldNfc_SeqType {
+  phDnldNfc_SeqFw = 0,   /* Firmware image, dummy firmware included */
+  phDnldNfc_SeqRecovery, /* Platform or PKU recovery image */
+  phDnldNfc_SeqUser,     /* Sequence provided by the caller */
+  phDnldNfc_SeqMax
+} phDnldNfc_SeqType_t;
+
+/*
+ * Struct contains the state of the resend after MEM_BSY status of the write
+ * frame being sent
+ */
+typedef struct phDnldNfc_BusyInfo {
+  phDnldNfc_SeqType_t tSeqType; /* Type of the write sequence */
+  uint64_t qwBusyStartUs; /* Time of the first MEM_BSY status of the frame,
+                             0 if the frame is not busy */
+  uint8_t bNbResends;     /* Resends of the frame so far */
+} phDnldNfc_BusyInfo_t;
+
 /*
  * Download context structure
  */
@@ -175,6 +197,9 @@ typedef struct phDnldNfc_DlContext {
   uint16_t nxp_nfc_fw_len;  /* Firmware image length */
   bool_t bResendLastFrame;  /* Flag to resend the last write frame after MEM_BSY
                                status */
+  bool_t bPipelined; /* Flag to send the write frames back to back, without
+                        stopping the response timer or aborting the read */
+  phDnldNfc_BusyInfo_t tBusyInfo; /* Resend after MEM_BSY status info */
   phDnldNfc_Transition_t
       tDnldInProgress; /* Flag to indicate if download request is ongoing */
   phDnldNfc_Event_t tCurrEvent; /* Current event being processed */
@@ -188,6 +213,8 @@ typedef struct phDnldNfc_DlContext {
                                              except pipeline write */
   phDnldNfc_FrameInfo_t
       tPipeLineWrFrameInfo; /* Buffer to hold the pipelined write frame */
+  uint8_t* pSendBuff; /* Frame being sent, tCmdRspFrameInfo buffer or a
+                         prepared write frame */
   NFCSTATUS
   wCmdSendStatus; /* Holds the status of cmd request made to cmd handler */
   phDnldNfc_CmdId_t tCmdId; /* Cmd Id of the currently processed cmd */
@@ -53,6 +53,17 @@ static uint16_t const aCrcTab[256] = {
     0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8, 0x6e17, 0x7e36, 0x4e55, 0x5e74,
     0x2e93, 0x3eb2, 0x0ed1, 0x1ef0};
 
+/*
+ * Slice-by-8: aTab[k][b] is the CRC16 of byte b followed by k zero bytes, so
+ * 8 input bytes are folded with 8 independent table lookups. Derived from
+ * aCrcTab on first use.
+ */
+typedef struct phDnldNfc_CrcSliceTab {
+  uint16_t aTab[8][256];
+} phDnldNfc_CrcSliceTab_t;
+
+static const phDnldNfc_CrcSliceTab_t* phDnldNfc_GetCrcSliceTab(void);
+
 /*******************************************************************************
 **
 ** Function         phDnldNfc_CalcCrc16
@@ -66,17 +77,33 @@ static uint16_t const aCrcTab[256] = {
 **
 *******************************************************************************/
 uint16_t phDnldNfc_CalcCrc16(uint8_t* pBuff, uint16_t wLen) {
+  const phDnldNfc_CrcSliceTab_t* pSliceTab;
   uint16_t wTmp;
   uint16_t wValue;
   uint16_t wCrc = 0xffff;
-  uint32_t i;
+  uint32_t i = 0;
 
   if ((NULL == pBuff) || (0 == wLen)) {
     NXPLOG_FWDNLD_W("Invalid Params supplied!!");
   } else {
     /* Perform CRC calculation according to ccitt with a initial value of 0x1d0f
      */
-    for (i = 0; i < wLen; i++) {
+    if (wLen >= 8) {
+      pSliceTab = phDnldNfc_GetCrcSliceTab();
+      for (; (i + 8) <= wLen; i += 8) {
+        /* CRC register folded into the first 2 bytes, big endian */
+        wValue = (((uint16_t)pBuff[i] << 8U) | pBuff[i + 1]) ^ wCrc;
+        wCrc = pSliceTab->aTab[7][wValue >> 8U] ^
+               pSliceTab->aTab[6][wValue & 0x00ffU] ^
+               pSliceTab->aTab[5][pBuff[i + 2]] ^
+               pSliceTab->aTab[4][pBuff[i + 3]] ^
+               pSliceTab->aTab[3][pBuff[i + 4]] ^
+               pSliceTab->aTab[2][pBuff[i + 5]] ^
+               pSliceTab->aTab[1][pBuff[i + 6]] ^
+               pSliceTab->aTab[0][pBuff[i + 7]];
+      }
+    }
+    for (; i < wLen; i++) {
       wValue = 0x00ffU & (uint16_t)pBuff[i];
       wTmp = (wCrc >> 8U) ^ wValue;
       wCrc = (wCrc << 8U) ^ aCrcTab[wTmp];
@@ -85,3 +112,34 @@ uint16_t phDnldNfc_CalcCrc16(uint8_t* pBuff, uint16_t wLen) {
 
   return wCrc;
 }
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_GetCrcSliceTab
+**
+** Description      Gets the slice-by-8 tables, deriving them from aCrcTab on
+**                  first use
+**
+** Parameters       None
+**
+** Returns          Slice-by-8 tables
+**
+*******************************************************************************/
+static const phDnldNfc_CrcSliceTab_t* phDnldNfc_GetCrcSliceTab(void) {
+  static const phDnldNfc_CrcSliceTab_t* pSliceTab = [] {
+    static phDnldNfc_CrcSliceTab_t sliceTab;
+    uint16_t wCrc;
+    uint32_t b, k;
+
+    for (b = 0; b < 256; b++) {
+      wCrc = aCrcTab[b];
+      sliceTab.aTab[0][b] = wCrc;
+      for (k = 1; k < 8; k++) {
+        wCrc = (uint16_t)(wCrc << 8U) ^ aCrcTab[wCrc >> 8U];
+        sliceTab.aTab[k][b] = wCrc;
+      }
+    }
+    return &sliceTab;
+  }();
+  return pSliceTab;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of phDnldNfc_CalcCrc16 against the byte-wise implementation it
+ * replaces, per write frame and over a whole firmware image
+ */
+#include "../phDnldNfc_Utils.cc"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+nci_log_level_t gLog_level;
+bool nfc_debug_enabled;
+const char* NXPLOG_ITEM_FWDNLD = "NxpFwDnld";
+
+/* Size of a PN553 firmware image */
+#define FW_IMAGE_SIZE (192 * 1024)
+/* Write frame: 2 byte header and at most 252 byte payload */
+#define FW_FRAME_SIZE (2 + 252)
+
+static uint16_t phDnldNfc_CalcCrc16Ref(const uint8_t* pBuff, uint16_t wLen) {
+  uint16_t wCrc = 0xffff;
+  uint32_t i;
+
+  for (i = 0; i < wLen; i++) {
+    wCrc = (wCrc << 8U) ^ aCrcTab[(wCrc >> 8U) ^ pBuff[i]];
+  }
+  return wCrc;
+}
+
+template <typename F>
+static void RunFrame(benchmark::State& state, F calc) {
+  std::vector<uint8_t> buf(state.range(0), 0x5A);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(calc(buf.data(), buf.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+
+/* CRC of every write frame of an image, as sent during a download */
+template <typename F>
+static void RunImage(benchmark::State& state, F calc) {
+  std::vector<uint8_t> buf(FW_IMAGE_SIZE, 0x5A);
+  for (auto _ : state) {
+    for (size_t offset = 0; offset < buf.size(); offset += FW_FRAME_SIZE) {
+      size_t size = std::min<size_t>(FW_FRAME_SIZE, buf.size() - offset);
+      benchmark::DoNotOptimize(calc(buf.data() + offset, size));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+
+static void BM_CalcCrc16Ref(benchmark::State& state) {
+  RunFrame(state, phDnldNfc_CalcCrc16Ref);
+}
+BENCHMARK(BM_CalcCrc16Ref)->Arg(8)->Arg(64)->Arg(FW_FRAME_SIZE);
+
+static void BM_CalcCrc16(benchmark::State& state) {
+  RunFrame(state, phDnldNfc_CalcCrc16);
+}
+BENCHMARK(BM_CalcCrc16)->Arg(8)->Arg(64)->Arg(FW_FRAME_SIZE);
+
+static void BM_CalcCrc16RefFwImage(benchmark::State& state) {
+  RunImage(state, phDnldNfc_CalcCrc16Ref);
+}
+BENCHMARK(BM_CalcCrc16RefFwImage);
+
+static void BM_CalcCrc16FwImage(benchmark::State& state) {
+  RunImage(state, phDnldNfc_CalcCrc16);
+}
+BENCHMARK(BM_CalcCrc16FwImage);
+
+BENCHMARK_MAIN();
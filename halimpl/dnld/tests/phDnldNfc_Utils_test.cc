@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks phDnldNfc_CalcCrc16 against the byte-wise implementation it
+ * replaces. The source is included for the CRC table.
+ */
+#include "../phDnldNfc_Utils.cc"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+nci_log_level_t gLog_level;
+bool nfc_debug_enabled;
+const char* NXPLOG_ITEM_FWDNLD = "NxpFwDnld";
+
+namespace {
+
+/* Former phDnldNfc_CalcCrc16, one table lookup per byte */
+uint16_t phDnldNfc_CalcCrc16Ref(const uint8_t* pBuff, uint16_t wLen) {
+  uint16_t wTmp;
+  uint16_t wValue;
+  uint16_t wCrc = 0xffff;
+  uint32_t i;
+
+  if ((NULL == pBuff) || (0 == wLen)) {
+    return wCrc;
+  }
+  for (i = 0; i < wLen; i++) {
+    wValue = 0x00ffU & (uint16_t)pBuff[i];
+    wTmp = (wCrc >> 8U) ^ wValue;
+    wCrc = (wCrc << 8U) ^ aCrcTab[wTmp];
+  }
+  return wCrc;
+}
+
+std::vector<uint8_t> RandomBuffer(size_t size, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::vector<uint8_t> buf(size);
+  for (auto& b : buf) b = gen();
+  return buf;
+}
+
+}  // namespace
+
+TEST(DnldNfcCrc16Test, TableIsCcitt) {
+  for (uint32_t b = 0; b < 256; b++) {
+    uint16_t wCrc = b << 8;
+    for (int k = 0; k < 8; k++) {
+      wCrc = (wCrc & 0x8000) ? ((wCrc << 1) ^ 0x1021) : (wCrc << 1);
+    }
+    ASSERT_EQ(wCrc, aCrcTab[b]) << "byte " << b;
+  }
+}
+
+TEST(DnldNfcCrc16Test, CheckValue) {
+  uint8_t check[] = "123456789";
+  EXPECT_EQ(0x29b1, phDnldNfc_CalcCrc16(check, sizeof(check) - 1));
+}
+
+TEST(DnldNfcCrc16Test, InvalidParams) {
+  uint8_t b = 0;
+  EXPECT_EQ(0xffff, phDnldNfc_CalcCrc16(NULL, 8));
+  EXPECT_EQ(0xffff, phDnldNfc_CalcCrc16(&b, 0));
+}
+
+TEST(DnldNfcCrc16Test, EveryBytePairValue) {
+  /* Every value of each pair of adjacent bytes, for each frame length
+   * around the 8 byte blocks: covers all the entries of each table */
+  for (uint16_t wLen = 2; wLen <= 17; wLen++) {
+    std::vector<uint8_t> buf = RandomBuffer(wLen, wLen);
+    for (uint16_t pos = 0; pos + 1 < wLen; pos++) {
+      const uint8_t b0 = buf[pos], b1 = buf[pos + 1];
+      for (uint32_t v = 0; v < 0x10000; v++) {
+        buf[pos] = v >> 8;
+        buf[pos + 1] = v;
+        ASSERT_EQ(phDnldNfc_CalcCrc16Ref(buf.data(), wLen),
+                  phDnldNfc_CalcCrc16(buf.data(), wLen))
+            << "len " << wLen << " pos " << pos << " value " << v;
+      }
+      buf[pos] = b0;
+      buf[pos + 1] = b1;
+    }
+  }
+}
+
+TEST(DnldNfcCrc16Test, LengthsAndAlignments) {
+  std::vector<uint8_t> buf = RandomBuffer(0x10000 + 8, 1);
+
+  for (uint32_t align = 0; align < 8; align++) {
+    for (uint32_t wLen = 1; wLen <= 0xFFFF; wLen += (wLen < 2048) ? 1 : 251) {
+      ASSERT_EQ(phDnldNfc_CalcCrc16Ref(buf.data() + align, wLen),
+                phDnldNfc_CalcCrc16(buf.data() + align, wLen))
+          << "align " << align << " len " << wLen;
+    }
+  }
+  ASSERT_EQ(phDnldNfc_CalcCrc16Ref(buf.data(), 0xFFFF),
+            phDnldNfc_CalcCrc16(buf.data(), 0xFFFF));
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Builds the flat image container of a firmware library, in the format
+ * described in phDnldNfc_Img.h:
+ *
+ *   phDnldNfc_mkimg <chip type> <firmware library> <container>
+ *
+ * e.g. phDnldNfc_mkimg pn553 /vendor/lib/libpn553_fw.so libpn553_fw.bin
+ *
+ * The library is loaded the way phDnldNfc_LoadFW loads it, so the tool is
+ * run where the library can be loaded (on a device of its ABI). The
+ * container is then installed next to the library, e.g.
+ * /vendor/lib/libpn553_fw.bin. It has to be built again whenever the
+ * library is updated, a stale container is rejected by its FW version.
+ */
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+
+#include <Nxp_Features.h>
+#include <phDnldNfc_Img.h>
+#include <phDnldNfc_Internal.h>
+#include <phDnldNfc_Utils.h>
+#include <phNxpLog.h>
+#include "sparse_crc32.h"
+
+nci_log_level_t gLog_level;
+bool nfc_debug_enabled;
+const char* NXPLOG_ITEM_FWDNLD = "NxpFwDnld";
+
+/* Names of tNFC_chipType, in enum order */
+static const char* const aChipNames[] = {"unknown", "pn547C2", "pn65T",
+                                         "pn548C2", "pn66T",   "pn551",
+                                         "pn67T",   "pn553",   "pn80T",
+                                         "pn557",   "pn81T"};
+
+/* Download sequence exported by the library */
+typedef struct phDnldNfc_MkImgSeq {
+  phDnldNfc_ImgSectType_t eType;
+  const char* pSeqSym;
+  const char* pSeqSzSym;
+  const uint8_t* pSeq;
+  uint16_t wSeqLen;
+} phDnldNfc_MkImgSeq_t;
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_MkImgGetSeq
+**
+** Description      Gets a download sequence from the loaded library
+**
+** Returns          true if the library exports the sequence
+**
+*******************************************************************************/
+static bool phDnldNfc_MkImgGetSeq(void* pLib, phDnldNfc_MkImgSeq_t* pSeq) {
+  void* pSym = dlsym(pLib, pSeq->pSeqSym);
+  void* pSzSym = dlsym(pLib, pSeq->pSeqSzSym);
+
+  if ((NULL == pSym) || (NULL == pSzSym) || (NULL == *(uint8_t**)pSym) ||
+      (0 == *(uint16_t*)pSzSym)) {
+    return false;
+  }
+  pSeq->pSeq = *(uint8_t**)pSym;
+  pSeq->wSeqLen = *(uint16_t*)pSzSym;
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function         phDnldNfc_MkImgAddSect
+**
+** Description      Appends a sequence and its frame table to the container
+**                  and fills its section table entry
+**
+** Returns          true if the sequence is a valid series of frames
+**
+*******************************************************************************/
+static bool phDnldNfc_MkImgAddSect(const phDnldNfc_MkImgSeq_t* pSeq,
+                                   std::vector<uint8_t>* pImg,
+                                   phDnldNfc_ImgSect_t* pSect) {
+  std::vector<phDnldNfc_ImgFrame_t> frames;
+  uint32_t dwOffset = 0;
+
+  while (dwOffset < pSeq->wSeqLen) {
+    phDnldNfc_ImgFrame_t frame;
+    if ((pSeq->wSeqLen - dwOffset) < PHDNLDNFC_FRAME_HDR_LEN) return false;
+    frame.dwOffset = dwOffset;
+    frame.wLen = ((uint16_t)pSeq->pSeq[dwOffset] << 8U) |
+                 pSeq->pSeq[dwOffset + 1];
+    if ((0 == frame.wLen) ||
+        ((pSeq->wSeqLen - dwOffset - PHDNLDNFC_FRAME_HDR_LEN) < frame.wLen)) {
+      return false;
+    }
+    frame.wCrc = phDnldNfc_CalcCrc16((uint8_t*)&pSeq->pSeq[dwOffset],
+                                     PHDNLDNFC_FRAME_HDR_LEN + frame.wLen);
+    frames.push_back(frame);
+    dwOffset += PHDNLDNFC_FRAME_HDR_LEN + frame.wLen;
+  }
+  if (pSeq->wSeqLen < 6U) return false;
+
+  pSect->wType = (uint16_t)pSeq->eType;
+  pSect->wFwVer = ((uint16_t)pSeq->pSeq[5] << 8U) | pSeq->pSeq[4];
+  pSect->dwDataOffset = pImg->size();
+  pSect->dwDataLen = pSeq->wSeqLen;
+  pImg->insert(pImg->end(), pSeq->pSeq, pSeq->pSeq + pSeq->wSeqLen);
+  pImg->resize((pImg->size() + 3U) & ~3U, 0);
+  pSect->dwFrameOffset = pImg->size();
+  pSect->dwNbFrames = frames.size();
+  pImg->insert(pImg->end(), (const uint8_t*)frames.data(),
+               (const uint8_t*)(frames.data() + frames.size()));
+  return true;
+}
+
+int main(int argc, char** argv) {
+  phDnldNfc_MkImgSeq_t aSeqs[] = {
+      {phDnldNfc_ImgSectFw, "gphDnldNfc_DlSeq", "gphDnldNfc_DlSeqSz", NULL,
+       0},
+      {phDnldNfc_ImgSectDummy, "gphDnldNfc_DummyDlSeq",
+       "gphDnldNfc_DlSeqDummyFwSz", NULL, 0}};
+  const size_t nbSeqs = sizeof(aSeqs) / sizeof(aSeqs[0]);
+  std::vector<phDnldNfc_ImgSect_t> sects;
+  std::vector<uint8_t> img;
+  phDnldNfc_ImgHdr_t hdr;
+  int chipType = -1;
+  size_t i;
+
+  if (argc != 4) {
+    fprintf(stderr, "usage: %s <chip type> <firmware library> <container>\n",
+            argv[0]);
+    return 1;
+  }
+  for (i = 1; i < sizeof(aChipNames) / sizeof(aChipNames[0]); i++) {
+    if (0 == strcasecmp(argv[1], aChipNames[i])) chipType = (int)i;
+  }
+  if (chipType < 0) {
+    fprintf(stderr, "unknown chip type %s\n", argv[1]);
+    return 1;
+  }
+
+  void* pLib = dlopen(argv[2], RTLD_NOW);
+  if (NULL == pLib) {
+    fprintf(stderr, "unable to load %s: %s\n", argv[2], dlerror());
+    return 1;
+  }
+  for (i = 0; i < nbSeqs; i++) {
+    if (phDnldNfc_MkImgGetSeq(pLib, &aSeqs[i])) sects.emplace_back();
+  }
+  if (sects.empty()) {
+    fprintf(stderr, "%s exports no download sequence\n", argv[2]);
+    dlclose(pLib);
+    return 1;
+  }
+
+  img.resize(sizeof(phDnldNfc_ImgHdr_t) +
+             (sects.size() * sizeof(phDnldNfc_ImgSect_t)));
+  std::vector<phDnldNfc_ImgSect_t>::iterator sect = sects.begin();
+  for (i = 0; i < nbSeqs; i++) {
+    if (NULL == aSeqs[i].pSeq) continue;
+    if (!phDnldNfc_MkImgAddSect(&aSeqs[i], &img, &(*sect))) {
+      fprintf(stderr, "invalid sequence %s\n", aSeqs[i].pSeqSym);
+      dlclose(pLib);
+      return 1;
+    }
+    printf("%s: FW version %04x, %u bytes, %u frames\n", aSeqs[i].pSeqSym,
+           sect->wFwVer, sect->dwDataLen, sect->dwNbFrames);
+    ++sect;
+  }
+  dlclose(pLib);
+
+  memcpy(&img[sizeof(phDnldNfc_ImgHdr_t)], sects.data(),
+         sects.size() * sizeof(phDnldNfc_ImgSect_t));
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.dwMagic = PHDNLDNFC_IMG_MAGIC;
+  hdr.wFormatVer = PHDNLDNFC_IMG_FORMAT_VER;
+  hdr.wNbSections = sects.size();
+  hdr.wChipType = (uint16_t)chipType;
+  hdr.dwImgLen = img.size();
+  hdr.dwImgCrc32 =
+      sparse_crc32(0, &img[sizeof(hdr)], img.size() - sizeof(hdr));
+  memcpy(&img[0], &hdr, sizeof(hdr));
+
+  FILE* pFile = fopen(argv[3], "wb");
+  if ((NULL == pFile) || (fwrite(img.data(), 1, img.size(), pFile) !=
+                          img.size())) {
+    fprintf(stderr, "unable to write %s\n", argv[3]);
+    if (NULL != pFile) fclose(pFile);
+    return 1;
+  }
+  if (0 != fclose(pFile)) {
+    fprintf(stderr, "unable to write %s\n", argv[3]);
+    return 1;
+  }
+  printf("%s: %zu bytes for %s\n", argv[3], img.size(), aChipNames[chipType]);
+  return 0;
+}
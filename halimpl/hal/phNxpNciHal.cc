@@ -15,6 +15,8 @@
  */
 
 #include <android-base/file.h>
+#include <memory>
+#include <mutex>
 #include <sys/stat.h>
 #include <phNxpNciHal.h>
 #include <phNxpNciHal_ext.h>
@@ -28,6 +30,8 @@
 #include <phNxpConfig.h>
 #include <phNxpNciHal_NfcDepSWPrio.h>
 #include <phTmlNfc_i2c.h>
+#include <phNxpNciHal_latency.h>
+#include <phNxpNciHal_cfgdiff.h>
 #include "phNxpNciHal_nciParser.h"
 #include <EseAdaptation.h>
 #include "hal_nxpnfc.h"
@@ -117,6 +121,14 @@ phNxpNciClock_t phNxpNciClock = {0, {0}};
 
 phNxpNciRfSetting_t phNxpNciRfSet = {false, {0}};
 
+/* Vendor configs built from the config of the given generation */
+static std::mutex sConfigCacheLock;
+static std::shared_ptr<const NfcConfig> spVendorConfig;
+static uint32_t sVendorConfigGeneration;
+static nxp_nfc_config_t sNxpConfig;
+static bool sNxpConfigValid = false;
+static uint32_t sNxpConfigGeneration;
+
 /**************** local methods used in this file only ************************/
 static NFCSTATUS phNxpNciHal_fw_download(void);
 tNFC_chipType phNxpNciHal_getChipType(void);
@@ -145,6 +157,9 @@ static NFCSTATUS phNxpNciHal_set_Boot_Mode(uint8_t mode);
 NFCSTATUS phNxpNciHal_set_china_region_configs(void);
 static void phNxpNciHal_configNciParser(void);
 static void phNxpNciHal_initialize_debug_enabled_flag();
+static void phNxpNciHal_initialize_read_streaming();
+static phLibNfc_eConfigLinkType phNxpNciHal_get_link_type(char* nfc_dev_node,
+                                                          uint16_t max_len);
 static NFCSTATUS phNxpNciHalRFConfigCmdRecSequence();
 static NFCSTATUS phNxpNciHal_CheckRFCmdRespStatus();
 static NFCSTATUS phNxpNciHal_uicc_baud_rate();
@@ -178,6 +193,48 @@ static void phNxpNciHal_initialize_debug_enabled_flag() {
   NXPLOG_NCIHAL_D("nfc_debug_enabled : %d",nfc_debug_enabled);
 
 }
+
+/******************************************************************************
+ * Function         phNxpNciHal_initialize_read_streaming
+ *
+ * Description      This function configures TML streaming read mode as per
+ *                  NXP_TML_READ_STREAMING_DEPTH. Disabled if not configured.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void phNxpNciHal_initialize_read_streaming() {
+  unsigned long num = 0;
+  if (!GetNxpNumValue(NAME_NXP_TML_READ_STREAMING_DEPTH, &num, sizeof(num))) {
+    num = 0;
+  }
+  NXPLOG_NCIHAL_D("TML read streaming depth : %lu", num);
+  phTmlNfc_ConfigReadStreaming((num > 0xFF) ? 0xFF : (uint8_t)num);
+}
+
+/******************************************************************************
+ * Function         phNxpNciHal_get_link_type
+ *
+ * Description      This function selects the TML transport as per
+ *                  NXP_TML_TRANSPORT. For the NFCC simulator nfc_dev_node is
+ *                  replaced by the NXP_TML_SIM_SCRIPT path (empty if unset).
+ *
+ * Returns          link type to be used by TML
+ *
+ ******************************************************************************/
+static phLibNfc_eConfigLinkType phNxpNciHal_get_link_type(char* nfc_dev_node,
+                                                          uint16_t max_len) {
+  unsigned long num = 0;
+  if (!GetNxpNumValue(NAME_NXP_TML_TRANSPORT, &num, sizeof(num)) ||
+      (num != 0x01)) {
+    return ENUM_LINK_TYPE_I2C; /* For PN54X */
+  }
+  if (!GetNxpStrValue(NAME_NXP_TML_SIM_SCRIPT, nfc_dev_node, max_len)) {
+    nfc_dev_node[0] = '\0';
+  }
+  NXPLOG_NCIHAL_D("TML transport : NFCC simulator, script : %s", nfc_dev_node);
+  return ENUM_LINK_TYPE_SIM;
+}
 //static tNfc_featureList phNxpNciHal_getFeatureList();
 /******************************************************************************
  * Function         phNxpNciHal_client_thread
@@ -203,6 +260,7 @@ static void* phNxpNciHal_client_thread(void* arg) {
       NXPLOG_NCIHAL_E("NFC client received bad message");
       continue;
     }
+    phNxpNciHal_latency_dequeued();
 
     if (p_nxpncihal_ctrl->thread_running == 0) {
       break;
@@ -293,6 +351,8 @@ static void* phNxpNciHal_client_thread(void* arg) {
                                                    nxpncihal_ctrl.p_rsp_data);
         }
         REENTRANCE_UNLOCK();
+        /* Persist the config values dropped by the command answered */
+        phNxpNciHal_cfgdiff_flush();
         break;
       }
       case NCI_HAL_POST_MIN_INIT_CPLT_MSG: {
@@ -466,6 +526,8 @@ static NFCSTATUS phNxpNciHal_fw_download(void) {
   int fw_retry_count = 0;
   NFCSTATUS status = NFCSTATUS_REJECTED;
   NXPLOG_NCIHAL_D("Starting FW update");
+  /* Download module expects a single read per request */
+  phTmlNfc_ConfigReadStreaming(0);
   do {
     fw_download_success = 0;
     // phNxpNciHal_get_clk_freq();
@@ -518,6 +580,7 @@ static NFCSTATUS phNxpNciHal_fw_download(void) {
 
   /*Keep Read Pending on I2C*/
   NFCSTATUS readRestoreStatus = NFCSTATUS_FAILED;
+  phNxpNciHal_initialize_read_streaming();
   readRestoreStatus = phTmlNfc_Read(
       nxpncihal_ctrl.p_cmd_data, NCI_MAX_DATA_LEN,
       (pphTmlNfc_TransactCompletionCb_t)&phNxpNciHal_read_complete, NULL);
@@ -762,7 +825,6 @@ int phNxpNciHal_MinInit(nfc_stack_callback_t* p_cback,
 
   /* Configure hardware link */
   nxpncihal_ctrl.gDrvCfg.nClientId = phDal4Nfc_msgget(0, 0600);
-  nxpncihal_ctrl.gDrvCfg.nLinkType = ENUM_LINK_TYPE_I2C; /* For PN54X */
   nxpncihal_ctrl.hal_boot_mode = boot_mode;
 
   /*Get the device node name from config file*/
@@ -782,6 +844,9 @@ int phNxpNciHal_MinInit(nfc_stack_callback_t* p_cback,
     strcpy(nfc_dev_node, "/dev/pn54x");
   }
 
+  nxpncihal_ctrl.gDrvCfg.nLinkType =
+      phNxpNciHal_get_link_type(nfc_dev_node, max_len);
+  tTmlConfig.eLinkType = nxpncihal_ctrl.gDrvCfg.nLinkType;
   tTmlConfig.pDevName = (int8_t*)nfc_dev_node;
 
   tOsalConfig.dwCallbackThreadId = (uintptr_t)nxpncihal_ctrl.gDrvCfg.nClientId;
@@ -945,7 +1010,9 @@ int phNxpNciHal_MinOpen() {
 
   /* Configure hardware link */
   nxpncihal_ctrl.gDrvCfg.nClientId = phDal4Nfc_msgget(0, 0600);
-  nxpncihal_ctrl.gDrvCfg.nLinkType = ENUM_LINK_TYPE_I2C; /* For PN54X */
+  nxpncihal_ctrl.gDrvCfg.nLinkType =
+      phNxpNciHal_get_link_type(nfc_dev_node, max_len);
+  tTmlConfig.eLinkType = nxpncihal_ctrl.gDrvCfg.nLinkType;
   tTmlConfig.pDevName = (int8_t*)nfc_dev_node;
   tOsalConfig.dwCallbackThreadId = (uintptr_t)nxpncihal_ctrl.gDrvCfg.nClientId;
   tOsalConfig.pLogFile = NULL;
@@ -957,6 +1024,13 @@ int phNxpNciHal_MinOpen() {
     NXPLOG_NCIHAL_E("phTmlNfc_Init Failed");
     goto minCleanAndreturn;
   } else {
+    phNxpNciHal_initialize_read_streaming();
+    unsigned long coalesced_read = 0;
+    if (!GetNxpNumValue(NAME_NXP_I2C_COALESCED_READ, &coalesced_read,
+                        sizeof(coalesced_read))) {
+      coalesced_read = 0;
+    }
+    phTmlNfc_i2c_set_coalesced_read((coalesced_read == 0x01) ? true : false);
     if (nfc_dev_node != NULL) {
       free(nfc_dev_node);
       nfc_dev_node = NULL;
@@ -1063,6 +1137,8 @@ init_retry:
     }
   }
 
+  /* apply config file updates, e.g. a new transit config, while open */
+  startNxpConfigWatcher();
   phNxpNciHal_MinOpen_complete(wConfigStatus);
   NXPLOG_NCIHAL_D("phNxpNciHal_MinOpen(): exit");
   return wConfigStatus;
@@ -1244,6 +1320,8 @@ int phNxpNciHal_write(uint16_t data_len, const uint8_t* p_data) {
   NFCSTATUS status = NFCSTATUS_FAILED;
   static phLibNfc_Message_t msg;
 
+  phNxpNciHal_latency_mark(PH_NXPNCIHAL_LAT_HAL_WRITE, p_data, data_len);
+
   CONCURRENCY_LOCK();
 
   if (nxpncihal_ctrl.halStatus != HAL_STATUS_OPEN) {
@@ -1325,6 +1403,14 @@ int phNxpNciHal_write_unlocked(uint16_t data_len, const uint8_t* p_data) {
   memcpy(nxpncihal_ctrl.p_cmd_data, p_data, data_len);
   nxpncihal_ctrl.cmd_len = data_len;
 
+  /* The NFCC no longer holds the values last applied by the config */
+  if (data_len > 1 && p_data[0] == 0x20 && p_data[1] == 0x02) {
+    phNxpNciHal_cfgdiff_written(p_data, data_len);
+  } else if (data_len > 3 && p_data[0] == 0x20 && p_data[1] == 0x00 &&
+             p_data[3] == 0x01) {
+    /* CORE_RESET_CMD with Reset Configuration */
+    phNxpNciHal_cfgdiff_reset();
+  }
 
   /* check for write synchronyztion */
   if(phNxpNciHal_check_ncicmd_write_window(nxpncihal_ctrl.cmd_len,
@@ -1469,6 +1555,8 @@ static void phNxpNciHal_read_complete(void* pContext,
 
   if (pInfo->wStatus == NFCSTATUS_SUCCESS) {
     NXPLOG_NCIHAL_D("read successful status = 0x%x", pInfo->wStatus);
+    phNxpNciHal_latency_mark(PH_NXPNCIHAL_LAT_DEQUEUE, pInfo->pBuff,
+                             pInfo->wLength);
 
     sem_getvalue(&(nxpncihal_ctrl.syncSpiNfc), &sem_val);
     if (((pInfo->pBuff[0] & NCI_MT_MASK) == NCI_MT_RSP) && sem_val == 0) {
@@ -1498,6 +1586,11 @@ static void phNxpNciHal_read_complete(void* pContext,
         (nxpncihal_ctrl.p_rx_data[0x03] == 0x02))) {
       nxpncihal_ctrl.ext_cb_data.status = NFCSTATUS_SUCCESS;
       SEM_POST(&(nxpncihal_ctrl.ext_cb_data));
+    } else if ((nxpncihal_ctrl.hal_ext_enabled == TRUE) &&
+               ((nxpncihal_ctrl.p_rx_data[0x00] & NCI_MT_MASK) == NCI_MT_RSP) &&
+               phNxpNciHal_ext_batch_rsp(status, nxpncihal_ctrl.p_rx_data,
+                                         nxpncihal_ctrl.rx_data_len)) {
+      /* Next command of the batch sent, submitter is woken up at the end */
     } else if (nxpncihal_ctrl.hal_ext_enabled == TRUE && /* Check if response should go to hal module only */
             ((nxpncihal_ctrl.p_rx_data[0x00] & NCI_MT_MASK) == NCI_MT_RSP ||
              ((icode_detected == true) && (icode_send_eof == 3)))) {
@@ -1522,6 +1615,8 @@ static void phNxpNciHal_read_complete(void* pContext,
              (status == NFCSTATUS_SUCCESS)) {
       (*nxpncihal_ctrl.p_nfc_stack_data_cback)(nxpncihal_ctrl.rx_data_len,
                                                nxpncihal_ctrl.p_rx_data);
+      phNxpNciHal_latency_mark(PH_NXPNCIHAL_LAT_STACK_CB, pInfo->pBuff,
+                               pInfo->wLength);
     }
   } else {
     NXPLOG_NCIHAL_E("read error status = 0x%x", pInfo->wStatus);
@@ -1530,9 +1625,12 @@ static void phNxpNciHal_read_complete(void* pContext,
   if (nxpncihal_ctrl.halStatus == HAL_STATUS_CLOSE &&
     nxpncihal_ctrl.nci_info.wait_for_ntf == FALSE) {
     NXPLOG_NCIHAL_E(" Ignoring read , HAL close triggered");
+    /* Stop reader thread in case of streaming read */
+    phTmlNfc_ReadAbort();
     return;
   }
-  /* Read again because read must be pending always.*/
+  /* Read again because read must be pending always.
+   * In TML streaming read mode this only keeps the callback registered */
   status = phTmlNfc_Read(
       Rx_data, NCI_MAX_DATA_LEN,
       (pphTmlNfc_TransactCompletionCb_t)&phNxpNciHal_read_complete, NULL);
@@ -1632,6 +1730,8 @@ int phNxpNciHal_core_initialized(uint8_t* p_core_init_rsp_params) {
   retry_core_init:
     *p_core_init_rsp_params = init_param;
     config_access = false;
+    /* Config session interrupted by the recovery */
+    phNxpNciHal_cfgdiff_end();
     if (mGetCfg_info != NULL) {
       mGetCfg_info->isGetcfg = false;
     }
@@ -1936,28 +2036,89 @@ int phNxpNciHal_core_initialized(uint8_t* p_core_init_rsp_params) {
       if(nfcFL.chipType != pn547C2) {
           config_access = false;
       }
-      uint8_t numOfBlocks = sizeof(RF_BLOCK_LIST)/sizeof(RF_BLOCK_LIST[0]);
+      const uint8_t numOfBlocks = sizeof(RF_BLOCK_LIST)/sizeof(RF_BLOCK_LIST[0]);
+      phNxpNciHal_ExtCmd_t rf_blk_cmds[numOfBlocks];
+      uint8_t rf_blk_ids[numOfBlocks];
+      int rf_blk_diff[numOfBlocks];
+      uint8_t numOfRfBlocks = 0;
+      uint8_t numOfCmds = 0;
+      const uint8_t* p_conf = NULL;
+      uint16_t conf_len = 0;
+      int core_conf_extn_diff = -1;
+      int core_conf_diff = -1;
+      /* Only the parameters whose value differs from the one last applied
+       * to the NFCC are sent, unless everything has to be set again */
+      phNxpNciHal_cfgdiff_begin(wFwVer,
+                                (true == fw_download_success) ||
+                                    (true == setConfigAlways));
       for(int i=0; i< numOfBlocks; i++)
       {
+        const uint8_t* p_rf_blk = NULL;
         retlen = 0;
-        NXPLOG_NCIHAL_D("Performing RF Settings BLK %u", i+1);
-        isfound = GetNxpByteArrayValue(RF_BLOCK_LIST[i], (char*)buffer,
-                                       bufflen, &retlen);
-        if (retlen > 0) {
-          status = phNxpNciHal_send_ext_cmd(retlen, buffer);
-          if ((nfcFL.chipType != pn547C2) && (status == NFCSTATUS_SUCCESS)) {
-              status = phNxpNciHal_CheckRFCmdRespStatus();
-              /*STATUS INVALID PARAM 0x09*/
-              if (status == 0x09) {
-                  phNxpNciHalRFConfigCmdRecSequence();
-                  //NXP_NCI_HAL_CORE_INIT_RECOVER(retry_core_init_cnt, retry_core_init);
-                  break;
-              }
-          } else if (status != NFCSTATUS_SUCCESS) {
-              NXPLOG_NCIHAL_E("RF Settings BLK %u failed", i+1);
-              //NXP_NCI_HAL_CORE_INIT_RECOVER(retry_core_init_cnt, retry_core_init);
-              break;
-          }
+        isfound = GetNxpByteArrayValuePtr(RF_BLOCK_LIST[i], &p_rf_blk, &retlen);
+        if (isfound && retlen > 0 && retlen <= bufflen) {
+          rf_blk_ids[numOfRfBlocks] = i + 1;
+          rf_blk_diff[numOfRfBlocks++] =
+              phNxpNciHal_cfgdiff_add(p_rf_blk, retlen);
+        }
+      }
+      retlen = 0;
+      if (GetNxpByteArrayValuePtr(NAME_NXP_CORE_CONF_EXTN, &p_conf, &retlen) &&
+          retlen > 0 && retlen <= bufflen) {
+        core_conf_extn_diff = phNxpNciHal_cfgdiff_add(p_conf, retlen);
+      }
+      retlen = 0;
+      if (GetNxpByteArrayValuePtr(NAME_NXP_CORE_CONF, &p_conf, &retlen) &&
+          retlen > 0 && retlen <= bufflen) {
+        core_conf_diff = phNxpNciHal_cfgdiff_add(p_conf, retlen);
+      }
+      phNxpNciHal_cfgdiff_prepare();
+
+      /* All the RF blocks are sent as one batch, straight from the config */
+      for(int i=0; i< numOfRfBlocks; i++)
+      {
+        const uint8_t* p_rf_cmd = phNxpNciHal_cfgdiff_cmd(rf_blk_diff[i],
+                                                          &conf_len);
+        if (p_rf_cmd != NULL) {
+          NXPLOG_NCIHAL_D("Performing RF Settings BLK %u", rf_blk_ids[i]);
+          rf_blk_cmds[numOfCmds].cmd_len = conf_len;
+          rf_blk_cmds[numOfCmds].p_cmd = p_rf_cmd;
+          rf_blk_ids[numOfCmds] = rf_blk_ids[i];
+          rf_blk_diff[numOfCmds++] = rf_blk_diff[i];
+        }
+      }
+      status = NFCSTATUS_SUCCESS;
+      if (numOfCmds > 0) {
+        /* Only STATUS INVALID PARAM stops the blocks, see below */
+        phNxpNciHal_send_ext_cmd_batch(
+            rf_blk_cmds, numOfCmds,
+            (nfcFL.chipType != pn547C2) ? 0x09 : PH_NXPNCIHAL_EXT_BATCH_NO_RSP);
+      }
+      for(int i=0; i< numOfCmds; i++)
+      {
+        status = rf_blk_cmds[i].status;
+        phNxpNciHal_cfgdiff_applied(
+            rf_blk_diff[i], (status == NFCSTATUS_SUCCESS) &&
+                                (rf_blk_cmds[i].rsp_status == NFCSTATUS_SUCCESS));
+        if ((nfcFL.chipType != pn547C2) && (status == NFCSTATUS_SUCCESS)) {
+            /*STATUS INVALID PARAM 0x09*/
+            if (rf_blk_cmds[i].rsp_status == 0x09) {
+                status = 0x09;
+                /* the recovery may leave the NFCC with any configuration */
+                phNxpNciHal_cfgdiff_reset();
+                phNxpNciHalRFConfigCmdRecSequence();
+                //NXP_NCI_HAL_CORE_INIT_RECOVER(retry_core_init_cnt, retry_core_init);
+                break;
+            } else if (rf_blk_cmds[i].rsp_status != NFCSTATUS_SUCCESS) {
+                /* the next blocks are still sent, the last one decides */
+                NXPLOG_NCIHAL_E("RF Settings BLK %u rejected 0x%x",
+                                rf_blk_ids[i], rf_blk_cmds[i].rsp_status);
+                status = NFCSTATUS_FAILED;
+            }
+        } else if (status != NFCSTATUS_SUCCESS) {
+            NXPLOG_NCIHAL_E("RF Settings BLK %u failed", rf_blk_ids[i]);
+            //NXP_NCI_HAL_CORE_INIT_RECOVER(retry_core_init_cnt, retry_core_init);
+            break;
         }
       }
       if(status != NFCSTATUS_SUCCESS)
@@ -1969,11 +2130,15 @@ int phNxpNciHal_core_initialized(uint8_t* p_core_init_rsp_params) {
       }
 
       NXPLOG_NCIHAL_D("Performing NAME_NXP_CORE_CONF_EXTN Settings");
-      isfound = GetNxpByteArrayValue(NAME_NXP_CORE_CONF_EXTN, (char*)buffer,
-                                     bufflen, &retlen);
-      if (retlen > 0) {
+      p_conf = phNxpNciHal_cfgdiff_cmd(core_conf_extn_diff, &conf_len);
+      if (p_conf != NULL) {
+        memcpy(buffer, p_conf, conf_len);
         /* NXP ACT Proprietary Ext */
-        status = phNxpNciHal_send_ext_cmd(retlen, buffer);
+        status = phNxpNciHal_send_ext_cmd(conf_len, buffer);
+        phNxpNciHal_cfgdiff_applied(
+            core_conf_extn_diff,
+            (status == NFCSTATUS_SUCCESS) &&
+                (nxpncihal_ctrl.p_rx_data[3] == NFCSTATUS_SUCCESS));
         if (status != NFCSTATUS_SUCCESS) {
           NXPLOG_NCIHAL_E("NXP Core configuration failed");
           NXP_NCI_HAL_CORE_INIT_RECOVER(retry_core_init_cnt, retry_core_init);
@@ -1981,17 +2146,21 @@ int phNxpNciHal_core_initialized(uint8_t* p_core_init_rsp_params) {
       }
 
       NXPLOG_NCIHAL_D("Performing NAME_NXP_CORE_CONF Settings");
-      retlen = 0;
-      isfound = GetNxpByteArrayValue(NAME_NXP_CORE_CONF, (char*)buffer, bufflen,
-                                     &retlen);
-      if (retlen > 0) {
+      p_conf = phNxpNciHal_cfgdiff_cmd(core_conf_diff, &conf_len);
+      if (p_conf != NULL) {
+        memcpy(buffer, p_conf, conf_len);
         /* NXP ACT Proprietary Ext */
-        status = phNxpNciHal_send_ext_cmd(retlen, buffer);
+        status = phNxpNciHal_send_ext_cmd(conf_len, buffer);
+        phNxpNciHal_cfgdiff_applied(
+            core_conf_diff,
+            (status == NFCSTATUS_SUCCESS) &&
+                (nxpncihal_ctrl.p_rx_data[3] == NFCSTATUS_SUCCESS));
         if (status != NFCSTATUS_SUCCESS) {
           NXPLOG_NCIHAL_E("Core Set Config failed");
           NXP_NCI_HAL_CORE_INIT_RECOVER(retry_core_init_cnt, retry_core_init);
         }
       }
+      phNxpNciHal_cfgdiff_end();
     }
 
   if ((true == fw_download_success) || (true == setConfigAlways)
@@ -2405,6 +2574,7 @@ int phNxpNciHal_core_initialized(uint8_t* p_core_init_rsp_params) {
     free(buffer);
     buffer = NULL;
   }
+  phNxpNciHal_cfgdiff_flush();
   config_access = false;
 
   if(nfcFL.chipType != pn547C2) {
@@ -2881,6 +3051,8 @@ close_and_return:
 
   CONCURRENCY_UNLOCK();
 
+  phNxpNciHal_cfgdiff_flush();
+  stopNxpConfigWatcher();
   phNxpNciHal_cleanup_monitor();
   write_unlocked_status = NFCSTATUS_SUCCESS;
   phNxpNciHal_release_info();
@@ -2933,6 +3105,8 @@ int phNxpNciHal_Minclose(void) {
 
   CONCURRENCY_UNLOCK();
 
+  phNxpNciHal_cfgdiff_flush();
+  stopNxpConfigWatcher();
   phNxpNciHal_cleanup_monitor();
 
   write_unlocked_status = NFCSTATUS_SUCCESS;
@@ -2986,148 +3160,170 @@ int phNxpNciHal_configDiscShutdown(void) {
 }
 
 /******************************************************************************
- * Function         phNxpNciHal_getNxp
+ * Function         phNxpNciHal_buildNxpConfig
  *
- * Description      This function can be used by HAL to inform
- *                 to update vendor configuration parametres
+ * Description      This function reads the NXP vendor configuration
+ *                  parameters from the config
  *
  * Returns          void.
  *
  ******************************************************************************/
-void phNxpNciHal_getNxpConfig(nfc_nci_IoctlInOutData_t *pInpOutData) {
+static void phNxpNciHal_buildNxpConfig(nxp_nfc_config_t* pNxpConfig) {
   unsigned long num = 0;
-  memset(&pInpOutData->out.data.nxpConfigs, 0x00, sizeof(pInpOutData->out.data.nxpConfigs));
+  memset(pNxpConfig, 0x00, sizeof(*pNxpConfig));
   if (GetNxpNumValue(NAME_NXP_ESE_LISTEN_TECH_MASK, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.ese_listen_tech_mask = num;
+    pNxpConfig->ese_listen_tech_mask = num;
   }else {
-    pInpOutData->out.data.nxpConfigs.ese_listen_tech_mask = 0x07;
+    pNxpConfig->ese_listen_tech_mask = 0x07;
   }
   if (GetNxpNumValue(NAME_NXP_DEFAULT_NFCEE_DISC_TIMEOUT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.default_nfcee_disc_timeout = num;
+    pNxpConfig->default_nfcee_disc_timeout = num;
   }
   if (GetNxpNumValue(NAME_NXP_DEFAULT_NFCEE_TIMEOUT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.default_nfcee_timeout = num;
+    pNxpConfig->default_nfcee_timeout = num;
   }
   if (GetNxpNumValue(NAME_NXP_ESE_WIRED_PRT_MASK, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.ese_wired_prt_mask = num;
+    pNxpConfig->ese_wired_prt_mask = num;
   }
   if (GetNxpNumValue(NAME_NXP_UICC_WIRED_PRT_MASK, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.uicc_wired_prt_mask = num;
+    pNxpConfig->uicc_wired_prt_mask = num;
   }
   if (GetNxpNumValue(NAME_NXP_WIRED_MODE_RF_FIELD_ENABLE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.wired_mode_rf_field_enable = num;
+    pNxpConfig->wired_mode_rf_field_enable = num;
   }
   if (GetNxpNumValue(NAME_AID_BLOCK_ROUTE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.aid_block_route = num;
+    pNxpConfig->aid_block_route = num;
   }
   if (GetNxpNumValue(NAME_NXP_ESE_POWER_DH_CONTROL, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.esePowerDhControl = num;
+    pNxpConfig->esePowerDhControl = num;
   }
   if (GetNxpNumValue(NAME_NXP_SWP_RD_TAG_OP_TIMEOUT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.tagOpTimeout = num;
+    pNxpConfig->tagOpTimeout = num;
   }
   if (GetNxpNumValue(NAME_NXP_LOADER_SERICE_VERSION, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.loaderServiceVersion = num;
+    pNxpConfig->loaderServiceVersion = num;
   }
   if (GetNxpNumValue(NAME_NXP_DEFAULT_NFCEE_DISC_TIMEOUT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.defaultNfceeDiscTimeout = num;
+    pNxpConfig->defaultNfceeDiscTimeout = num;
   }
   if (GetNxpNumValue(NAME_NXP_DUAL_UICC_ENABLE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.dualUiccEnable = num;
+    pNxpConfig->dualUiccEnable = num;
   }
   if (GetNxpNumValue(NAME_NXP_CE_ROUTE_STRICT_DISABLE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.ceRouteStrictDisable = num;
+    pNxpConfig->ceRouteStrictDisable = num;
   }
   if (GetNxpNumValue(NAME_OS_DOWNLOAD_TIMEOUT_VALUE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.osDownloadTimeoutValue = num;
+    pNxpConfig->osDownloadTimeoutValue = num;
   }
   if (GetNxpNumValue(NAME_NXP_DEFAULT_SE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nxpDefaultSe = num;
+    pNxpConfig->nxpDefaultSe = num;
   }
   if (GetNxpNumValue(NAME_DEFAULT_AID_ROUTE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.defaultAidRoute = num;
+    pNxpConfig->defaultAidRoute = num;
   }
   if (GetNxpNumValue(NAME_DEFAULT_AID_PWR_STATE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.defaultAidPwrState = num;
+    pNxpConfig->defaultAidPwrState = num;
   }
   if (GetNxpNumValue(NAME_DEFAULT_ROUTE_PWR_STATE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.defaultRoutePwrState = num;
+    pNxpConfig->defaultRoutePwrState = num;
   }
   if (GetNxpNumValue(NAME_DEFAULT_OFFHOST_PWR_STATE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.defaultOffHostPwrState = num;
+    pNxpConfig->defaultOffHostPwrState = num;
   }
   if (GetNxpNumValue(NAME_NXP_JCOPDL_AT_BOOT_ENABLE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.jcopDlAtBootEnable = num;
+    pNxpConfig->jcopDlAtBootEnable = num;
   }
   if (GetNxpNumValue(NAME_NXP_DEFAULT_NFCEE_TIMEOUT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.defaultNfceeTimeout = num;
+    pNxpConfig->defaultNfceeTimeout = num;
   }
   if (GetNxpNumValue(NAME_NXP_NFC_CHIP, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nxpNfcChip = num;
+    pNxpConfig->nxpNfcChip = num;
   }
   if (GetNxpNumValue(NAME_NXP_CORE_SCRN_OFF_AUTONOMOUS_ENABLE, &num,
                      sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.coreScrnOffAutonomousEnable = num;
+    pNxpConfig->coreScrnOffAutonomousEnable = num;
   }
   if (GetNxpNumValue(NAME_NXP_P61_LS_DEFAULT_INTERFACE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.p61LsDefaultInterface = num;
+    pNxpConfig->p61LsDefaultInterface = num;
   }
   if (GetNxpNumValue(NAME_NXP_P61_JCOP_DEFAULT_INTERFACE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.p61JcopDefaultInterface = num;
+    pNxpConfig->p61JcopDefaultInterface = num;
   }
   if (GetNxpNumValue(NAME_NXP_AGC_DEBUG_ENABLE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.agcDebugEnable = num;
+    pNxpConfig->agcDebugEnable = num;
   }
   if (GetNxpNumValue(NAME_DEFAULT_FELICA_CLT_PWR_STATE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.felicaCltPowerState = num;
+    pNxpConfig->felicaCltPowerState = num;
   } else {
-    pInpOutData->out.data.nxpConfigs.felicaCltPowerState = 0x3F;
+    pNxpConfig->felicaCltPowerState = 0x3F;
   }
   if (GetNxpNumValue(NAME_NXP_HCEF_CMD_RSP_TIMEOUT_VALUE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.cmdRspTimeoutValue = num;
+    pNxpConfig->cmdRspTimeoutValue = num;
   }
   if (GetNxpNumValue(NAME_CHECK_DEFAULT_PROTO_SE_ID, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.checkDefaultProtoSeId = num;
+    pNxpConfig->checkDefaultProtoSeId = num;
   }
   if (GetNxpNumValue(NAME_NXP_NFCC_PASSIVE_LISTEN_TIMEOUT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nfccPassiveListenTimeout = num;
+    pNxpConfig->nfccPassiveListenTimeout = num;
   }
   if (GetNxpNumValue(NAME_NXP_NFCC_STANDBY_TIMEOUT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nfccStandbyTimeout = num;
+    pNxpConfig->nfccStandbyTimeout = num;
   }
   if (GetNxpNumValue(NAME_NXP_WM_MAX_WTX_COUNT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.wmMaxWtxCount = num;
+    pNxpConfig->wmMaxWtxCount = num;
   }
   if (GetNxpNumValue(NAME_NXP_NFCC_RF_FIELD_EVENT_TIMEOUT, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nfccRfFieldEventTimeout = num;
+    pNxpConfig->nfccRfFieldEventTimeout = num;
   }
   if (GetNxpNumValue(NAME_NXP_ALLOW_WIRED_IN_MIFARE_DESFIRE_CLT, &num,
                      sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.allowWiredInMifareDesfireClt = num;
+    pNxpConfig->allowWiredInMifareDesfireClt = num;
   }
   if (GetNxpNumValue(NAME_NXP_DWP_INTF_RESET_ENABLE, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.dwpIntfResetEnable = num;
+    pNxpConfig->dwpIntfResetEnable = num;
   }
   if (GetNxpNumValue(NAME_NXPLOG_HAL_LOGLEVEL, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nxpLogHalLoglevel = num;
+    pNxpConfig->nxpLogHalLoglevel = num;
   }
   if (GetNxpNumValue(NAME_NXPLOG_EXTNS_LOGLEVEL, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nxpLogExtnsLogLevel = num;
+    pNxpConfig->nxpLogExtnsLogLevel = num;
   }
   if (GetNxpNumValue(NAME_NXPLOG_TML_LOGLEVEL, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nxpLogTmlLogLevel = num;
+    pNxpConfig->nxpLogTmlLogLevel = num;
   }
   if (GetNxpNumValue(NAME_NXPLOG_FWDNLD_LOGLEVEL, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nxpLogFwDnldLogLevel = num;
+    pNxpConfig->nxpLogFwDnldLogLevel = num;
   }
   if (GetNxpNumValue(NAME_NXPLOG_NCIX_LOGLEVEL, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nxpLogNcixLogLevel = num;
+    pNxpConfig->nxpLogNcixLogLevel = num;
   }
   if (GetNxpNumValue(NAME_NXPLOG_NCIR_LOGLEVEL, &num, sizeof(num))) {
-    pInpOutData->out.data.nxpConfigs.nxpLogNcirLogLevel = num;
+    pNxpConfig->nxpLogNcirLogLevel = num;
   }
 }
 
+/******************************************************************************
+ * Function         phNxpNciHal_getNxp
+ *
+ * Description      This function can be used by HAL to inform
+ *                 to update vendor configuration parametres, built once
+ *                 per config generation
+ *
+ * Returns          void.
+ *
+ ******************************************************************************/
+void phNxpNciHal_getNxpConfig(nfc_nci_IoctlInOutData_t *pInpOutData) {
+  uint32_t generation = getNxpConfigGeneration();
+  std::lock_guard<std::mutex> lock(sConfigCacheLock);
+
+  if (!sNxpConfigValid || sNxpConfigGeneration != generation) {
+    phNxpNciHal_buildNxpConfig(&sNxpConfig);
+    sNxpConfigValid = true;
+    sNxpConfigGeneration = generation;
+  }
+  pInpOutData->out.data.nxpConfigs = sNxpConfig;
+}
+
 /******************************************************************************
  * Function         phNxpNciHal_getNxpTransitConfig
  *
@@ -3148,15 +3344,15 @@ void phNxpNciHal_setNxpTransitConfig(char *transitConfValue) {
   NXPLOG_NCIHAL_D("%s : Exit", __func__);
 }
 /******************************************************************************
- * Function         phNxpNciHal_getVendorConfig
+ * Function         phNxpNciHal_buildVendorConfig
  *
- * Description      This function can be used by HAL to inform
- *                 to update vendor configuration parametres
+ * Description      This function reads the vendor configuration parameters
+ *                  from the config
  *
  * Returns          void.
  *
  ******************************************************************************/
-void phNxpNciHal_getVendorConfig(NfcConfig& config) {
+static void phNxpNciHal_buildVendorConfig(NfcConfig& config) {
   unsigned long num = 0;
   std::array<uint8_t, NXP_MAX_CONFIG_STRING_LEN> buffer;
   buffer.fill(0);
@@ -3215,6 +3411,43 @@ void phNxpNciHal_getVendorConfig(NfcConfig& config) {
   }
 }
 
+/******************************************************************************
+ * Function         phNxpNciHal_getVendorConfigCached
+ *
+ * Description      This function returns the vendor configuration parameters
+ *                  built once per config generation, i.e. until the config
+ *                  is reset or reloaded
+ *
+ * Returns          Vendor configuration, shared with the other callers.
+ *
+ ******************************************************************************/
+std::shared_ptr<const NfcConfig> phNxpNciHal_getVendorConfigCached(void) {
+  /* read first: a reload while building makes the next call rebuild */
+  uint32_t generation = getNxpConfigGeneration();
+  std::lock_guard<std::mutex> lock(sConfigCacheLock);
+
+  if (spVendorConfig == nullptr || sVendorConfigGeneration != generation) {
+    std::shared_ptr<NfcConfig> pConfig = std::make_shared<NfcConfig>();
+    phNxpNciHal_buildVendorConfig(*pConfig);
+    spVendorConfig = pConfig;
+    sVendorConfigGeneration = generation;
+  }
+  return spVendorConfig;
+}
+
+/******************************************************************************
+ * Function         phNxpNciHal_getVendorConfig
+ *
+ * Description      This function can be used by HAL to inform
+ *                 to update vendor configuration parametres
+ *
+ * Returns          void.
+ *
+ ******************************************************************************/
+void phNxpNciHal_getVendorConfig(NfcConfig& config) {
+  config = *phNxpNciHal_getVendorConfigCached();
+}
+
 /******************************************************************************
  * Function         phNxpNciHal_notify_i2c_fragmentation
  *
@@ -3752,6 +3985,36 @@ int phNxpNciHal_ioctl(long arg, void* p_data) {
       phNxpNciHal_reset_nfcee_session(true);
       ret = 0;
       break;
+    case HAL_NFC_IOCTL_GET_LATENCY_STATS:
+      if (NULL != p_data) {
+        pInpOutData->out.data.nciRsp.rsp_len =
+            sizeof(pInpOutData->out.data.nciRsp.p_rsp);
+        ret = phNxpNciHal_latency_get(pInpOutData->inp.data.nciCmd.p_cmd,
+                                      pInpOutData->inp.data.nciCmd.cmd_len,
+                                      pInpOutData->out.data.nciRsp.p_rsp,
+                                      &pInpOutData->out.data.nciRsp.rsp_len);
+      }
+      break;
+    case HAL_NFC_IOCTL_GET_CONFIG_CHANGES:
+      if (NULL != p_data) {
+        pInpOutData->out.data.nciRsp.rsp_len =
+            sizeof(pInpOutData->out.data.nciRsp.p_rsp);
+        getNxpConfigChanges(pInpOutData->out.data.nciRsp.p_rsp,
+                            &pInpOutData->out.data.nciRsp.rsp_len);
+        ret = 0;
+      }
+      break;
+    case HAL_NFC_IOCTL_GET_FW_DNLD_STATS:
+      if (NULL != p_data) {
+        pInpOutData->out.data.nciRsp.rsp_len =
+            sizeof(pInpOutData->out.data.nciRsp.p_rsp);
+        if (NFCSTATUS_SUCCESS ==
+            phDnldNfc_GetBusyStats(pInpOutData->out.data.nciRsp.p_rsp,
+                                   &pInpOutData->out.data.nciRsp.rsp_len)) {
+          ret = 0;
+        }
+      }
+      break;
     default:
       NXPLOG_NCIHAL_E("%s : Wrong arg = %ld", __func__, arg);
       break;
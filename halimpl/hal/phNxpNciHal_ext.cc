@@ -27,6 +27,8 @@
 
 /* Timeout value to wait for response from PN548AD */
 #define HAL_EXTNS_WRITE_RSP_TIMEOUT (2500)
+/* NCI packet header length, status byte follows it in responses */
+#define HAL_EXTNS_NCI_HDR_LEN (3)
 
 #undef P2P_PRIO_LOGIC_HAL_IMP
 
@@ -67,6 +69,16 @@ extern NFCSTATUS read_retry();
 /************** HAL extension functions ***************************************/
 static void hal_extns_write_rsp_timeout_cb(uint32_t TimerId, void* pContext);
 
+/* Command batch chained by the HAL client thread */
+typedef struct phNxpNciHal_ExtBatch {
+  phNxpNciHal_ExtCmd_t* p_cmds;
+  uint8_t nb_cmds;
+  uint8_t curr; /* index of the outstanding command */
+  uint8_t stop_rsp_status;
+  volatile bool_t active;
+} phNxpNciHal_ExtBatch_t;
+static phNxpNciHal_ExtBatch_t gExtBatch;
+
 /*Proprietary cmd sent to HAL to send reader mode flag
  * Last byte of 4 byte proprietary cmd data contains ReaderMode flag
  * If this flag is enabled, NFC-DEP protocol is modified to T3T protocol
@@ -296,8 +308,8 @@ NFCSTATUS phNxpNciHal_process_ext_rsp(uint8_t* p_ntf, uint16_t* p_len) {
     *p_len = 5;
   } else if (*p_len == 4 && p_ntf[0] == 0x61 && p_ntf[1] == 0x07) {
     unsigned long rf_update_enable = 0;
-    if (GetNxpNumValue(NAME_RF_STATUS_UPDATE_ENABLE, &rf_update_enable,
-                       sizeof(unsigned long))) {
+    if (GetNxpNumValueById(NXP_CONFIG_ID_RF_STATUS_UPDATE_ENABLE,
+                           &rf_update_enable, sizeof(unsigned long))) {
       NXPLOG_NCIHAL_D("RF_STATUS_UPDATE_ENABLE : %lu", rf_update_enable);
     }
     if (rf_update_enable == 0x01) {
@@ -313,8 +325,8 @@ NFCSTATUS phNxpNciHal_process_ext_rsp(uint8_t* p_ntf, uint16_t* p_len) {
     }
   } else if (p_ntf[0] == 0x61 && p_ntf[1] == 0x09) {
     unsigned long rf_update_enable = 0;
-    if (GetNxpNumValue(NAME_RF_STATUS_UPDATE_ENABLE, &rf_update_enable,
-                       sizeof(unsigned long))) {
+    if (GetNxpNumValueById(NXP_CONFIG_ID_RF_STATUS_UPDATE_ENABLE,
+                           &rf_update_enable, sizeof(unsigned long))) {
       NXPLOG_NCIHAL_D("RF_STATUS_UPDATE_ENABLE : %lu", rf_update_enable);
     }
     if (rf_update_enable == 0x01) {
@@ -720,7 +732,8 @@ NFCSTATUS phNxpNciHal_write_ext(uint16_t* cmd_len, uint8_t* p_cmd_data,
   NFCSTATUS status = NFCSTATUS_SUCCESS;
 
   unsigned long retval = 0;
-  GetNxpNumValue(NAME_MIFARE_READER_ENABLE, &retval, sizeof(unsigned long));
+  GetNxpNumValueById(NXP_CONFIG_ID_MIFARE_READER_ENABLE, &retval,
+                     sizeof(unsigned long));
 
   phNxpNciHal_NfcDep_cmd_ext(p_cmd_data, cmd_len);
 
@@ -1107,6 +1120,242 @@ NFCSTATUS phNxpNciHal_send_ext_cmd_ntf(uint16_t cmd_len, uint8_t* p_cmd) {
   return status;
 }
 
+/******************************************************************************
+ * Function         phNxpNciHal_ext_batch_end
+ *
+ * Description      This function terminates the running command batch and
+ *                  records the failure of the outstanding command, if any.
+ *                  Called from the HAL client thread only.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpNciHal_ext_batch_end(NFCSTATUS status) {
+  if (status != NFCSTATUS_SUCCESS) {
+    gExtBatch.p_cmds[gExtBatch.curr].status = status;
+    nxpncihal_ctrl.ext_cb_data.status = NFCSTATUS_FAILED;
+  }
+  gExtBatch.active = FALSE;
+}
+
+/******************************************************************************
+ * Function         hal_extns_batch_write_complete
+ *
+ * Description      Write callback of the batched commands sent from the HAL
+ *                  client thread. A write failure terminates the batch.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void hal_extns_batch_write_complete(void* pContext,
+                                           phTmlNfc_TransactInfo_t* pInfo) {
+  UNUSED(pContext);
+  if (pInfo->wStatus != NFCSTATUS_SUCCESS && gExtBatch.active) {
+    NXPLOG_NCIHAL_E("batch cmd %d write error status = 0x%x", gExtBatch.curr,
+                    pInfo->wStatus);
+    phOsalNfc_Timer_Stop(timeoutTimerId);
+    sem_post(&(nxpncihal_ctrl.syncSpiNfc));
+    phNxpNciHal_ext_batch_end(pInfo->wStatus);
+    SEM_POST(&(nxpncihal_ctrl.ext_cb_data));
+  }
+
+  return;
+}
+
+/******************************************************************************
+ * Function         hal_extns_batch_rsp_timeout_cb
+ *
+ * Description      Response timer call back function of the command batch
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void hal_extns_batch_rsp_timeout_cb(uint32_t timerId, void* pContext) {
+  UNUSED(timerId);
+  UNUSED(pContext);
+  NXPLOG_NCIHAL_E("hal_extns_batch_rsp_timeout_cb - cmd %d timeout!!!",
+                  gExtBatch.curr);
+  if (gExtBatch.active) {
+    phNxpNciHal_ext_batch_end(NFCSTATUS_RESPONSE_TIMEOUT);
+  }
+  SEM_POST(&(nxpncihal_ctrl.ext_cb_data));
+
+  return;
+}
+
+/******************************************************************************
+ * Function         phNxpNciHal_ext_batch_rsp
+ *
+ * Description      This function is called by phNxpNciHal_read_complete for
+ *                  every response received while HAL extension is enabled.
+ *                  When a command batch is running, the response status is
+ *                  stored and the next command of the batch is written
+ *                  straight from the HAL client thread, so the NFCC gets it
+ *                  without waking up the thread which submitted the batch.
+ *                  The command window released by this response is taken
+ *                  back, hence only one command is outstanding at a time.
+ *
+ * Returns          TRUE if the response is consumed by the batch (next
+ *                  command sent), FALSE if it shall be handled as a regular
+ *                  extension command response.
+ *
+ ******************************************************************************/
+bool_t phNxpNciHal_ext_batch_rsp(NFCSTATUS rsp_status, uint8_t* p_rsp,
+                                 uint16_t rsp_len) {
+  phNxpNciHal_ExtCmd_t* p_cmd;
+  NFCSTATUS status;
+
+  if (!gExtBatch.active) {
+    return FALSE;
+  }
+  p_cmd = &gExtBatch.p_cmds[gExtBatch.curr];
+
+  if ((rsp_status == NFCSTATUS_FAILED) || (rsp_len < HAL_EXTNS_NCI_HDR_LEN) ||
+      ((p_rsp[0] & 0x0F) != (p_cmd->p_cmd[0] & 0x0F)) ||
+      ((p_rsp[1] & 0x3F) != (p_cmd->p_cmd[1] & 0x3F))) {
+    NXPLOG_NCIHAL_E("batch cmd %d unexpected response", gExtBatch.curr);
+    phNxpNciHal_ext_batch_end(NFCSTATUS_FAILED);
+    return FALSE;
+  }
+
+  p_cmd->status = NFCSTATUS_SUCCESS;
+  p_cmd->rsp_status =
+      (rsp_len > HAL_EXTNS_NCI_HDR_LEN) ? p_rsp[HAL_EXTNS_NCI_HDR_LEN] : NFCSTATUS_SUCCESS;
+
+  if (((gExtBatch.curr + 1) == gExtBatch.nb_cmds) ||
+      (p_cmd->rsp_status == gExtBatch.stop_rsp_status)) {
+    phNxpNciHal_ext_batch_end(NFCSTATUS_SUCCESS);
+    return FALSE;
+  }
+
+  /* Take back the command window released by this response */
+  if (sem_trywait(&(nxpncihal_ctrl.syncSpiNfc)) != 0) {
+    NXPLOG_NCIHAL_E("batch cmd %d command window busy", gExtBatch.curr + 1);
+    gExtBatch.active = FALSE;
+    return FALSE;
+  }
+
+  gExtBatch.curr++;
+  p_cmd = &gExtBatch.p_cmds[gExtBatch.curr];
+  memcpy(nxpncihal_ctrl.p_cmd_data, p_cmd->p_cmd, p_cmd->cmd_len);
+  nxpncihal_ctrl.cmd_len = p_cmd->cmd_len;
+
+  phOsalNfc_Timer_Start(timeoutTimerId, HAL_EXTNS_WRITE_RSP_TIMEOUT,
+                        &hal_extns_batch_rsp_timeout_cb, NULL);
+  /* NFCC has just answered, so no standby wake up retry is needed here */
+  status = phTmlNfc_Write(
+      nxpncihal_ctrl.p_cmd_data, nxpncihal_ctrl.cmd_len,
+      (pphTmlNfc_TransactCompletionCb_t)&hal_extns_batch_write_complete, NULL);
+  if (status != NFCSTATUS_PENDING) {
+    NXPLOG_NCIHAL_E("batch cmd %d write status error", gExtBatch.curr);
+    phOsalNfc_Timer_Stop(timeoutTimerId);
+    sem_post(&(nxpncihal_ctrl.syncSpiNfc));
+    phNxpNciHal_ext_batch_end(NFCSTATUS_FAILED);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/******************************************************************************
+ * Function         phNxpNciHal_send_ext_cmd_batch
+ *
+ * Description      This function sends a sequence of extension commands to
+ *                  NFCC, e.g. the configuration blocks applied at core
+ *                  initialization. The first command is written by the
+ *                  caller, each following one is written by the HAL client
+ *                  thread as soon as the response of the previous one is
+ *                  received, and the caller is woken up once at the end.
+ *                  NCI allows a single outstanding control command, so the
+ *                  commands are chained, not pipelined.
+ *                  Commands expecting a notification or a get config capture
+ *                  shall be sent with phNxpNciHal_send_ext_cmd(_ntf).
+ *
+ * Parameters       p_cmds - commands to send, status fields are updated
+ *                  nb_cmds - number of commands
+ *                  stop_rsp_status - NCI status of a response ending the
+ *                                    batch, PH_NXPNCIHAL_EXT_BATCH_NO_RSP
+ *                                    to send every command
+ *
+ * Returns          Returns NFCSTATUS_SUCCESS if every command was sent and
+ *                  its response received. The per command transport and NCI
+ *                  status are returned in p_cmds.
+ *
+ ******************************************************************************/
+NFCSTATUS phNxpNciHal_send_ext_cmd_batch(phNxpNciHal_ExtCmd_t* p_cmds,
+                                         uint8_t nb_cmds,
+                                         uint8_t stop_rsp_status) {
+  NFCSTATUS status = NFCSTATUS_FAILED;
+  uint16_t data_written = 0;
+  uint8_t i;
+
+  if ((p_cmds == NULL) || (nb_cmds == 0)) {
+    return NFCSTATUS_INVALID_PARAMETER;
+  }
+  for (i = 0; i < nb_cmds; i++) {
+    if ((p_cmds[i].p_cmd == NULL) || (p_cmds[i].cmd_len < HAL_EXTNS_NCI_HDR_LEN) ||
+        (p_cmds[i].cmd_len > NCI_MAX_DATA_LEN)) {
+      return NFCSTATUS_INVALID_PARAMETER;
+    }
+    p_cmds[i].status = NFCSTATUS_FAILED;
+    p_cmds[i].rsp_status = PH_NXPNCIHAL_EXT_BATCH_NO_RSP;
+  }
+
+  HAL_ENABLE_EXT();
+  /* Create the local semaphore */
+  if (phNxpNciHal_init_cb_data(&nxpncihal_ctrl.ext_cb_data, NULL) !=
+      NFCSTATUS_SUCCESS) {
+    NXPLOG_NCIHAL_D("Create ext_cb_data failed");
+    HAL_DISABLE_EXT();
+    return NFCSTATUS_FAILED;
+  }
+  nxpncihal_ctrl.ext_cb_data.status = NFCSTATUS_SUCCESS;
+
+  gExtBatch.p_cmds = p_cmds;
+  gExtBatch.nb_cmds = nb_cmds;
+  gExtBatch.curr = 0;
+  gExtBatch.stop_rsp_status = stop_rsp_status;
+  gExtBatch.active = TRUE;
+
+  /* Send first command */
+  NXPLOG_NCIHAL_D("Sending batch of %d ext cmds", nb_cmds);
+  data_written = phNxpNciHal_write_unlocked(p_cmds[0].cmd_len, p_cmds[0].p_cmd);
+  if (data_written != p_cmds[0].cmd_len) {
+    NXPLOG_NCIHAL_D("phNxpNciHal_write failed for hal ext batch");
+    gExtBatch.active = FALSE;
+    goto clean_and_return;
+  }
+
+  /* Start timer */
+  status = phOsalNfc_Timer_Start(timeoutTimerId, HAL_EXTNS_WRITE_RSP_TIMEOUT,
+                                 &hal_extns_batch_rsp_timeout_cb, NULL);
+  if (NFCSTATUS_SUCCESS != status) {
+    NXPLOG_NCIHAL_E("Response timer not started!!!");
+  }
+
+  /* Wait for the end of the batch */
+  if (SEM_WAIT(nxpncihal_ctrl.ext_cb_data)) {
+    NXPLOG_NCIHAL_E("p_hal_ext->ext_cb_data.sem semaphore error");
+  }
+  phOsalNfc_Timer_Stop(timeoutTimerId);
+  gExtBatch.active = FALSE;
+
+clean_and_return:
+  status = NFCSTATUS_SUCCESS;
+  for (i = 0; i < nb_cmds; i++) {
+    if (p_cmds[i].status != NFCSTATUS_SUCCESS) {
+      NXPLOG_NCIHAL_E("batch cmd %d of %d failed 0x%x", i, nb_cmds,
+                      p_cmds[i].status);
+      status = NFCSTATUS_FAILED;
+      break;
+    }
+  }
+  phNxpNciHal_cleanup_cb_data(&nxpncihal_ctrl.ext_cb_data);
+  HAL_DISABLE_EXT();
+
+  return status;
+}
+
 /******************************************************************************
  * Function         phNxpNciHal_check_wait_for_ntf
  *
@@ -20,10 +20,26 @@
 #include <string.h>
 #include <phNxpNciHal_dta.h>
 
+/* NCI status reported for a batched command which got no response */
+#define PH_NXPNCIHAL_EXT_BATCH_NO_RSP (0xFF)
+
+/* Command of a batch sent with phNxpNciHal_send_ext_cmd_batch */
+typedef struct phNxpNciHal_ExtCmd {
+  uint16_t cmd_len;     /* [in] length of the NCI command */
+  const uint8_t* p_cmd; /* [in] NCI command, valid until the batch returns */
+  NFCSTATUS status;     /* [out] NFCSTATUS_SUCCESS if response was received */
+  uint8_t rsp_status;   /* [out] NCI status of the response */
+} phNxpNciHal_ExtCmd_t;
+
 void phNxpNciHal_ext_init(void);
 NFCSTATUS phNxpNciHal_process_ext_rsp(uint8_t* p_ntf, uint16_t* p_len);
 NFCSTATUS phNxpNciHal_send_ext_cmd(uint16_t cmd_len, uint8_t* p_cmd);
 NFCSTATUS phNxpNciHal_send_ext_cmd_ntf(uint16_t cmd_len, uint8_t* p_cmd);
+NFCSTATUS phNxpNciHal_send_ext_cmd_batch(phNxpNciHal_ExtCmd_t* p_cmds,
+                                         uint8_t nb_cmds,
+                                         uint8_t stop_rsp_status);
+bool_t phNxpNciHal_ext_batch_rsp(NFCSTATUS rsp_status, uint8_t* p_rsp,
+                                 uint16_t rsp_len);
 bool_t phNxpNciHal_check_wait_for_ntf(void);
 NFCSTATUS phNxpNciHal_send_ese_hal_cmd(uint16_t cmd_len, uint8_t* p_cmd);
 NFCSTATUS phNxpNciHal_write_ext(uint16_t* cmd_len, uint8_t* p_cmd_data,
@@ -21,6 +21,7 @@
 #include <hardware/nfc.h>
 #include <android/hardware/nfc/1.1/INfc.h>
 #include <android/hardware/nfc/1.1/types.h>
+#include <memory>
 
 using ::android::hardware::nfc::V1_1::NfcConfig;
 
@@ -37,6 +38,7 @@ int phNxpNciHal_configDiscShutdown(void);
 int phNxpNciHal_control_granted(void);
 int phNxpNciHal_power_cycle(void);
 void phNxpNciHal_getVendorConfig(NfcConfig& config);
+std::shared_ptr<const NfcConfig> phNxpNciHal_getVendorConfigCached(void);
 int phNxpNciHal_MinInit(nfc_stack_callback_t* p_cback,
                         nfc_stack_data_callback_t* p_data_cback);
 void phNxpNciHal_reset_nfcee_session(bool force_session_reset);
@@ -20,22 +20,45 @@
  */
 
 #include <pthread.h>
+#include <sched.h>
 #include <phNxpLog.h>
 #include <linux/ipc.h>
 #include <semaphore.h>
 #include <errno.h>
+#include <time.h>
+#include <atomic>
+#include <new>
 #include <phDal4Nfc_messageQueueLib.h>
 
-typedef struct phDal4Nfc_message_queue_item {
+/* Number of preallocated message slots, must be a power of two */
+#define PH_DAL4NFC_MSG_QUEUE_SLOTS (128U)
+#define PH_DAL4NFC_MSG_QUEUE_MASK (PH_DAL4NFC_MSG_QUEUE_SLOTS - 1U)
+/* Max time a sender waits for a free slot when the queue is full */
+#define PH_DAL4NFC_MSG_SEND_TIMEOUT_MS (1000U)
+
+/*
+ * Each slot carries a sequence number telling producers and the consumer
+ * whose turn it is: seq == pos means free for the producer claiming pos,
+ * seq == pos + 1 means the message for pos is published.
+ */
+typedef struct phDal4Nfc_message_queue_slot {
+  std::atomic<uint32_t> nSeq;
   phLibNfc_Message_t nMsg;
-  struct phDal4Nfc_message_queue_item* pPrev;
-  struct phDal4Nfc_message_queue_item* pNext;
-} phDal4Nfc_message_queue_item_t;
+} phDal4Nfc_message_queue_slot_t;
 
 typedef struct phDal4Nfc_message_queue {
-  phDal4Nfc_message_queue_item_t* pItems;
-  pthread_mutex_t nCriticalSectionMutex;
+  phDal4Nfc_message_queue_slot_t aSlots[PH_DAL4NFC_MSG_QUEUE_SLOTS];
+  std::atomic<uint32_t> nTail; /* next position claimed by a producer */
+  std::atomic<uint32_t> nHead; /* next position read by the consumer */
+  std::atomic<uint32_t> nOverflowCount; /* sends that found the queue full */
+  std::atomic<bool> bReleased;
   sem_t nProcessSemaphore;
+  /* Senders waiting for a free slot, woken up by the consumer */
+  std::atomic<uint32_t> nFreeWaiters;
+  pthread_mutex_t nFreeLock;
+  pthread_cond_t nFreeCond;
+  /* Thread receiving from the queue, 0 until its first receive */
+  std::atomic<pthread_t> nConsumer;
 
 } phDal4Nfc_message_queue_t;
 
@@ -48,25 +71,28 @@ typedef struct phDal4Nfc_message_queue {
 ** Parameters       Ignored, included only for Linux queue API compatibility
 **
 ** Returns          (int) value of pQueue if successful
-**                  -1, if failed to allocate memory or to init mutex
+**                  -1, if failed to allocate memory or to init semaphore
 **
 *******************************************************************************/
 intptr_t phDal4Nfc_msgget(key_t key, int msgflg) {
   phDal4Nfc_message_queue_t* pQueue;
   UNUSED(key);
   UNUSED(msgflg);
-  pQueue =
-      (phDal4Nfc_message_queue_t*)malloc(sizeof(phDal4Nfc_message_queue_t));
+  pQueue = new (std::nothrow) phDal4Nfc_message_queue_t();
   if (pQueue == NULL) return -1;
-  memset(pQueue, 0, sizeof(phDal4Nfc_message_queue_t));
-  if (pthread_mutex_init(&pQueue->nCriticalSectionMutex, NULL) == -1) {
-    free(pQueue);
-    return -1;
+  for (uint32_t i = 0; i < PH_DAL4NFC_MSG_QUEUE_SLOTS; i++) {
+    pQueue->aSlots[i].nSeq.store(i, std::memory_order_relaxed);
   }
   if (sem_init(&pQueue->nProcessSemaphore, 0, 0) == -1) {
-    free(pQueue);
+    delete pQueue;
     return -1;
   }
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_mutex_init(&pQueue->nFreeLock, NULL);
+  pthread_cond_init(&pQueue->nFreeCond, &attr);
+  pthread_condattr_destroy(&attr);
 
   return ((intptr_t)pQueue);
 }
@@ -86,14 +112,21 @@ void phDal4Nfc_msgrelease(intptr_t msqid) {
   phDal4Nfc_message_queue_t* pQueue = (phDal4Nfc_message_queue_t*)msqid;
 
   if (pQueue != NULL) {
+    NXPLOG_TML_D("Message queue overflow count = %u",
+                 pQueue->nOverflowCount.load(std::memory_order_relaxed));
+    pQueue->bReleased.store(true, std::memory_order_release);
     sem_post(&pQueue->nProcessSemaphore);
+    pthread_mutex_lock(&pQueue->nFreeLock);
+    pthread_cond_broadcast(&pQueue->nFreeCond);
+    pthread_mutex_unlock(&pQueue->nFreeLock);
     usleep(3000);
     if (sem_destroy(&pQueue->nProcessSemaphore)) {
       NXPLOG_TML_E("Failed to destroy semaphore (errno=0x%08x)", errno);
     }
-    pthread_mutex_destroy(&pQueue->nCriticalSectionMutex);
+    pthread_cond_destroy(&pQueue->nFreeCond);
+    pthread_mutex_destroy(&pQueue->nFreeLock);
 
-    free(pQueue);
+    delete pQueue;
   }
 
   return;
@@ -115,31 +148,58 @@ void phDal4Nfc_msgrelease(intptr_t msqid) {
 *******************************************************************************/
 int phDal4Nfc_msgctl(intptr_t msqid, int cmd, void* buf) {
   phDal4Nfc_message_queue_t* pQueue;
-  phDal4Nfc_message_queue_item_t* p;
   UNUSED(cmd);
   UNUSED(buf);
   if (msqid == 0) return -1;
 
   pQueue = (phDal4Nfc_message_queue_t*)msqid;
-  pthread_mutex_lock(&pQueue->nCriticalSectionMutex);
-  if (pQueue->pItems != NULL) {
-    p = pQueue->pItems;
-    while (p->pNext != NULL) {
-      p = p->pNext;
-    }
-    while (p->pPrev != NULL) {
-      p = p->pPrev;
-      free(p->pNext);
-      p->pNext = NULL;
+  /* Slots are preallocated, pending messages are simply dropped */
+  pthread_cond_destroy(&pQueue->nFreeCond);
+  pthread_mutex_destroy(&pQueue->nFreeLock);
+  delete pQueue;
+
+  return 0;
+}
+
+/*******************************************************************************
+**
+** Function         phDal4Nfc_msgwaitfree
+**
+** Description      Waits until the consumer frees the slot at the tail of the
+**                  queue or the deadline expires
+**
+** Parameters       pQueue    - message queue
+**                  pDeadline - CLOCK_MONOTONIC time to give up at
+**
+** Returns          true,  if the tail slot may be free
+**                  false, if the queue is still full at the deadline or has
+**                         been released
+**
+*******************************************************************************/
+static bool phDal4Nfc_msgwaitfree(phDal4Nfc_message_queue_t* pQueue,
+                                  const struct timespec* pDeadline) {
+  bool bFull = true;
+  int ret = 0;
+
+  pQueue->nFreeWaiters.fetch_add(1);
+  pthread_mutex_lock(&pQueue->nFreeLock);
+  /* Checked under the lock after announcing the wait, see phDal4Nfc_msgrcv,
+   * so that a slot freed in between is not missed */
+  while (bFull && (ret == 0) &&
+         !pQueue->bReleased.load(std::memory_order_acquire)) {
+    uint32_t pos = pQueue->nTail.load(std::memory_order_relaxed);
+    uint32_t seq = pQueue->aSlots[pos & PH_DAL4NFC_MSG_QUEUE_MASK].nSeq.load(
+        std::memory_order_seq_cst);
+    bFull = ((int32_t)(seq - pos) < 0);
+    if (bFull) {
+      ret = pthread_cond_timedwait(&pQueue->nFreeCond, &pQueue->nFreeLock,
+                                   pDeadline);
     }
-    free(p);
   }
-  pQueue->pItems = NULL;
-  pthread_mutex_unlock(&pQueue->nCriticalSectionMutex);
-  pthread_mutex_destroy(&pQueue->nCriticalSectionMutex);
-  free(pQueue);
+  pthread_mutex_unlock(&pQueue->nFreeLock);
+  pQueue->nFreeWaiters.fetch_sub(1, std::memory_order_relaxed);
 
-  return 0;
+  return !bFull && !pQueue->bReleased.load(std::memory_order_acquire);
 }
 
 /*******************************************************************************
@@ -147,7 +207,13 @@ int phDal4Nfc_msgctl(intptr_t msqid, int cmd, void* buf) {
 ** Function         phDal4Nfc_msgsnd
 **
 ** Description      Sends a message to the queue. The message will be added at
-**                  the end of the queue as appropriate for FIFO policy
+**                  the end of the queue as appropriate for FIFO policy.
+**                  The message is copied into a preallocated slot without
+**                  taking any lock. If all slots are in use the overflow
+**                  counter is incremented and the sender waits up to
+**                  PH_DAL4NFC_MSG_SEND_TIMEOUT_MS for the consumer to free
+**                  a slot. The consumer itself never waits, it could not
+**                  free a slot, and the message is dropped instead.
 **
 ** Parameters       msqid  - message queue handle
 **                  msgp   - message to be sent
@@ -155,35 +221,63 @@ int phDal4Nfc_msgctl(intptr_t msqid, int cmd, void* buf) {
 **                  msgflg - ignored
 **
 ** Returns          0,  if successful
-**                  -1, if invalid parameter passed or failed to allocate memory
+**                  -1, if invalid parameter passed or the queue stayed full,
+**                      the message is not sent
 **
 *******************************************************************************/
 intptr_t phDal4Nfc_msgsnd(intptr_t msqid, phLibNfc_Message_t* msg, int msgflg) {
   phDal4Nfc_message_queue_t* pQueue;
-  phDal4Nfc_message_queue_item_t* p;
-  phDal4Nfc_message_queue_item_t* pNew;
+  phDal4Nfc_message_queue_slot_t* pSlot;
+  uint32_t pos;
+  bool bOverflowed = false;
+  struct timespec tDeadline;
   UNUSED(msgflg);
   if ((msqid == 0) || (msg == NULL)) return -1;
 
   pQueue = (phDal4Nfc_message_queue_t*)msqid;
-  pNew = (phDal4Nfc_message_queue_item_t*)malloc(
-      sizeof(phDal4Nfc_message_queue_item_t));
-  if (pNew == NULL) return -1;
-  memset(pNew, 0, sizeof(phDal4Nfc_message_queue_item_t));
-  memcpy(&pNew->nMsg, msg, sizeof(phLibNfc_Message_t));
-  pthread_mutex_lock(&pQueue->nCriticalSectionMutex);
-
-  if (pQueue->pItems != NULL) {
-    p = pQueue->pItems;
-    while (p->pNext != NULL) {
-      p = p->pNext;
+  pos = pQueue->nTail.load(std::memory_order_relaxed);
+  for (;;) {
+    pSlot = &pQueue->aSlots[pos & PH_DAL4NFC_MSG_QUEUE_MASK];
+    uint32_t seq = pSlot->nSeq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      /* Slot is free, try to claim it */
+      if (pQueue->nTail.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      /* Queue is full, wait for the consumer to drain a slot */
+      if (!bOverflowed) {
+        bOverflowed = true;
+        pQueue->nOverflowCount.fetch_add(1, std::memory_order_relaxed);
+        if (pthread_equal(pQueue->nConsumer.load(std::memory_order_relaxed),
+                          pthread_self())) {
+          NXPLOG_TML_E("Message queue full, consumer message dropped");
+          return -1;
+        }
+        NXPLOG_TML_E("Message queue full, waiting for free slot");
+        clock_gettime(CLOCK_MONOTONIC, &tDeadline);
+        tDeadline.tv_sec += PH_DAL4NFC_MSG_SEND_TIMEOUT_MS / 1000;
+        tDeadline.tv_nsec +=
+            (long)(PH_DAL4NFC_MSG_SEND_TIMEOUT_MS % 1000) * 1000000;
+        if (tDeadline.tv_nsec >= 1000000000) {
+          tDeadline.tv_sec++;
+          tDeadline.tv_nsec -= 1000000000;
+        }
+      }
+      if (!phDal4Nfc_msgwaitfree(pQueue, &tDeadline)) {
+        NXPLOG_TML_E("Message queue still full, message dropped");
+        return -1;
+      }
+      pos = pQueue->nTail.load(std::memory_order_relaxed);
+    } else {
+      /* Another producer claimed this position, reload */
+      pos = pQueue->nTail.load(std::memory_order_relaxed);
     }
-    p->pNext = pNew;
-    pNew->pPrev = p;
-  } else {
-    pQueue->pItems = pNew;
   }
-  pthread_mutex_unlock(&pQueue->nCriticalSectionMutex);
+  memcpy(&pSlot->nMsg, msg, sizeof(phLibNfc_Message_t));
+  pSlot->nSeq.store(pos + 1, std::memory_order_release);
 
   sem_post(&pQueue->nProcessSemaphore);
 
@@ -195,8 +289,10 @@ intptr_t phDal4Nfc_msgsnd(intptr_t msqid, phLibNfc_Message_t* msg, int msgflg) {
 ** Function         phDal4Nfc_msgrcv
 **
 ** Description      Gets the oldest message from the queue.
-**                  If the queue is empty the function waits (blocks on a mutex)
-**                  until a message is posted to the queue with phDal4Nfc_msgsnd
+**                  If the queue is empty the function waits (blocks on a
+**                  semaphore) until a message is posted to the queue with
+**                  phDal4Nfc_msgsnd. Only one thread may receive from a
+**                  queue.
 **
 ** Parameters       msqid  - message queue handle
 **                  msgp   - message to be received
@@ -211,24 +307,59 @@ intptr_t phDal4Nfc_msgsnd(intptr_t msqid, phLibNfc_Message_t* msg, int msgflg) {
 int phDal4Nfc_msgrcv(intptr_t msqid, phLibNfc_Message_t* msg, long msgtyp,
                      int msgflg) {
   phDal4Nfc_message_queue_t* pQueue;
-  phDal4Nfc_message_queue_item_t* p;
+  phDal4Nfc_message_queue_slot_t* pSlot;
+  uint32_t pos;
   UNUSED(msgflg);
   UNUSED(msgtyp);
   if ((msqid == 0) || (msg == NULL)) return -1;
 
   pQueue = (phDal4Nfc_message_queue_t*)msqid;
+  pQueue->nConsumer.store(pthread_self(), std::memory_order_relaxed);
 
   sem_wait(&pQueue->nProcessSemaphore);
 
-  pthread_mutex_lock(&pQueue->nCriticalSectionMutex);
-
-  if (pQueue->pItems != NULL) {
-    memcpy(msg, &(pQueue->pItems)->nMsg, sizeof(phLibNfc_Message_t));
-    p = pQueue->pItems->pNext;
-    free(pQueue->pItems);
-    pQueue->pItems = p;
+  pos = pQueue->nHead.load(std::memory_order_relaxed);
+  pSlot = &pQueue->aSlots[pos & PH_DAL4NFC_MSG_QUEUE_MASK];
+  /* A producer that claimed this slot before a later one posted may still be
+   * copying its message in; wait for it to publish */
+  while (pSlot->nSeq.load(std::memory_order_acquire) != pos + 1) {
+    if (pQueue->bReleased.load(std::memory_order_acquire)) {
+      memset(msg, 0, sizeof(phLibNfc_Message_t));
+      return 0;
+    }
+    sched_yield();
+  }
+  memcpy(msg, &pSlot->nMsg, sizeof(phLibNfc_Message_t));
+  pSlot->nSeq.store(pos + PH_DAL4NFC_MSG_QUEUE_SLOTS,
+                    std::memory_order_seq_cst);
+  pQueue->nHead.store(pos + 1, std::memory_order_relaxed);
+  /* Pairs with the waiter count update in phDal4Nfc_msgwaitfree: either the
+   * sender sees the freed slot or the consumer sees the waiter */
+  if (pQueue->nFreeWaiters.load(std::memory_order_seq_cst) != 0) {
+    pthread_mutex_lock(&pQueue->nFreeLock);
+    pthread_cond_broadcast(&pQueue->nFreeCond);
+    pthread_mutex_unlock(&pQueue->nFreeLock);
   }
-  pthread_mutex_unlock(&pQueue->nCriticalSectionMutex);
 
   return 0;
 }
+
+/*******************************************************************************
+**
+** Function         phDal4Nfc_msgoverflowcnt
+**
+** Description      Returns the number of sends which found the queue full and
+**                  had to wait for the consumer or were dropped
+**
+** Parameters       msqid  - message queue handle
+**
+** Returns          overflow count, 0 if invalid handle is passed
+**
+*******************************************************************************/
+uint32_t phDal4Nfc_msgoverflowcnt(intptr_t msqid) {
+  phDal4Nfc_message_queue_t* pQueue = (phDal4Nfc_message_queue_t*)msqid;
+
+  if ((msqid == 0) || (msqid == -1)) return 0;
+
+  return pQueue->nOverflowCount.load(std::memory_order_relaxed);
+}
@@ -30,5 +30,6 @@ int phDal4Nfc_msgctl(intptr_t msqid, int cmd, void* buf);
 intptr_t phDal4Nfc_msgsnd(intptr_t msqid, phLibNfc_Message_t* msg, int msgflg);
 int phDal4Nfc_msgrcv(intptr_t msqid, phLibNfc_Message_t* msg, long msgtyp,
                      int msgflg);
+uint32_t phDal4Nfc_msgoverflowcnt(intptr_t msqid);
 
 #endif /*  PHDAL4NFC_MESSAGEQUEUE_H  */
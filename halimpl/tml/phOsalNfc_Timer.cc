@@ -18,16 +18,52 @@
  * OSAL Implementation for Timers.
  */
 
-#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/timerfd.h>
 #include <phNfcTypes.h>
 #include <phOsalNfc_Timer.h>
 #include <phNfcCommon.h>
 #include <phNxpNciHal.h>
 #include <phNxpLog.h>
 
-#define PH_NFC_MAX_TIMER (5U)
+#define PH_NFC_MAX_TIMER (32U)
 static phOsalNfc_TimerHandle_t apTimerInfo[PH_NFC_MAX_TIMER];
 
+/*
+ * Timer wheel, one tick is 1 ms of CLOCK_MONOTONIC.
+ * Level 0 holds timers expiring within 256 ticks, each upper level covers 64
+ * slots of the level below (~16 s, ~17 min, ~18 h). Timers are moved down a
+ * level when the wheel reaches their slot.
+ */
+#define PH_NFC_TIMER_WHEEL_L0_BITS (8U)
+#define PH_NFC_TIMER_WHEEL_LN_BITS (6U)
+#define PH_NFC_TIMER_WHEEL_L0_SIZE (1U << PH_NFC_TIMER_WHEEL_L0_BITS)
+#define PH_NFC_TIMER_WHEEL_LN_SIZE (1U << PH_NFC_TIMER_WHEEL_LN_BITS)
+#define PH_NFC_TIMER_WHEEL_LN_NB (3U)
+#define PH_NFC_TIMER_WHEEL_SHIFT(lvl) \
+  (PH_NFC_TIMER_WHEEL_L0_BITS + ((lvl)*PH_NFC_TIMER_WHEEL_LN_BITS))
+/* Longest timeout handled by the wheel, longer ones are clamped */
+#define PH_NFC_TIMER_WHEEL_MAX_TICKS \
+  ((1ULL << PH_NFC_TIMER_WHEEL_SHIFT(PH_NFC_TIMER_WHEEL_LN_NB)) - 1)
+
+typedef struct phOsalNfc_TimerWheel {
+  pthread_mutex_t lock;  /* Protects the wheel and the timer states */
+  pthread_t thread;      /* Timer thread, expires timers */
+  int nTimerFd;          /* Armed for the next tick needing processing */
+  bool_t bThreadRun;     /* Timer thread shall keep running */
+  uint64_t qwCurrTick;   /* Last tick processed */
+  uint64_t qwArmedTick;  /* Tick nTimerFd is armed for, 0 if disarmed */
+  uint32_t dwNbActive;   /* Timers linked in the wheel */
+  phOsalNfc_TimerHandle_t* apL0[PH_NFC_TIMER_WHEEL_L0_SIZE];
+  phOsalNfc_TimerHandle_t* apLn[PH_NFC_TIMER_WHEEL_LN_NB]
+                               [PH_NFC_TIMER_WHEEL_LN_SIZE];
+} phOsalNfc_TimerWheel_t;
+
+static phOsalNfc_TimerWheel_t gTimerWheel = {
+    PTHREAD_MUTEX_INITIALIZER, 0, -1, false, 0, 0, 0, {NULL}, {{NULL}}};
+
 extern phNxpNciHal_Control_t nxpncihal_ctrl;
 
 /*
@@ -44,10 +80,52 @@ extern phNxpNciHal_Control_t nxpncihal_ctrl;
  * Invalid timer ID type. This ID used indicate timer creation is failed */
 #define PH_NFC_TIMER_ID_INVALID (0xFFFF)
 
+/*
+ * Timer ID layout: slot generation in the upper 16 bits, base address plus
+ * slot number in the lower 16 bits. The generation changes each time a slot
+ * is allocated so that the ID of a deleted timer never matches a reused slot.
+ */
+#define PH_NFC_TIMER_GEN_SHIFT (16U)
+#define PH_NFC_TIMER_SLOT_MASK (0xFFFFU)
+
+/*
+ * End of free slot list */
+#define PH_NFC_TIMER_SLOT_NONE (0xFFU)
+
+/*
+ * Deleted timer slot kept out of the free list until its queued expiries are
+ * dispatched, as they refer to the slot deferred call info */
+#define PH_NFC_TIMER_SLOT_PARKED (0xFEU)
+
+/* Generation of the last timer created in each slot */
+static uint16_t awTimerGeneration[PH_NFC_MAX_TIMER];
+/* Free slots: released ones linked from bTimerFreeHead, then slots from
+ * bTimerNbUsedSlots on which were never allocated */
+static uint8_t abTimerFreeNext[PH_NFC_MAX_TIMER];
+static uint8_t bTimerFreeHead = PH_NFC_TIMER_SLOT_NONE;
+static uint8_t bTimerNbUsedSlots;
+/* Expiries posted on the client thread and not yet dispatched */
+static uint8_t abTimerExpiryQueued[PH_NFC_MAX_TIMER];
+
 /* Forward declarations */
 static void phOsalNfc_PostTimerMsg(phLibNfc_Message_t* pMsg);
 static void phOsalNfc_DeferredCall(void* pParams);
-static void phOsalNfc_Timer_Expired(union sigval sv);
+static phLibNfc_Message_t* phOsalNfc_Timer_Expired(
+    phOsalNfc_TimerHandle_t* pTimerHandle);
+static uint32_t phOsalNfc_Timer_AllocSlot(void);
+static void phOsalNfc_Timer_Release(phOsalNfc_TimerHandle_t* pTimerHandle);
+static phOsalNfc_TimerHandle_t* phOsalNfc_Timer_Lookup(uint32_t dwTimerId);
+static NFCSTATUS phOsalNfc_Timer_ThreadStart(void);
+static void phOsalNfc_Timer_ThreadStop(void);
+static void* phOsalNfc_Timer_Thread(void* pParam);
+static uint64_t phOsalNfc_Timer_NowUs(void);
+static void phOsalNfc_Timer_Link(phOsalNfc_TimerHandle_t* pTimerHandle);
+static void phOsalNfc_Timer_Unlink(phOsalNfc_TimerHandle_t* pTimerHandle);
+static void phOsalNfc_Timer_Advance(uint64_t qwNowTick,
+                                    phLibNfc_Message_t** ppExpiredMsg,
+                                    uint32_t* pNbExpired);
+static void phOsalNfc_Timer_Arm(uint64_t qwTick);
+static uint64_t phOsalNfc_Timer_NextTick(void);
 
 /*
  *************************** Function Definitions ******************************
@@ -71,36 +149,36 @@ static void phOsalNfc_Timer_Expired(union sigval sv);
 uint32_t phOsalNfc_Timer_Create(void) {
   /* dwTimerId is also used as an index at which timer object can be stored */
   uint32_t dwTimerId = PH_OSALNFC_TIMER_ID_INVALID;
-  static struct sigevent se;
+  uint16_t wGeneration;
   phOsalNfc_TimerHandle_t* pTimerHandle;
-  /* Timer needs to be initialized for timer usage */
+  /* Timer thread needs to be running for timer usage */
+  if (NFCSTATUS_SUCCESS != phOsalNfc_Timer_ThreadStart()) {
+    return PH_NFC_TIMER_ID_INVALID;
+  }
 
-  se.sigev_notify = SIGEV_THREAD;
-  se.sigev_notify_function = phOsalNfc_Timer_Expired;
-  se.sigev_notify_attributes = NULL;
-  dwTimerId = phUtilNfc_CheckForAvailableTimer();
+  pthread_mutex_lock(&gTimerWheel.lock);
+  dwTimerId = phOsalNfc_Timer_AllocSlot();
 
   /* Check whether timers are available, if yes create a timer handle structure
    */
   if ((PH_NFC_TIMER_ID_ZERO != dwTimerId) && (dwTimerId <= PH_NFC_MAX_TIMER)) {
     pTimerHandle = (phOsalNfc_TimerHandle_t*)&apTimerInfo[dwTimerId - 1];
-    /* Build the Timer Id to be returned to Caller Function */
-    dwTimerId += PH_NFC_TIMER_BASE_ADDRESS;
-    se.sigev_value.sival_int = (int)dwTimerId;
-    /* Create POSIX timer */
-    if (timer_create(CLOCK_REALTIME, &se, &(pTimerHandle->hTimerHandle)) ==
-        -1) {
-      dwTimerId = PH_NFC_TIMER_ID_INVALID;
-    } else {
-      /* Set the state to indicate timer is ready */
-      pTimerHandle->eState = eTimerIdle;
-      /* Store the Timer Id which shall act as flag during check for timer
-       * availability */
-      pTimerHandle->TimerId = dwTimerId;
+    wGeneration = ++awTimerGeneration[dwTimerId - 1];
+    if (0 == wGeneration) {
+      wGeneration = ++awTimerGeneration[dwTimerId - 1];
     }
+    /* Build the Timer Id to be returned to Caller Function */
+    dwTimerId = ((uint32_t)wGeneration << PH_NFC_TIMER_GEN_SHIFT) |
+                (dwTimerId + PH_NFC_TIMER_BASE_ADDRESS);
+    /* Set the state to indicate timer is ready */
+    pTimerHandle->eState = eTimerIdle;
+    /* Store the Timer Id which shall act as flag during check for timer
+     * availability */
+    pTimerHandle->TimerId = dwTimerId;
   } else {
     dwTimerId = PH_NFC_TIMER_ID_INVALID;
   }
+  pthread_mutex_unlock(&gTimerWheel.lock);
 
   /* Timer ID invalid can be due to Uninitialized state,Non availability of
    * Timer */
@@ -139,34 +217,42 @@ NFCSTATUS phOsalNfc_Timer_Start(uint32_t dwTimerId, uint32_t dwRegTimeCnt,
                                 void* pContext) {
   NFCSTATUS wStartStatus = NFCSTATUS_SUCCESS;
 
-  struct itimerspec its;
-  uint32_t dwIndex;
+  uint64_t qwTimeout;
   phOsalNfc_TimerHandle_t* pTimerHandle;
-  /* Retrieve the index at which the timer handle structure is stored */
-  dwIndex = dwTimerId - PH_NFC_TIMER_BASE_ADDRESS - 0x01;
-  pTimerHandle = (phOsalNfc_TimerHandle_t*)&apTimerInfo[dwIndex];
+  pthread_mutex_lock(&gTimerWheel.lock);
+  /* Retrieve the timer handle structure */
+  pTimerHandle = phOsalNfc_Timer_Lookup(dwTimerId);
   /* OSAL Module needs to be initialized for timer usage */
   /* Check whether the handle provided by user is valid */
-  if ((dwIndex < PH_NFC_MAX_TIMER) && (0x00 != pTimerHandle->TimerId) &&
-      (NULL != pApplication_callback)) {
-    its.it_interval.tv_sec = 0;
-    its.it_interval.tv_nsec = 0;
-    its.it_value.tv_sec = dwRegTimeCnt / 1000;
-    its.it_value.tv_nsec = 1000000 * (dwRegTimeCnt % 1000);
-    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
-      /* This would inadvertently stop the timer*/
-      its.it_value.tv_nsec = 1;
+  if ((NULL != pTimerHandle) && (NULL != pApplication_callback)) {
+    /* Restart if already running */
+    if (NULL != pTimerHandle->ppSlot) {
+      phOsalNfc_Timer_Unlink(pTimerHandle);
     }
+    qwTimeout = (dwRegTimeCnt > PH_NFC_TIMER_WHEEL_MAX_TICKS)
+                    ? PH_NFC_TIMER_WHEEL_MAX_TICKS
+                    : dwRegTimeCnt;
+    /* Rounded up to the next tick so that the timer never expires early */
+    pTimerHandle->qwExpiryTick =
+        ((phOsalNfc_Timer_NowUs() + 999) / 1000) + qwTimeout;
     pTimerHandle->Application_callback = pApplication_callback;
     pTimerHandle->pContext = pContext;
     pTimerHandle->eState = eTimerRunning;
-    /* Arm the timer */
-    if ((timer_settime(pTimerHandle->hTimerHandle, 0, &its, NULL)) == -1) {
-      wStartStatus = PHNFCSTVAL(CID_NFC_OSAL, PH_OSALNFC_TIMER_START_ERROR);
+    phOsalNfc_Timer_Link(pTimerHandle);
+    /* Arm the timer thread if this timer expires first */
+    if ((0 == gTimerWheel.qwArmedTick) ||
+        (pTimerHandle->qwExpiryTick < gTimerWheel.qwArmedTick)) {
+      phOsalNfc_Timer_Arm(pTimerHandle->qwExpiryTick);
+      if (0 == gTimerWheel.qwArmedTick) {
+        phOsalNfc_Timer_Unlink(pTimerHandle);
+        pTimerHandle->eState = eTimerIdle;
+        wStartStatus = PHNFCSTVAL(CID_NFC_OSAL, PH_OSALNFC_TIMER_START_ERROR);
+      }
     }
   } else {
     wStartStatus = PHNFCSTVAL(CID_NFC_OSAL, NFCSTATUS_INVALID_PARAMETER);
   }
+  pthread_mutex_unlock(&gTimerWheel.lock);
 
   return wStartStatus;
 }
@@ -192,28 +278,25 @@ NFCSTATUS phOsalNfc_Timer_Start(uint32_t dwTimerId, uint32_t dwRegTimeCnt,
 *******************************************************************************/
 NFCSTATUS phOsalNfc_Timer_Stop(uint32_t dwTimerId) {
   NFCSTATUS wStopStatus = NFCSTATUS_SUCCESS;
-  static struct itimerspec its = {{0, 0}, {0, 0}};
 
-  uint32_t dwIndex;
   phOsalNfc_TimerHandle_t* pTimerHandle;
-  dwIndex = dwTimerId - PH_NFC_TIMER_BASE_ADDRESS - 0x01;
-  pTimerHandle = (phOsalNfc_TimerHandle_t*)&apTimerInfo[dwIndex];
+  pthread_mutex_lock(&gTimerWheel.lock);
+  pTimerHandle = phOsalNfc_Timer_Lookup(dwTimerId);
   /* OSAL Module and Timer needs to be initialized for timer usage */
   /* Check whether the TimerId provided by user is valid */
-  if ((dwIndex < PH_NFC_MAX_TIMER) && (0x00 != pTimerHandle->TimerId) &&
-      (pTimerHandle->eState != eTimerIdle)) {
+  if ((NULL != pTimerHandle) && (pTimerHandle->eState != eTimerIdle)) {
     /* Stop the timer only if the callback has not been invoked */
     if (pTimerHandle->eState == eTimerRunning) {
-      if ((timer_settime(pTimerHandle->hTimerHandle, 0, &its, NULL)) == -1) {
-        wStopStatus = PHNFCSTVAL(CID_NFC_OSAL, PH_OSALNFC_TIMER_STOP_ERROR);
-      } else {
-        /* Change the state of timer to Stopped */
-        pTimerHandle->eState = eTimerStopped;
-      }
+      /* Timer thread is left armed, a wake up with nothing to expire is
+       * harmless */
+      phOsalNfc_Timer_Unlink(pTimerHandle);
+      /* Change the state of timer to Stopped */
+      pTimerHandle->eState = eTimerStopped;
     }
   } else {
     wStopStatus = PHNFCSTVAL(CID_NFC_OSAL, NFCSTATUS_INVALID_PARAMETER);
   }
+  pthread_mutex_unlock(&gTimerWheel.lock);
 
   return wStopStatus;
 }
@@ -240,25 +323,19 @@ NFCSTATUS phOsalNfc_Timer_Stop(uint32_t dwTimerId) {
 NFCSTATUS phOsalNfc_Timer_Delete(uint32_t dwTimerId) {
   NFCSTATUS wDeleteStatus = NFCSTATUS_SUCCESS;
 
-  uint32_t dwIndex;
   phOsalNfc_TimerHandle_t* pTimerHandle;
-  dwIndex = dwTimerId - PH_NFC_TIMER_BASE_ADDRESS - 0x01;
-  pTimerHandle = (phOsalNfc_TimerHandle_t*)&apTimerInfo[dwIndex];
+  pthread_mutex_lock(&gTimerWheel.lock);
+  pTimerHandle = phOsalNfc_Timer_Lookup(dwTimerId);
   /* OSAL Module and Timer needs to be initialized for timer usage */
 
-  /* Check whether the TimerId passed by user is valid and Deregistering of
-   * timer is successful */
-  if ((dwIndex < PH_NFC_MAX_TIMER) && (0x00 != pTimerHandle->TimerId) &&
-      (NFCSTATUS_SUCCESS == phOsalNfc_CheckTimerPresence(pTimerHandle))) {
-    /* Cancel the timer before deleting */
-    if (timer_delete(pTimerHandle->hTimerHandle) == -1) {
-      wDeleteStatus = PHNFCSTVAL(CID_NFC_OSAL, PH_OSALNFC_TIMER_DELETE_ERROR);
-    }
-    /* Clear Timer structure used to store timer related data */
-    memset(pTimerHandle, (uint8_t)0x00, sizeof(phOsalNfc_TimerHandle_t));
+  /* Check whether the TimerId passed by user is valid */
+  if (NULL != pTimerHandle) {
+    /* Cancel the timer and free the slot */
+    phOsalNfc_Timer_Release(pTimerHandle);
   } else {
     wDeleteStatus = PHNFCSTVAL(CID_NFC_OSAL, NFCSTATUS_INVALID_PARAMETER);
   }
+  pthread_mutex_unlock(&gTimerWheel.lock);
   return wDeleteStatus;
 }
 
@@ -279,22 +356,25 @@ void phOsalNfc_Timer_Cleanup(void) {
   /* Delete all timers */
   uint32_t dwIndex;
   phOsalNfc_TimerHandle_t* pTimerHandle;
+  /* Timer thread is started again by the next phOsalNfc_Timer_Create */
+  phOsalNfc_Timer_ThreadStop();
+  pthread_mutex_lock(&gTimerWheel.lock);
   for (dwIndex = 0; dwIndex < PH_NFC_MAX_TIMER; dwIndex++) {
     pTimerHandle = (phOsalNfc_TimerHandle_t*)&apTimerInfo[dwIndex];
     /* OSAL Module and Timer needs to be initialized for timer usage */
 
     /* Check whether the TimerId passed by user is valid and Deregistering of
      * timer is successful */
-    if ((0x00 != pTimerHandle->TimerId) &&
-        (NFCSTATUS_SUCCESS == phOsalNfc_CheckTimerPresence(pTimerHandle))) {
-      /* Cancel the timer before deleting */
-      if (timer_delete(pTimerHandle->hTimerHandle) == -1) {
-        NXPLOG_TML_E("timer %d delete error!", dwIndex);
-      }
-      /* Clear Timer structure used to store timer related data */
-      memset(pTimerHandle, (uint8_t)0x00, sizeof(phOsalNfc_TimerHandle_t));
+    if (0x00 != pTimerHandle->TimerId) {
+      /* Cancel the timer and free the slot */
+      phOsalNfc_Timer_Release(pTimerHandle);
     }
   }
+  /* All slots are free again, generations are kept to reject stale IDs */
+  memset(abTimerExpiryQueued, 0x00, sizeof(abTimerExpiryQueued));
+  bTimerFreeHead = PH_NFC_TIMER_SLOT_NONE;
+  bTimerNbUsedSlots = 0;
+  pthread_mutex_unlock(&gTimerWheel.lock);
 
   return;
 }
@@ -314,16 +394,36 @@ void phOsalNfc_Timer_Cleanup(void) {
 *******************************************************************************/
 static void phOsalNfc_DeferredCall(void* pParams) {
   /* Retrieve the timer id from the parameter */
-  uint32_t dwIndex;
+  uint32_t dwTimerId = (uint32_t)((uintptr_t)pParams);
+  pphOsalNfc_TimerCallbck_t pCallback = NULL;
+  void* pContext = NULL;
   phOsalNfc_TimerHandle_t* pTimerHandle;
+  uint32_t dwIndex;
   if (NULL != pParams) {
-    /* Retrieve the index at which the timer handle structure is stored */
-    dwIndex = (uintptr_t)pParams - PH_NFC_TIMER_BASE_ADDRESS - 0x01;
-    pTimerHandle = (phOsalNfc_TimerHandle_t*)&apTimerInfo[dwIndex];
-    if (pTimerHandle->Application_callback != NULL) {
+    pthread_mutex_lock(&gTimerWheel.lock);
+    dwIndex = (dwTimerId & PH_NFC_TIMER_SLOT_MASK) -
+              PH_NFC_TIMER_BASE_ADDRESS - 0x01;
+    if ((dwIndex < PH_NFC_MAX_TIMER) && (abTimerExpiryQueued[dwIndex] > 0)) {
+      abTimerExpiryQueued[dwIndex]--;
+      /* Last expiry of a deleted timer, slot can be reused */
+      if ((0 == abTimerExpiryQueued[dwIndex]) &&
+          (PH_NFC_TIMER_SLOT_PARKED == abTimerFreeNext[dwIndex])) {
+        abTimerFreeNext[dwIndex] = bTimerFreeHead;
+        bTimerFreeHead = (uint8_t)dwIndex;
+      }
+    }
+    /* Timer may have been deleted since expiry was posted */
+    pTimerHandle = phOsalNfc_Timer_Lookup(dwTimerId);
+    if (NULL != pTimerHandle) {
+      pCallback = pTimerHandle->Application_callback;
+      pContext = pTimerHandle->pContext;
+    }
+    pthread_mutex_unlock(&gTimerWheel.lock);
+    if (pCallback != NULL) {
       /* Invoke the callback function with osal Timer ID */
-      pTimerHandle->Application_callback((uintptr_t)pParams,
-                                         pTimerHandle->pContext);
+      pCallback(dwTimerId, pContext);
+    } else {
+      NXPLOG_TML_D("Expiry of deleted timer 0x%x dropped", dwTimerId);
     }
   }
 
@@ -346,10 +446,12 @@ static void phOsalNfc_DeferredCall(void* pParams) {
 **
 *******************************************************************************/
 static void phOsalNfc_PostTimerMsg(phLibNfc_Message_t* pMsg) {
-  (void)phDal4Nfc_msgsnd(
-      nxpncihal_ctrl.gDrvCfg
-          .nClientId /*gpphOsalNfc_Context->dwCallbackThreadID*/,
-      pMsg, 0);
+  if (0 != phDal4Nfc_msgsnd(
+               nxpncihal_ctrl.gDrvCfg
+                   .nClientId /*gpphOsalNfc_Context->dwCallbackThreadID*/,
+               pMsg, 0)) {
+    NXPLOG_TML_E("Timer expiry message dropped");
+  }
 
   return;
 }
@@ -358,40 +460,41 @@ static void phOsalNfc_PostTimerMsg(phLibNfc_Message_t* pMsg) {
 **
 ** Function         phOsalNfc_Timer_Expired
 **
-** Description      posts message upon expiration of timer
-**                  Shall be invoked when any one timer is expired
-**                  Shall post message on user thread to invoke respective
-**                  callback function provided by the caller of Timer function
+** Description      prepares message upon expiration of timer
+**                  Shall be invoked by the timer thread, with the timer wheel
+**                  locked, when any one timer is expired
+**                  Message is posted on user thread, once the timer wheel is
+**                  unlocked, to invoke respective callback function provided
+**                  by the caller of Timer function
 **
-** Returns          None
+** Parameters       pTimerHandle - expired timer, already unlinked
+**
+** Returns          message to be posted on user thread
 **
 *******************************************************************************/
-static void phOsalNfc_Timer_Expired(union sigval sv) {
-  uint32_t dwIndex;
-  phOsalNfc_TimerHandle_t* pTimerHandle;
-
-  dwIndex = ((uint32_t)(sv.sival_int)) - PH_NFC_TIMER_BASE_ADDRESS - 0x01;
-  pTimerHandle = (phOsalNfc_TimerHandle_t*)&apTimerInfo[dwIndex];
+static phLibNfc_Message_t* phOsalNfc_Timer_Expired(
+    phOsalNfc_TimerHandle_t* pTimerHandle) {
   /* Timer is stopped when callback function is invoked */
   pTimerHandle->eState = eTimerStopped;
 
   pTimerHandle->tDeferedCallInfo.pDeferedCall = &phOsalNfc_DeferredCall;
-  pTimerHandle->tDeferedCallInfo.pParam = (void*)((intptr_t)(sv.sival_int));
+  pTimerHandle->tDeferedCallInfo.pParam =
+      (void*)((intptr_t)(pTimerHandle->TimerId));
+  abTimerExpiryQueued[pTimerHandle - &apTimerInfo[0]]++;
 
   pTimerHandle->tOsalMessage.eMsgType = PH_LIBNFC_DEFERREDCALL_MSG;
   pTimerHandle->tOsalMessage.pMsgData = (void*)&pTimerHandle->tDeferedCallInfo;
 
-  /* Post a message on the queue to invoke the function */
-  phOsalNfc_PostTimerMsg((phLibNfc_Message_t*)&pTimerHandle->tOsalMessage);
-
-  return;
+  /* Slot is parked by a delete until the message is dispatched, so the
+   * message stays valid after the timer wheel is unlocked */
+  return (phLibNfc_Message_t*)&pTimerHandle->tOsalMessage;
 }
 
 /*******************************************************************************
 **
 ** Function         phUtilNfc_CheckForAvailableTimer
 **
-** Description      Find an available timer id
+** Description      Find an available timer slot, the slot is not allocated
 **
 ** Parameters       void
 **
@@ -401,15 +504,13 @@ static void phOsalNfc_Timer_Expired(union sigval sv) {
 uint32_t phUtilNfc_CheckForAvailableTimer(void) {
   /* Variable used to store the index at which the object structure details
      can be stored. Initialize it as not available. */
-  uint32_t dwIndex = 0x00;
   uint32_t dwRetval = 0x00;
 
-  /* Check whether Timer object can be created */
-  for (dwIndex = 0x00; ((dwIndex < PH_NFC_MAX_TIMER) && (0x00 == dwRetval));
-       dwIndex++) {
-    if (!(apTimerInfo[dwIndex].TimerId)) {
-      dwRetval = (dwIndex + 0x01);
-    }
+  /* Check whether Timer object can be created, without allocating it */
+  if (PH_NFC_TIMER_SLOT_NONE != bTimerFreeHead) {
+    dwRetval = bTimerFreeHead + 0x01;
+  } else if (bTimerNbUsedSlots < PH_NFC_MAX_TIMER) {
+    dwRetval = bTimerNbUsedSlots + 0x01;
   }
 
   return (dwRetval);
@@ -428,17 +529,450 @@ uint32_t phUtilNfc_CheckForAvailableTimer(void) {
 **
 *******************************************************************************/
 NFCSTATUS phOsalNfc_CheckTimerPresence(void* pObjectHandle) {
-  uint32_t dwIndex;
   NFCSTATUS wRegisterStatus = NFCSTATUS_INVALID_PARAMETER;
+  uintptr_t dwOffset = (uintptr_t)pObjectHandle - (uintptr_t)&apTimerInfo[0];
 
-  for (dwIndex = 0x00;
-       ((dwIndex < PH_NFC_MAX_TIMER) && (wRegisterStatus != NFCSTATUS_SUCCESS));
-       dwIndex++) {
-    /* For Timer, check whether the requested handle is present or not */
-    if (((&apTimerInfo[dwIndex]) == (phOsalNfc_TimerHandle_t*)pObjectHandle) &&
-        (apTimerInfo[dwIndex].TimerId)) {
-      wRegisterStatus = NFCSTATUS_SUCCESS;
-    }
+  /* For Timer, check whether the requested handle is present or not */
+  if ((dwOffset < sizeof(apTimerInfo)) &&
+      (0 == (dwOffset % sizeof(phOsalNfc_TimerHandle_t))) &&
+      (((phOsalNfc_TimerHandle_t*)pObjectHandle)->TimerId)) {
+    wRegisterStatus = NFCSTATUS_SUCCESS;
   }
   return wRegisterStatus;
 }
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_AllocSlot
+**
+** Description      Takes a free timer slot, timer wheel shall be locked
+**
+** Parameters       None
+**
+** Returns          slot number (index + 1), 0 if all slots are used
+**
+*******************************************************************************/
+static uint32_t phOsalNfc_Timer_AllocSlot(void) {
+  uint32_t dwRetval = phUtilNfc_CheckForAvailableTimer();
+
+  if (PH_NFC_TIMER_SLOT_NONE != bTimerFreeHead) {
+    bTimerFreeHead = abTimerFreeNext[bTimerFreeHead];
+  } else if (0x00 != dwRetval) {
+    bTimerNbUsedSlots++;
+  }
+  return dwRetval;
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_Release
+**
+** Description      Cancels a timer and puts its slot back in the free list,
+**                  timer wheel shall be locked.
+**                  Posted message and deferred call info are kept, an expiry
+**                  still queued is dropped by phOsalNfc_DeferredCall which
+**                  then frees the slot.
+**
+** Parameters       pTimerHandle - created timer
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phOsalNfc_Timer_Release(phOsalNfc_TimerHandle_t* pTimerHandle) {
+  uint8_t bIndex = (uint8_t)(pTimerHandle - &apTimerInfo[0]);
+
+  phOsalNfc_Timer_Unlink(pTimerHandle);
+  pTimerHandle->TimerId = 0;
+  pTimerHandle->Application_callback = NULL;
+  pTimerHandle->pContext = NULL;
+  pTimerHandle->eState = eTimerIdle;
+  if (abTimerExpiryQueued[bIndex] > 0) {
+    abTimerFreeNext[bIndex] = PH_NFC_TIMER_SLOT_PARKED;
+  } else {
+    abTimerFreeNext[bIndex] = bTimerFreeHead;
+    bTimerFreeHead = bIndex;
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_Lookup
+**
+** Description      Retrieves the timer of a timer ID, timer wheel shall be
+**                  locked
+**
+** Parameters       dwTimerId - timer ID obtained during timer creation
+**
+** Returns          timer handle, NULL if the ID is invalid or the timer was
+**                  deleted
+**
+*******************************************************************************/
+static phOsalNfc_TimerHandle_t* phOsalNfc_Timer_Lookup(uint32_t dwTimerId) {
+  uint32_t dwIndex = (dwTimerId & PH_NFC_TIMER_SLOT_MASK) -
+                     PH_NFC_TIMER_BASE_ADDRESS - 0x01;
+
+  if ((dwIndex < PH_NFC_MAX_TIMER) &&
+      (0x00 != apTimerInfo[dwIndex].TimerId) &&
+      (dwTimerId == apTimerInfo[dwIndex].TimerId)) {
+    return &apTimerInfo[dwIndex];
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_ThreadStart
+**
+** Description      Creates the timer thread and its timerfd, if not running
+**
+** Parameters       None
+**
+** Returns          NFCSTATUS_SUCCESS if timer thread is running
+**                  NFCSTATUS_FAILED otherwise
+**
+*******************************************************************************/
+static NFCSTATUS phOsalNfc_Timer_ThreadStart(void) {
+  NFCSTATUS wStatus = NFCSTATUS_SUCCESS;
+
+  pthread_mutex_lock(&gTimerWheel.lock);
+  if (gTimerWheel.nTimerFd < 0) {
+    gTimerWheel.nTimerFd =
+        timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (gTimerWheel.nTimerFd < 0) {
+      NXPLOG_TML_E("timerfd_create failed errno : %x", errno);
+      wStatus = NFCSTATUS_FAILED;
+    } else {
+      gTimerWheel.qwCurrTick = phOsalNfc_Timer_NowUs() / 1000;
+      gTimerWheel.qwArmedTick = 0;
+      gTimerWheel.bThreadRun = true;
+      if (0 != pthread_create(&gTimerWheel.thread, NULL,
+                              phOsalNfc_Timer_Thread, NULL)) {
+        NXPLOG_TML_E("timer thread creation failed");
+        close(gTimerWheel.nTimerFd);
+        gTimerWheel.nTimerFd = -1;
+        gTimerWheel.bThreadRun = false;
+        wStatus = NFCSTATUS_FAILED;
+      }
+    }
+  }
+  pthread_mutex_unlock(&gTimerWheel.lock);
+
+  return wStatus;
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_ThreadStop
+**
+** Description      Terminates the timer thread, shall not be called from a
+**                  timer callback
+**
+** Parameters       None
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phOsalNfc_Timer_ThreadStop(void) {
+  struct itimerspec its = {{0, 0}, {0, 1}};
+
+  pthread_mutex_lock(&gTimerWheel.lock);
+  if (gTimerWheel.nTimerFd < 0) {
+    pthread_mutex_unlock(&gTimerWheel.lock);
+    return;
+  }
+  gTimerWheel.bThreadRun = false;
+  /* Wake up the timer thread right away */
+  (void)timerfd_settime(gTimerWheel.nTimerFd, 0, &its, NULL);
+  pthread_mutex_unlock(&gTimerWheel.lock);
+
+  pthread_join(gTimerWheel.thread, NULL);
+
+  pthread_mutex_lock(&gTimerWheel.lock);
+  close(gTimerWheel.nTimerFd);
+  gTimerWheel.nTimerFd = -1;
+  gTimerWheel.qwArmedTick = 0;
+  pthread_mutex_unlock(&gTimerWheel.lock);
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_Thread
+**
+** Description      Timer thread, expires the timers whenever the timerfd
+**                  armed for the next tick needing processing fires
+**
+** Parameters       pParam - unused
+**
+** Returns          None
+**
+*******************************************************************************/
+static void* phOsalNfc_Timer_Thread(void* pParam) {
+  uint64_t qwExpirations;
+  ssize_t nRead;
+  phLibNfc_Message_t* apExpiredMsg[PH_NFC_MAX_TIMER];
+  uint32_t dwNbExpired;
+  uint32_t i;
+  UNUSED(pParam);
+
+  NXPLOG_TML_D("OSAL timer thread started");
+  while (1) {
+    nRead = read(gTimerWheel.nTimerFd, &qwExpirations, sizeof(qwExpirations));
+    if ((nRead < 0) && (errno != EINTR)) {
+      NXPLOG_TML_E("timerfd read failed errno : %x", errno);
+    }
+    pthread_mutex_lock(&gTimerWheel.lock);
+    if (!gTimerWheel.bThreadRun) {
+      pthread_mutex_unlock(&gTimerWheel.lock);
+      break;
+    }
+    gTimerWheel.qwArmedTick = 0;
+    dwNbExpired = 0;
+    phOsalNfc_Timer_Advance(phOsalNfc_Timer_NowUs() / 1000, apExpiredMsg,
+                            &dwNbExpired);
+    phOsalNfc_Timer_Arm(phOsalNfc_Timer_NextTick());
+    pthread_mutex_unlock(&gTimerWheel.lock);
+    /* Posted unlocked: the client thread, which drains the message queue,
+     * takes the timer wheel lock and the post waits while the queue is full */
+    for (i = 0; i < dwNbExpired; i++) {
+      phOsalNfc_PostTimerMsg(apExpiredMsg[i]);
+    }
+  }
+  NXPLOG_TML_D("OSAL timer thread exiting");
+
+  return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_NowUs
+**
+** Description      Returns CLOCK_MONOTONIC time, not affected by wall-clock
+**                  changes
+**
+** Parameters       None
+**
+** Returns          time in microseconds
+**
+*******************************************************************************/
+static uint64_t phOsalNfc_Timer_NowUs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000) + ((uint64_t)ts.tv_nsec / 1000);
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_Link
+**
+** Description      Inserts a timer in the wheel slot matching its expiry,
+**                  timer wheel shall be locked
+**
+** Parameters       pTimerHandle - timer to be inserted, not linked
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phOsalNfc_Timer_Link(phOsalNfc_TimerHandle_t* pTimerHandle) {
+  phOsalNfc_TimerHandle_t** ppSlot;
+  uint64_t qwExpiry = pTimerHandle->qwExpiryTick;
+  uint64_t qwDelta;
+  uint32_t dwLevel;
+
+  /* Current tick is already processed */
+  if (qwExpiry <= gTimerWheel.qwCurrTick) {
+    qwExpiry = gTimerWheel.qwCurrTick + 1;
+  }
+  qwDelta = qwExpiry - gTimerWheel.qwCurrTick;
+  if (qwDelta < PH_NFC_TIMER_WHEEL_L0_SIZE) {
+    ppSlot = &gTimerWheel.apL0[qwExpiry & (PH_NFC_TIMER_WHEEL_L0_SIZE - 1)];
+  } else {
+    for (dwLevel = 0; dwLevel < (PH_NFC_TIMER_WHEEL_LN_NB - 1); dwLevel++) {
+      if (qwDelta < (1ULL << PH_NFC_TIMER_WHEEL_SHIFT(dwLevel + 1))) {
+        break;
+      }
+    }
+    if (qwDelta > PH_NFC_TIMER_WHEEL_MAX_TICKS) {
+      qwExpiry = gTimerWheel.qwCurrTick + PH_NFC_TIMER_WHEEL_MAX_TICKS;
+    }
+    ppSlot = &gTimerWheel.apLn[dwLevel]
+                              [(qwExpiry >> PH_NFC_TIMER_WHEEL_SHIFT(dwLevel)) &
+                               (PH_NFC_TIMER_WHEEL_LN_SIZE - 1)];
+  }
+
+  pTimerHandle->ppSlot = ppSlot;
+  pTimerHandle->pPrev = NULL;
+  pTimerHandle->pNext = *ppSlot;
+  if (NULL != *ppSlot) {
+    (*ppSlot)->pPrev = pTimerHandle;
+  }
+  *ppSlot = pTimerHandle;
+  gTimerWheel.dwNbActive++;
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_Unlink
+**
+** Description      Removes a timer from its wheel slot, timer wheel shall be
+**                  locked
+**
+** Parameters       pTimerHandle - linked timer
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phOsalNfc_Timer_Unlink(phOsalNfc_TimerHandle_t* pTimerHandle) {
+  if (NULL == pTimerHandle->ppSlot) {
+    return;
+  }
+  if (NULL != pTimerHandle->pPrev) {
+    pTimerHandle->pPrev->pNext = pTimerHandle->pNext;
+  } else {
+    *pTimerHandle->ppSlot = pTimerHandle->pNext;
+  }
+  if (NULL != pTimerHandle->pNext) {
+    pTimerHandle->pNext->pPrev = pTimerHandle->pPrev;
+  }
+  pTimerHandle->pNext = NULL;
+  pTimerHandle->pPrev = NULL;
+  pTimerHandle->ppSlot = NULL;
+  gTimerWheel.dwNbActive--;
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_Advance
+**
+** Description      Processes all ticks up to qwNowTick: moves timers down a
+**                  level when the wheel reaches their slot and expires the
+**                  timers of level 0. Timer wheel shall be locked.
+**
+** Parameters       qwNowTick - current tick
+**                  ppExpiredMsg - receives the messages of the expired timers,
+**                                 PH_NFC_MAX_TIMER entries
+**                  pNbExpired - number of entries added to ppExpiredMsg
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phOsalNfc_Timer_Advance(uint64_t qwNowTick,
+                                    phLibNfc_Message_t** ppExpiredMsg,
+                                    uint32_t* pNbExpired) {
+  phOsalNfc_TimerHandle_t* pTimerHandle;
+  phOsalNfc_TimerHandle_t** ppSlot;
+  uint64_t qwNextTick;
+  uint32_t dwLevel;
+  uint32_t dwIndex;
+
+  while (gTimerWheel.qwCurrTick < qwNowTick) {
+    /* Ticks in between have nothing to process */
+    qwNextTick = phOsalNfc_Timer_NextTick();
+    if ((0 == qwNextTick) || (qwNextTick > qwNowTick)) {
+      gTimerWheel.qwCurrTick = qwNowTick;
+      break;
+    }
+    gTimerWheel.qwCurrTick = qwNextTick;
+    /* Cascade upper levels at each level 0 wrap around */
+    for (dwLevel = 0; (dwLevel < PH_NFC_TIMER_WHEEL_LN_NB) &&
+                      (0 == (gTimerWheel.qwCurrTick &
+                             ((1ULL << PH_NFC_TIMER_WHEEL_SHIFT(dwLevel)) - 1)));
+         dwLevel++) {
+      dwIndex = (gTimerWheel.qwCurrTick >> PH_NFC_TIMER_WHEEL_SHIFT(dwLevel)) &
+                (PH_NFC_TIMER_WHEEL_LN_SIZE - 1);
+      ppSlot = &gTimerWheel.apLn[dwLevel][dwIndex];
+      while (NULL != (pTimerHandle = *ppSlot)) {
+        phOsalNfc_Timer_Unlink(pTimerHandle);
+        phOsalNfc_Timer_Link(pTimerHandle);
+      }
+      if (0 != dwIndex) {
+        break;
+      }
+    }
+    ppSlot = &gTimerWheel.apL0[gTimerWheel.qwCurrTick &
+                               (PH_NFC_TIMER_WHEEL_L0_SIZE - 1)];
+    while (NULL != (pTimerHandle = *ppSlot)) {
+      phOsalNfc_Timer_Unlink(pTimerHandle);
+      /* An unlinked timer is relinked only by a start, with the timer wheel
+       * unlocked, so each timer expires at most once */
+      ppExpiredMsg[(*pNbExpired)++] = phOsalNfc_Timer_Expired(pTimerHandle);
+    }
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_NextTick
+**
+** Description      Finds the next tick at which timers expire or move down a
+**                  level. Timer wheel shall be locked.
+**
+** Parameters       None
+**
+** Returns          next tick, 0 if no timer is running
+**
+*******************************************************************************/
+static uint64_t phOsalNfc_Timer_NextTick(void) {
+  uint64_t qwNext = 0;
+  uint64_t qwTick;
+  uint32_t dwLevel;
+  uint32_t i;
+
+  if (0 == gTimerWheel.dwNbActive) {
+    return 0;
+  }
+  for (i = 1; i <= PH_NFC_TIMER_WHEEL_L0_SIZE; i++) {
+    qwTick = gTimerWheel.qwCurrTick + i;
+    if (NULL !=
+        gTimerWheel.apL0[qwTick & (PH_NFC_TIMER_WHEEL_L0_SIZE - 1)]) {
+      qwNext = qwTick;
+      break;
+    }
+  }
+  /* Slot of an upper level is processed when the wheel reaches its start */
+  for (dwLevel = 0; dwLevel < PH_NFC_TIMER_WHEEL_LN_NB; dwLevel++) {
+    for (i = 1; i <= PH_NFC_TIMER_WHEEL_LN_SIZE; i++) {
+      qwTick = ((gTimerWheel.qwCurrTick >> PH_NFC_TIMER_WHEEL_SHIFT(dwLevel)) +
+                i);
+      if (NULL != gTimerWheel.apLn[dwLevel][qwTick &
+                                            (PH_NFC_TIMER_WHEEL_LN_SIZE - 1)]) {
+        qwTick <<= PH_NFC_TIMER_WHEEL_SHIFT(dwLevel);
+        if ((0 == qwNext) || (qwTick < qwNext)) {
+          qwNext = qwTick;
+        }
+        break;
+      }
+    }
+  }
+  return qwNext;
+}
+
+/*******************************************************************************
+**
+** Function         phOsalNfc_Timer_Arm
+**
+** Description      Arms the timer thread for a tick, disarms it for tick 0.
+**                  Timer wheel shall be locked.
+**
+** Parameters       qwTick - tick to wake up the timer thread at
+**
+** Returns          None, qwArmedTick is left 0 on failure
+**
+*******************************************************************************/
+static void phOsalNfc_Timer_Arm(uint64_t qwTick) {
+  struct itimerspec its = {{0, 0}, {0, 0}};
+
+  if (qwTick == gTimerWheel.qwArmedTick) {
+    return;
+  }
+  if (0 != qwTick) {
+    its.it_value.tv_sec = (time_t)(qwTick / 1000);
+    its.it_value.tv_nsec = (long)((qwTick % 1000) * 1000000);
+  }
+  if (0 != timerfd_settime(gTimerWheel.nTimerFd, TFD_TIMER_ABSTIME, &its,
+                           NULL)) {
+    NXPLOG_TML_E("timerfd_settime failed errno : %x", errno);
+    qwTick = 0;
+  }
+  gTimerWheel.qwArmedTick = qwTick;
+}
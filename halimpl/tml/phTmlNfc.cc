@@ -23,7 +23,9 @@
 #include <phNxpLog.h>
 #include <phDal4Nfc_messageQueueLib.h>
 #include <phTmlNfc_i2c.h>
+#include <phTmlNfc_sim.h>
 #include <phNxpNciHal_utils.h>
+#include <phNxpNciHal_latency.h>
 #include <errno.h>
 
 /*
@@ -32,6 +34,10 @@
 #define PHTMLNFC_MAXTIME_RETRANSMIT (200U)
 #define MAX_WRITE_RETRY_COUNT 0x03
 #define MAX_READ_RETRY_COUNT 0x05
+/* Max time reader waits for write completion to be posted before posting a
+ * response (and a notification received while a write is ongoing) */
+#define PHTMLNFC_WAIT_WRITE_RSP_TIMEOUT_MS (1000U)
+#define PHTMLNFC_WAIT_WRITE_NTF_TIMEOUT_MS (2U)
 
 /* Retry Count = Standby Recovery time of NFCC / Retransmission time + 1 */
 static uint8_t bCurrentRetryCount = (2000 / PHTMLNFC_MAXTIME_RETRANSMIT) + 1;
@@ -53,9 +59,10 @@ static void* phTmlNfc_TmlThread(void* pParam);
 static void* phTmlNfc_TmlWriterThread(void* pParam);
 static void phTmlNfc_ReTxTimerCb(uint32_t dwTimerId, void* pContext);
 static NFCSTATUS phTmlNfc_InitiateTimer(void);
-static void phTmlNfc_WaitWriteComplete(void);
+static void phTmlNfc_WaitWriteComplete(uint32_t dwTimeoutMs);
 static void phTmlNfc_SignalWriteComplete(void);
 static int phTmlNfc_WaitReadInit(void);
+static phTmlNfc_RxSlot_t* phTmlNfc_AcquireRxSlot(void);
 
 /* Function definitions */
 
@@ -105,9 +112,17 @@ NFCSTATUS phTmlNfc_Init(pphTmlNfc_Config_t pConfig) {
              sizeof(phTmlNfc_Context_t));
       /* Make sure that the thread runs once it is created */
       gpphTmlNfc_Context->bThreadDone = 1;
+      /* Select the backend through which NFCC is reached */
+      if (ENUM_LINK_TYPE_SIM == pConfig->eLinkType) {
+        gpphTmlNfc_Context->pTransport = &gphTmlNfc_SimTransport;
+      } else {
+        gpphTmlNfc_Context->pTransport = &gphTmlNfc_I2cTransport;
+      }
+      NXPLOG_TML_D("PN54X - Transport %s",
+                   gpphTmlNfc_Context->pTransport->pName);
 
       /* Open the device file to which data is read/written */
-      wInitStatus = phTmlNfc_i2c_open_and_configure(
+      wInitStatus = gpphTmlNfc_Context->pTransport->open_and_configure(
           pConfig, &(gpphTmlNfc_Context->pDevHandle));
 
       if (NFCSTATUS_SUCCESS != wInitStatus) {
@@ -130,7 +145,11 @@ NFCSTATUS phTmlNfc_Init(pphTmlNfc_Config_t pConfig) {
           wInitStatus = NFCSTATUS_FAILED;
         } else if (0 != sem_init(&gpphTmlNfc_Context->postMsgSemaphore, 0, 0)) {
           wInitStatus = NFCSTATUS_FAILED;
+        } else if (0 != sem_init(&gpphTmlNfc_Context->rxPoolSemaphore, 0,
+                                 PH_TMLNFC_RX_POOL_SIZE)) {
+          wInitStatus = NFCSTATUS_FAILED;
         } else {
+          gpphTmlNfc_Context->bRxPoolDepth = PH_TMLNFC_RX_POOL_SIZE;
           sem_post(&gpphTmlNfc_Context->postMsgSemaphore);
           /* Start TML thread (to handle write and read operations) */
           if (NFCSTATUS_SUCCESS != phTmlNfc_StartThread()) {
@@ -308,10 +327,14 @@ static NFCSTATUS phTmlNfc_InitiateTimer(void) {
 static void* phTmlNfc_TmlThread(void* pParam) {
   NFCSTATUS wStatus = NFCSTATUS_SUCCESS;
   int32_t dwNoBytesWrRd = PH_TMLNFC_RESET_VALUE;
-  uint8_t temp[260];
   uint8_t read_count = 0;
+  /* Rx buffer slot the driver reads into */
+  phTmlNfc_RxSlot_t* pRxSlot = NULL;
+  /* Read stays enabled (streaming mode or read re-requested after abort),
+   * no need to wait for the upper layer to signal the reader thread */
+  bool_t bReadArmed = false;
 
-  /* Transaction info buffer to be passed to Callback Thread */
+  /* Transaction info buffer to be passed to Callback Thread on read failure */
   static phTmlNfc_TransactInfo_t tTransactionInfo;
   /* Structure containing Tml callback function and parameters to be invoked
      by the callback thread */
@@ -326,7 +349,10 @@ static void* phTmlNfc_TmlThread(void* pParam) {
     /* If Tml write is requested */
     /* Set the variable to success initially */
     wStatus = NFCSTATUS_SUCCESS;
-    sem_wait(&gpphTmlNfc_Context->rxSemaphore);
+    if (!bReadArmed) {
+      sem_wait(&gpphTmlNfc_Context->rxSemaphore);
+    }
+    bReadArmed = false;
 
     /* If Tml read is requested */
     if (1 == gpphTmlNfc_Context->tReadInfo.bEnable) {
@@ -339,12 +365,25 @@ static void* phTmlNfc_TmlThread(void* pParam) {
 
       /* Read the data from the file onto the buffer */
       if (((uintptr_t)gpphTmlNfc_Context->pDevHandle) > 0) {
+        /* Wait for a free Rx buffer, upper layer may still hold the others */
+        pRxSlot = phTmlNfc_AcquireRxSlot();
+        if (NULL == pRxSlot) {
+          NXPLOG_TML_D("PN54X - No Rx buffer, thread terminating.....\n");
+          continue;
+        }
         NXPLOG_TML_D("PN54X - Invoking I2C Read.....\n");
-        dwNoBytesWrRd =
-            phTmlNfc_i2c_read(gpphTmlNfc_Context->pDevHandle, temp, 260);
-
-        if (-1 == dwNoBytesWrRd) {
+        dwNoBytesWrRd = gpphTmlNfc_Context->pTransport->read(
+            gpphTmlNfc_Context->pDevHandle, pRxSlot->aBuff,
+            PH_TMLNFC_RX_BUFF_LEN);
+
+        if (PH_TMLNFC_READ_ABORTED == dwNoBytesWrRd) {
+          NXPLOG_TML_D("PN54X - I2C Read aborted.....\n");
+          phTmlNfc_ReleaseRxBuffer(&pRxSlot->tTransactInfo);
+          /* Read may have been requested again right after the abort */
+          bReadArmed = (1 == gpphTmlNfc_Context->tReadInfo.bEnable);
+        } else if (-1 == dwNoBytesWrRd) {
             NXPLOG_TML_E("PN54X - Error in I2C Read.....\n");
+            phTmlNfc_ReleaseRxBuffer(&pRxSlot->tTransactInfo);
             if(nfcFL.nfccFL._NFCC_I2C_READ_WRITE_IMPROVEMENT) {
                 if (read_count <= MAX_READ_RETRY_COUNT) {
                     read_count++;
@@ -355,6 +394,7 @@ static void* phTmlNfc_TmlThread(void* pParam) {
                     /* Fill the Transaction info structure to be passed to Callback
                      * Function */
                     tTransactionInfo.wStatus = NFCSTATUS_READ_FAILED;
+                    tTransactionInfo.pRxSlot = NULL;
                     // tTransactionInfo.pBuff = gpphTmlNfc_Context->tReadInfo.pBuffer;
                     /* Actual number of bytes read is filled in the structure */
                     // tTransactionInfo.wLength = gpphTmlNfc_Context->tReadInfo.wLength;
@@ -373,25 +413,42 @@ static void* phTmlNfc_TmlThread(void* pParam) {
                     return NULL;
                 }
             }
-          sem_post(&gpphTmlNfc_Context->rxSemaphore);
-        } else if (dwNoBytesWrRd > 260) {
+          if (gpphTmlNfc_Context->bReadStreamDepth) {
+            bReadArmed = true;
+          } else {
+            sem_post(&gpphTmlNfc_Context->rxSemaphore);
+          }
+        } else if (dwNoBytesWrRd > PH_TMLNFC_RX_BUFF_LEN) {
           NXPLOG_TML_E("Numer of bytes read exceeds the limit 260.....\n");
+          phTmlNfc_ReleaseRxBuffer(&pRxSlot->tTransactInfo);
           if(nfcFL.nfccFL._NFCC_I2C_READ_WRITE_IMPROVEMENT) {
               read_count = 0;
           }
-          sem_post(&gpphTmlNfc_Context->rxSemaphore);
+          if (gpphTmlNfc_Context->bReadStreamDepth) {
+            bReadArmed = true;
+          } else {
+            sem_post(&gpphTmlNfc_Context->rxSemaphore);
+          }
         } else {
+          if (gpphTmlNfc_Context->pTransport->get_download_flag() == false) {
+            phNxpNciHal_latency_mark(PH_NXPNCIHAL_LAT_TML_READ,
+                                     pRxSlot->aBuff, (uint16_t)dwNoBytesWrRd);
+          }
           pthread_mutex_lock(&gpphTmlNfc_Context->readInfoUpdateMutex);
-          memcpy(gpphTmlNfc_Context->tReadInfo.pBuffer, temp, dwNoBytesWrRd);
           if(nfcFL.nfccFL._NFCC_I2C_READ_WRITE_IMPROVEMENT) {
               read_count = 0;
           }
           NXPLOG_TML_D("PN54X - I2C Read successful.....len = %d\n",
                        dwNoBytesWrRd);
-          /* This has to be reset only after a successful read */
-          gpphTmlNfc_Context->tReadInfo.bEnable = 0;
+          /* This has to be reset only after a successful read, in streaming
+           * mode the next read is started right away until read abort */
+          if (gpphTmlNfc_Context->bReadStreamDepth) {
+            bReadArmed = (1 == gpphTmlNfc_Context->tReadInfo.bEnable);
+          } else {
+            gpphTmlNfc_Context->tReadInfo.bEnable = 0;
+          }
           if ((phTmlNfc_e_EnableRetrans == gpphTmlNfc_Context->eConfig) &&
-              (0x00 != (gpphTmlNfc_Context->tReadInfo.pBuffer[0] & 0xE0))) {
+              (0x00 != (pRxSlot->aBuff[0] & 0xE0))) {
             NXPLOG_TML_D("PN54X - Retransmission timer stopped.....\n");
             /* Stop Timer to prevent Retransmission */
             uint32_t timerStatus =
@@ -402,43 +459,45 @@ static void* phTmlNfc_TmlThread(void* pParam) {
               gpphTmlNfc_Context->bWriteCbInvoked = false;
             }
           }
-          if (gpphTmlNfc_Context->tWriteInfo.bThreadBusy) {
-            NXPLOG_TML_D("Delay Read if write thread is busy");
-            usleep(2000); /*2ms delay to give prio to write complete */
-          }
           /* Update the actual number of bytes read including header */
+          gpphTmlNfc_Context->tReadInfo.pBuffer = pRxSlot->aBuff;
           gpphTmlNfc_Context->tReadInfo.wLength = (uint16_t)(dwNoBytesWrRd);
           dwNoBytesWrRd = PH_TMLNFC_RESET_VALUE;
           /* Fill the Transaction info structure to be passed to Callback
-           * Function */
-          tTransactionInfo.wStatus = wStatus;
-          tTransactionInfo.pBuff = gpphTmlNfc_Context->tReadInfo.pBuffer;
+           * Function, data is handed over in the Rx slot without copy */
+          pRxSlot->tTransactInfo.wStatus = wStatus;
+          pRxSlot->tTransactInfo.pBuff = pRxSlot->aBuff;
           /* Actual number of bytes read is filled in the structure */
-          tTransactionInfo.wLength = gpphTmlNfc_Context->tReadInfo.wLength;
+          pRxSlot->tTransactInfo.wLength =
+              gpphTmlNfc_Context->tReadInfo.wLength;
 
           /* Read operation completed successfully. Post a Message onto Callback
            * Thread*/
           /* Prepare the message to be posted on User thread */
-          tDeferredInfo.pCallback = &phTmlNfc_ReadDeferredCb;
-          tDeferredInfo.pParameter = &tTransactionInfo;
+          pRxSlot->tDeferredInfo.pCallback = &phTmlNfc_ReadDeferredCb;
+          pRxSlot->tDeferredInfo.pParameter = &pRxSlot->tTransactInfo;
           tMsg.eMsgType = PH_LIBNFC_DEFERREDCALL_MSG;
-          tMsg.pMsgData = &tDeferredInfo;
-          tMsg.Size = sizeof(tDeferredInfo);
-          /*Don't wait for posting notifications. Only wait for posting
-           * responses*/
+          tMsg.pMsgData = &pRxSlot->tDeferredInfo;
+          tMsg.Size = sizeof(pRxSlot->tDeferredInfo);
+          /*Responses are posted only after the write completion. A
+           * notification is delayed briefly only while a write is ongoing,
+           * to give prio to write complete*/
           /*TML reader writer callback syncronization-- START*/
           pthread_mutex_lock(&gpphTmlNfc_Context->wait_busy_lock);
-          if ((gpphTmlNfc_Context->gWriterCbflag == false) &&
-              ((gpphTmlNfc_Context->tReadInfo.pBuffer[0] & 0x60) != 0x60)) {
-            phTmlNfc_WaitWriteComplete();
+          if (gpphTmlNfc_Context->gWriterCbflag == false) {
+            if ((pRxSlot->aBuff[0] & 0x60) != 0x60) {
+              phTmlNfc_WaitWriteComplete(PHTMLNFC_WAIT_WRITE_RSP_TIMEOUT_MS);
+            } else if (gpphTmlNfc_Context->tWriteInfo.bThreadBusy) {
+              NXPLOG_TML_D("Delay Read if write thread is busy");
+              phTmlNfc_WaitWriteComplete(PHTMLNFC_WAIT_WRITE_NTF_TIMEOUT_MS);
+            }
           }
           /*TML reader writer callback syncronization-- END*/
           pthread_mutex_unlock(&gpphTmlNfc_Context->wait_busy_lock);
           pthread_mutex_unlock(&gpphTmlNfc_Context->readInfoUpdateMutex);
           NXPLOG_TML_D("PN54X - Posting read message.....\n");
-          phNxpNciHal_print_packet("RECV",
-                                   gpphTmlNfc_Context->tReadInfo.pBuffer,
-                                   gpphTmlNfc_Context->tReadInfo.wLength);
+          phNxpNciHal_print_packet("RECV", pRxSlot->aBuff,
+                                   pRxSlot->tTransactInfo.wLength);
           phTmlNfc_DeferredCall(gpphTmlNfc_Context->dwCallbackThreadId, &tMsg);
         }
       } else {
@@ -448,7 +507,6 @@ static void* phTmlNfc_TmlThread(void* pParam) {
       }
     } else {
       NXPLOG_TML_D("PN54X - read request NOT enabled");
-      usleep(10 * 1000);
     }
   } /* End of While loop */
 
@@ -500,13 +558,14 @@ static void* phTmlNfc_TmlWriterThread(void* pParam) {
         NXPLOG_TML_D("PN54X - Invoking I2C Write.....\n");
         gpphTmlNfc_Context->gWriterCbflag = false;
         dwNoBytesWrRd =
-            phTmlNfc_i2c_write(gpphTmlNfc_Context->pDevHandle,
-                               gpphTmlNfc_Context->tWriteInfo.pBuffer,
-                               gpphTmlNfc_Context->tWriteInfo.wLength);
+            gpphTmlNfc_Context->pTransport->write(
+                gpphTmlNfc_Context->pDevHandle,
+                gpphTmlNfc_Context->tWriteInfo.pBuffer,
+                gpphTmlNfc_Context->tWriteInfo.wLength);
 
         /* Try I2C Write Five Times, if it fails : Raju */
         if (-1 == dwNoBytesWrRd) {
-          if (getDownloadFlag() == true) {
+          if (gpphTmlNfc_Context->pTransport->get_download_flag() == true) {
             if (retry_cnt++ < MAX_WRITE_RETRY_COUNT) {
               NXPLOG_NCIHAL_E("PN54X - Error in I2C Write  - Retry 0x%x",
                               retry_cnt);
@@ -518,6 +577,11 @@ static void* phTmlNfc_TmlWriterThread(void* pParam) {
           NXPLOG_TML_E("PN54X - Error in I2C Write.....\n");
           wStatus = PHNFCSTVAL(CID_NFC_TML, NFCSTATUS_FAILED);
         } else {
+          if (gpphTmlNfc_Context->pTransport->get_download_flag() == false) {
+            phNxpNciHal_latency_mark(PH_NXPNCIHAL_LAT_TML_WRITE,
+                                     gpphTmlNfc_Context->tWriteInfo.pBuffer,
+                                     gpphTmlNfc_Context->tWriteInfo.wLength);
+          }
           phNxpNciHal_print_packet("SEND",
                                    gpphTmlNfc_Context->tWriteInfo.pBuffer,
                                    gpphTmlNfc_Context->tWriteInfo.wLength);
@@ -591,7 +655,6 @@ static void* phTmlNfc_TmlWriterThread(void* pParam) {
       }
     } else {
       NXPLOG_TML_D("PN54X - Write request NOT enabled");
-      usleep(10000);
     }
 
   } /* End of While loop */
@@ -616,15 +679,19 @@ void phTmlNfc_CleanUp(void) {
     return;
   }
   if (NULL != gpphTmlNfc_Context->pDevHandle) {
-    (void)phTmlNfc_i2c_reset(gpphTmlNfc_Context->pDevHandle, 0);
+    (void)gpphTmlNfc_Context->pTransport->reset(
+        gpphTmlNfc_Context->pDevHandle, 0);
     gpphTmlNfc_Context->bThreadDone = 0;
   }
   sem_destroy(&gpphTmlNfc_Context->rxSemaphore);
   sem_destroy(&gpphTmlNfc_Context->txSemaphore);
   sem_destroy(&gpphTmlNfc_Context->postMsgSemaphore);
+  sem_destroy(&gpphTmlNfc_Context->rxPoolSemaphore);
   pthread_mutex_destroy(&gpphTmlNfc_Context->wait_busy_lock);
   pthread_cond_destroy(&gpphTmlNfc_Context->wait_busy_condition);
-  phTmlNfc_i2c_close(gpphTmlNfc_Context->pDevHandle);
+  if (NULL != gpphTmlNfc_Context->pTransport) {
+    gpphTmlNfc_Context->pTransport->close(gpphTmlNfc_Context->pDevHandle);
+  }
   gpphTmlNfc_Context->pDevHandle = NULL;
   /* Clear memory allocated for storing Context variables */
   free((void*)gpphTmlNfc_Context);
@@ -656,12 +723,15 @@ NFCSTATUS phTmlNfc_Shutdown(void) {
   if (NULL != gpphTmlNfc_Context) {
     /* Reset thread variable to terminate the thread */
     gpphTmlNfc_Context->bThreadDone = 0;
+    gpphTmlNfc_Context->pTransport->abort_read();
     usleep(1000);
     /* Clear All the resources allocated during initialization */
     sem_post(&gpphTmlNfc_Context->rxSemaphore);
     usleep(1000);
     sem_post(&gpphTmlNfc_Context->txSemaphore);
     usleep(1000);
+    sem_post(&gpphTmlNfc_Context->rxPoolSemaphore);
+    usleep(1000);
     sem_post(&gpphTmlNfc_Context->postMsgSemaphore);
     usleep(1000);
     sem_post(&gpphTmlNfc_Context->postMsgSemaphore);
@@ -795,8 +865,9 @@ NFCSTATUS phTmlNfc_UpdateReadCompleteCallback (
 **                  Returns successfully once read operation is completed
 **                  Notifies upper layer using callback mechanism
 **
-** Parameters       pBuffer - location to send read data to the upper layer via
-**                            callback
+** Parameters       pBuffer - buffer of the upper layer, read data is delivered
+**                            in a TML owned Rx buffer via the callback
+**                            (pInfo->pBuff) and not copied into pBuffer
 **                  wLength - length of read data buffer passed by upper layer
 **                  pTmlReadComplete - pointer to the function to be invoked
 **                                     upon completion of read operation
@@ -808,6 +879,10 @@ NFCSTATUS phTmlNfc_UpdateReadCompleteCallback (
 **                                                invalid
 **                  NFCSTATUS_BUSY - read request is already in progress
 **
+**                  In streaming read mode (see phTmlNfc_ConfigReadStreaming)
+**                  the read stays enabled after each packet, calling this
+**                  function again only updates the completion callback.
+**
 *******************************************************************************/
 NFCSTATUS phTmlNfc_Read(uint8_t* pBuffer, uint16_t wLength,
                         pphTmlNfc_TransactCompletionCb_t pTmlReadComplete,
@@ -818,7 +893,18 @@ NFCSTATUS phTmlNfc_Read(uint8_t* pBuffer, uint16_t wLength,
   if (NULL != gpphTmlNfc_Context) {
     if ((gpphTmlNfc_Context->pDevHandle != NULL) && (NULL != pBuffer) &&
         (PH_TMLNFC_RESET_VALUE != wLength) && (NULL != pTmlReadComplete)) {
-      if (!gpphTmlNfc_Context->tReadInfo.bThreadBusy) {
+      if (gpphTmlNfc_Context->bReadStreamDepth &&
+          (1 == gpphTmlNfc_Context->tReadInfo.bEnable)) {
+        /* Reader thread is streaming already, only refresh the completion
+         * details. No need to signal the reader thread */
+        pthread_mutex_lock(&gpphTmlNfc_Context->readInfoUpdateMutex);
+        gpphTmlNfc_Context->tReadInfo.bThreadBusy = true;
+        gpphTmlNfc_Context->tReadInfo.wLength = wLength;
+        gpphTmlNfc_Context->tReadInfo.pThread_Callback = pTmlReadComplete;
+        gpphTmlNfc_Context->tReadInfo.pContext = pContext;
+        pthread_mutex_unlock(&gpphTmlNfc_Context->readInfoUpdateMutex);
+        wReadStatus = NFCSTATUS_PENDING;
+      } else if (!gpphTmlNfc_Context->tReadInfo.bThreadBusy) {
         pthread_mutex_lock(&gpphTmlNfc_Context->readInfoUpdateMutex);
         /* Setting the flag marks beginning of a Read Operation */
         gpphTmlNfc_Context->tReadInfo.bThreadBusy = true;
@@ -853,6 +939,7 @@ NFCSTATUS phTmlNfc_Read(uint8_t* pBuffer, uint16_t wLength,
 ** Function         phTmlNfc_ReadAbort
 **
 ** Description      Aborts pending read request (if any)
+**                  Also stops continuous reading in streaming read mode
 **
 ** Parameters       None
 **
@@ -868,6 +955,8 @@ NFCSTATUS phTmlNfc_Read(uint8_t* pBuffer, uint16_t wLength,
 NFCSTATUS phTmlNfc_ReadAbort(void) {
   NFCSTATUS wStatus = NFCSTATUS_INVALID_PARAMETER;
   gpphTmlNfc_Context->tReadInfo.bEnable = 0;
+  /* Wake up reader thread waiting for data from the device */
+  gpphTmlNfc_Context->pTransport->abort_read();
 
   /*Reset the flag to accept another Read Request */
   gpphTmlNfc_Context->tReadInfo.bThreadBusy = false;
@@ -942,9 +1031,11 @@ NFCSTATUS phTmlNfc_IoCtl(phTmlNfc_ControlCode_t eControlCode) {
           read_flag = true;
         }
         gpphTmlNfc_Context->tReadInfo.bEnable = 0;
-        phTmlNfc_i2c_reset(gpphTmlNfc_Context->pDevHandle, 0);
+        gpphTmlNfc_Context->pTransport->reset(
+            gpphTmlNfc_Context->pDevHandle, 0);
         usleep(10 * 1000);
-        phTmlNfc_i2c_reset(gpphTmlNfc_Context->pDevHandle, 1);
+        gpphTmlNfc_Context->pTransport->reset(
+            gpphTmlNfc_Context->pDevHandle, 1);
         usleep(100 * 1000);
         if (read_flag) {
           gpphTmlNfc_Context->tReadInfo.bEnable = 1;
@@ -955,7 +1046,8 @@ NFCSTATUS phTmlNfc_IoCtl(phTmlNfc_ControlCode_t eControlCode) {
       case phTmlNfc_e_EnableDownloadMode: {
         phTmlNfc_ConfigNciPktReTx(phTmlNfc_e_DisableRetrans, 0);
         gpphTmlNfc_Context->tReadInfo.bEnable = 0;
-        wStatus = phTmlNfc_i2c_reset(gpphTmlNfc_Context->pDevHandle, 2);
+        wStatus = gpphTmlNfc_Context->pTransport->reset(
+            gpphTmlNfc_Context->pDevHandle, 2);
         usleep(100 * 1000);
         gpphTmlNfc_Context->tReadInfo.bEnable = 1;
         sem_post(&gpphTmlNfc_Context->rxSemaphore);
@@ -1036,7 +1128,7 @@ NFCSTATUS phTmlNfc_IoCtl(phTmlNfc_ControlCode_t eControlCode) {
       }
       case phTmlNfc_e_eSEChipRstMode: {
           if(nfcFL.nfcNxpEse) {
-              wStatus = phTmlNfc_i2c_reset(
+              wStatus = gpphTmlNfc_Context->pTransport->reset(
                       gpphTmlNfc_Context->pDevHandle, 3);
           }
           break;
@@ -1097,6 +1189,9 @@ void phTmlNfc_DeferredCall(uintptr_t dwThreadId,
       phDal4Nfc_msgsnd(gpphTmlNfc_Context->dwCallbackThreadId, ptWorkerMsg, 0);
 
   sem_post(&gpphTmlNfc_Context->postMsgSemaphore);
+  if (0 != bPostStatus) {
+    NXPLOG_TML_E("PN54X - Unable to post message, dropped.....\n");
+  }
 }
 
 /*******************************************************************************
@@ -1118,6 +1213,8 @@ static void phTmlNfc_ReadDeferredCb(void* pParams) {
   gpphTmlNfc_Context->tReadInfo.bThreadBusy = false;
   gpphTmlNfc_Context->tReadInfo.pThread_Callback(
       gpphTmlNfc_Context->tReadInfo.pContext, pTransactionInfo);
+  /* Upper layer is done with the data, return the buffer to the pool */
+  phTmlNfc_ReleaseRxBuffer(pTransactionInfo);
 
   return;
 }
@@ -1145,6 +1242,121 @@ static void phTmlNfc_WriteDeferredCb(void* pParams) {
   return;
 }
 
+/*******************************************************************************
+**
+** Function         phTmlNfc_AcquireRxSlot
+**
+** Description      Takes the next free buffer from the TML Rx buffer pool.
+**                  Blocks while all buffers are held by the upper layer.
+**
+** Parameters       None
+**
+** Returns          Rx buffer slot, NULL if TML is shutting down
+**
+*******************************************************************************/
+static phTmlNfc_RxSlot_t* phTmlNfc_AcquireRxSlot(void) {
+  phTmlNfc_RxSlot_t* pRxSlot = NULL;
+  uint8_t bCount;
+
+  while (sem_wait(&gpphTmlNfc_Context->rxPoolSemaphore) == -1 &&
+         errno == EINTR) {
+  }
+  if (0 == gpphTmlNfc_Context->bThreadDone) {
+    return NULL;
+  }
+  /* Slots are used round robin so a released buffer stays untouched for as
+   * long as possible */
+  for (bCount = 0; bCount < PH_TMLNFC_RX_POOL_SIZE; bCount++) {
+    pRxSlot = &gpphTmlNfc_Context->tRxPool[gpphTmlNfc_Context->bRxPoolIdx];
+    gpphTmlNfc_Context->bRxPoolIdx =
+        (gpphTmlNfc_Context->bRxPoolIdx + 1) % PH_TMLNFC_RX_POOL_SIZE;
+    if (!pRxSlot->bInUse) {
+      pRxSlot->bInUse = true;
+      pRxSlot->tTransactInfo.pRxSlot = pRxSlot;
+      return pRxSlot;
+    }
+  }
+  NXPLOG_TML_E("PN54X - Rx buffer pool inconsistent");
+  sem_post(&gpphTmlNfc_Context->rxPoolSemaphore);
+  return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_ReleaseRxBuffer
+**
+** Description      Returns the Rx buffer handed over in a read completion to
+**                  the TML Rx buffer pool. pInfo->pBuff must not be accessed
+**                  by the caller afterwards.
+**
+** Parameters       pInfo - transaction info received in the read callback
+**
+** Returns          None
+**
+*******************************************************************************/
+void phTmlNfc_ReleaseRxBuffer(phTmlNfc_TransactInfo_t* pInfo) {
+  phTmlNfc_RxSlot_t* pRxSlot;
+
+  if ((NULL == gpphTmlNfc_Context) || (NULL == pInfo) ||
+      (NULL == pInfo->pRxSlot)) {
+    return;
+  }
+  pRxSlot = (phTmlNfc_RxSlot_t*)pInfo->pRxSlot;
+  pInfo->pRxSlot = NULL;
+  pRxSlot->bInUse = false;
+  sem_post(&gpphTmlNfc_Context->rxPoolSemaphore);
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_ConfigReadStreaming
+**
+** Description      Enables or disables streaming read mode.
+**                  When enabled, reader thread keeps reading once a read is
+**                  requested and queues the packets to the callback thread
+**                  without waiting for phTmlNfc_Read to be invoked again.
+**                  Reading pauses when bDepth packets are still held by the
+**                  upper layer. Read continues until phTmlNfc_ReadAbort.
+**                  Shall be configured before reading is started.
+**
+** Parameters       bDepth - maximum number of packets queued to upper layer,
+**                           0 disables streaming (read re-armed per packet)
+**
+** Returns          NFC status:
+**                  NFCSTATUS_SUCCESS - streaming read mode configured
+**                  NFCSTATUS_NOT_INITIALIZED - TML layer is not initialized
+**
+*******************************************************************************/
+NFCSTATUS phTmlNfc_ConfigReadStreaming(uint8_t bDepth) {
+  uint8_t bPoolDepth;
+
+  if (NULL == gpphTmlNfc_Context) {
+    return PHNFCSTVAL(CID_NFC_TML, NFCSTATUS_NOT_INITIALISED);
+  }
+  if (bDepth > PH_TMLNFC_RX_POOL_SIZE) {
+    bDepth = PH_TMLNFC_RX_POOL_SIZE;
+  }
+  /* Queue depth is bounded by the number of Rx buffers reader may take */
+  bPoolDepth = (0 == bDepth) ? PH_TMLNFC_RX_POOL_SIZE : bDepth;
+  while (gpphTmlNfc_Context->bRxPoolDepth > bPoolDepth) {
+    /* Only a free buffer can be withdrawn from the pool */
+    if (0 != sem_trywait(&gpphTmlNfc_Context->rxPoolSemaphore)) {
+      NXPLOG_TML_E("PN54X - Rx buffers in use, depth limited to %d",
+                   gpphTmlNfc_Context->bRxPoolDepth);
+      break;
+    }
+    gpphTmlNfc_Context->bRxPoolDepth--;
+  }
+  while (gpphTmlNfc_Context->bRxPoolDepth < bPoolDepth) {
+    sem_post(&gpphTmlNfc_Context->rxPoolSemaphore);
+    gpphTmlNfc_Context->bRxPoolDepth++;
+  }
+  gpphTmlNfc_Context->bReadStreamDepth = bDepth;
+  NXPLOG_TML_D("PN54X - Read streaming depth = %d", bDepth);
+
+  return NFCSTATUS_SUCCESS;
+}
+
 void phTmlNfc_set_fragmentation_enabled(phTmlNfc_i2cfragmentation_t result) {
   fragmentation_enabled = result;
 }
@@ -1157,28 +1369,40 @@ phTmlNfc_i2cfragmentation_t phTmlNfc_get_fragmentation_enabled() {
 **
 ** Function         phTmlNfc_WaitWriteComplete
 **
-** Description      wait function for reader thread
+** Description      wait function for reader thread, returns as soon as the
+**                  writer thread has posted the write completion or on timeout
+**                  wait_busy_lock shall be held by the caller
 **
-** Parameters       None
+** Parameters       dwTimeoutMs - max time to wait in milliseconds
 **
 ** Returns          None
 **
 *******************************************************************************/
-static void phTmlNfc_WaitWriteComplete(void) {
+static void phTmlNfc_WaitWriteComplete(uint32_t dwTimeoutMs) {
   int ret = -1;
   struct timespec absTimeout;
   if (clock_gettime(CLOCK_MONOTONIC, &absTimeout) == -1) {
     NXPLOG_TML_E("Reader Thread clock_gettime failed");
   } else {
-    absTimeout.tv_sec += 1; /*1 second timeout*/
+    absTimeout.tv_sec += dwTimeoutMs / 1000;
+    absTimeout.tv_nsec += (long)(dwTimeoutMs % 1000) * 1000000;
+    if (absTimeout.tv_nsec >= 1000000000) {
+      absTimeout.tv_sec++;
+      absTimeout.tv_nsec -= 1000000000;
+    }
     gpphTmlNfc_Context->wait_busy_flag = true;
     NXPLOG_TML_D("phTmlNfc_WaitWriteComplete - enter");
-    ret = pthread_cond_timedwait(&gpphTmlNfc_Context->wait_busy_condition,
-                                 &gpphTmlNfc_Context->wait_busy_lock,
-                                 &absTimeout);
+    /* Flag is cleared by phTmlNfc_SignalWriteComplete, ignore spurious
+     * wake ups */
+    do {
+      ret = pthread_cond_timedwait(&gpphTmlNfc_Context->wait_busy_condition,
+                                   &gpphTmlNfc_Context->wait_busy_lock,
+                                   &absTimeout);
+    } while ((ret == 0) && (gpphTmlNfc_Context->wait_busy_flag == true));
     if ((ret != 0) && (ret != ETIMEDOUT)) {
       NXPLOG_TML_E("Reader Thread wait failed");
     }
+    gpphTmlNfc_Context->wait_busy_flag = false;
     NXPLOG_TML_D("phTmlNfc_WaitWriteComplete - exit");
   }
 }
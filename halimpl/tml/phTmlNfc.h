@@ -46,6 +46,19 @@
  */
 #define PH_TMLNFC_RESETDEVICE (0x00008001)
 
+/*
+ * Number of Rx buffers owned by TML and size of each buffer.
+ * Reader thread fills a free buffer directly and hands it to the upper layer,
+ * buffer is returned to the pool once the read callback has been invoked.
+ */
+#define PH_TMLNFC_RX_POOL_SIZE (4)
+#define PH_TMLNFC_RX_BUFF_LEN (260)
+
+/*
+ * Returned by transport read when woken up by transport abort_read
+ */
+#define PH_TMLNFC_READ_ABORTED (-2)
+
 /*
 ***************************Globals,Structure and Enumeration ******************
 */
@@ -73,6 +86,7 @@ typedef struct phTmlNfc_TransactInfo {
   NFCSTATUS wStatus;       /* Status of the Transaction Completion*/
   uint8_t* pBuff;          /* Response Data of the Transaction*/
   uint16_t wLength;        /* Data size of the Transaction*/
+  void* pRxSlot;           /* TML Rx buffer slot holding pBuff, NULL if none*/
 } phTmlNfc_TransactInfo_t; /* Instance of Transaction structure */
 
 /*
@@ -153,6 +167,20 @@ typedef struct phTmlNfc_ReadWriteInfo {
   NFCSTATUS wWorkStatus; /*Status of the transaction performed */
 } phTmlNfc_ReadWriteInfo_t;
 
+/*
+ * Rx buffer slot of the TML owned Rx buffer pool
+ *
+ * Each slot carries its own transaction info and deferred call structure so
+ * that a packet still being processed by the upper layer is not overwritten
+ * by the next read.
+ */
+typedef struct phTmlNfc_RxSlot {
+  uint8_t aBuff[PH_TMLNFC_RX_BUFF_LEN]; /* Buffer filled by the driver read */
+  volatile uint8_t bInUse; /* Slot is owned by reader thread or upper layer */
+  phTmlNfc_TransactInfo_t tTransactInfo; /* Read completion info */
+  phLibNfc_DeferredCall_t tDeferredInfo; /* Deferred call posted to client */
+} phTmlNfc_RxSlot_t;
+
 /*
  *Base Context Structure containing members required for entire session
  */
@@ -185,6 +213,13 @@ typedef struct phTmlNfc_Context {
       gWriterCbflag; /* flag to indicate write callback message is pushed to
                         queue*/
   long    nfc_service_pid; /*NFC Service PID to be used by driver to signal*/
+  const struct phTmlNfc_Transport* pTransport; /* Backend used to reach NFCC */
+  phTmlNfc_RxSlot_t tRxPool[PH_TMLNFC_RX_POOL_SIZE]; /* TML owned Rx buffers */
+  uint8_t bRxPoolIdx;    /* Next Rx slot to be used by reader thread */
+  sem_t rxPoolSemaphore; /* Counts free Rx slots */
+  uint8_t bRxPoolDepth;  /* Rx slots currently counted by rxPoolSemaphore */
+  volatile uint8_t bReadStreamDepth; /* Max packets queued to upper layer in
+                                        streaming read mode, 0 if disabled */
 } phTmlNfc_Context_t;
 
 /*
@@ -206,8 +241,32 @@ typedef struct phTmlNfc_Config {
    *
    * This is the baudrate of the bus for communication between DH and PN54X */
   uint32_t dwBaudRate;
+  /* Link to the NFCC
+   *
+   * ENUM_LINK_TYPE_SIM selects the in-process NFCC simulator, pDevName is then
+   * the optional simulator script. Any other link type uses the I2C driver */
+  phLibNfc_eConfigLinkType eLinkType;
 } phTmlNfc_Config_t, *pphTmlNfc_Config_t; /* pointer to phTmlNfc_Config_t */
 
+/*
+ * TML transport backend
+ *
+ * Lower edge of TML. Reader/writer threads and phTmlNfc_IoCtl reach the NFCC
+ * only through these functions, read/write/reset follow the semantics of
+ * phTmlNfc_i2c_read/write/reset.
+ */
+typedef struct phTmlNfc_Transport {
+  const char* pName; /* Backend name used in logs */
+  NFCSTATUS (*open_and_configure)(pphTmlNfc_Config_t pConfig,
+                                  void** pLinkHandle);
+  void (*close)(void* pDevHandle);
+  int (*read)(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToRead);
+  int (*write)(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToWrite);
+  int (*reset)(void* pDevHandle, long level);
+  void (*abort_read)(void); /* Wake up a blocked read */
+  bool_t (*get_download_flag)(void); /* NFCC is in FW download mode */
+} phTmlNfc_Transport_t;
+
 /*
  * TML Deferred Callback structure used to invoke Upper layer Callback function.
  */
@@ -244,6 +303,8 @@ NFCSTATUS phTmlNfc_Read(uint8_t* pBuffer, uint16_t wLength,
 NFCSTATUS phTmlNfc_WriteAbort(void);
 NFCSTATUS phTmlNfc_ReadAbort(void);
 NFCSTATUS phTmlNfc_IoCtl(phTmlNfc_ControlCode_t eControlCode);
+void phTmlNfc_ReleaseRxBuffer(phTmlNfc_TransactInfo_t* pInfo);
+NFCSTATUS phTmlNfc_ConfigReadStreaming(uint8_t bDepth);
 NFCSTATUS phTmlNfc_UpdateReadCompleteCallback (
     pphTmlNfc_TransactCompletionCb_t pTmlReadComplete);
 NFCSTATUS phTmlNfc_get_ese_access(void* pDevHandle, long timeout);
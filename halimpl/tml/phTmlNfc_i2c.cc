@@ -26,8 +26,10 @@
 #include <fcntl.h>
 #include <termios.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <phNxpLog.h>
 #include <phTmlNfc_i2c.h>
@@ -41,8 +43,23 @@
 #define FW_DNLD_LEN_OFFSET 1
 #define NORMAL_MODE_LEN_OFFSET 2
 #define FRAGMENTSIZE_MAX PHNFC_I2C_FRAGMENT_SIZE
+/* Read times out so that a non responding PN54X can be detected */
+#define I2C_READ_TIMEOUT_MS 2000
+#define I2C_EPOLL_MAX_EVENTS 2
 static bool_t bFwDnldFlag = false;
 bool_t notifyFwrequest;
+/* epoll instance waiting on the device and the read abort event */
+static int nEpollFd = -1;
+static int nAbortEventFd = -1;
+/* Abort is only signalled while a read waits, see phTmlNfc_i2c_abort_read */
+static pthread_mutex_t gAbortLock = PTHREAD_MUTEX_INITIALIZER;
+static bool_t bReadPending = false;
+/* Driver returns a complete packet in a single read */
+static bool_t bCoalescedRead = false;
+
+static int phTmlNfc_i2c_wait_readable(void* pDevHandle);
+static int phTmlNfc_i2c_read_coalesced(void* pDevHandle, uint8_t* pBuffer,
+                                       int nNbBytesToRead);
 
 /*******************************************************************************
 **
@@ -59,6 +76,14 @@ void phTmlNfc_i2c_close(void* pDevHandle) {
   if (NULL != pDevHandle) {
     close((intptr_t)pDevHandle);
   }
+  if (nEpollFd >= 0) {
+    close(nEpollFd);
+    nEpollFd = -1;
+  }
+  if (nAbortEventFd >= 0) {
+    close(nAbortEventFd);
+    nAbortEventFd = -1;
+  }
 
   return;
 }
@@ -80,6 +105,8 @@ void phTmlNfc_i2c_close(void* pDevHandle) {
 NFCSTATUS phTmlNfc_i2c_open_and_configure(pphTmlNfc_Config_t pConfig,
                                           void** pLinkHandle) {
   int nHandle;
+  int ret_Ctl;
+  struct epoll_event tEvent;
 
   NXPLOG_TML_D("Opening port=%s\n", pConfig->pDevName);
   /* open port */
@@ -92,6 +119,30 @@ NFCSTATUS phTmlNfc_i2c_open_and_configure(pphTmlNfc_Config_t pConfig,
 
   *pLinkHandle = (void*)((intptr_t)nHandle);
 
+  /* Read waits on the device and on an event used to abort the wait */
+  nEpollFd = epoll_create1(EPOLL_CLOEXEC);
+  nAbortEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if ((nEpollFd < 0) || (nAbortEventFd < 0)) {
+    NXPLOG_TML_E("_i2c_open() epoll/eventfd failed errno : %x", errno);
+    phTmlNfc_i2c_close(*pLinkHandle);
+    *pLinkHandle = NULL;
+    return NFCSTATUS_INVALID_DEVICE;
+  }
+  memset(&tEvent, 0x00, sizeof(tEvent));
+  tEvent.events = EPOLLIN;
+  tEvent.data.fd = nHandle;
+  ret_Ctl = epoll_ctl(nEpollFd, EPOLL_CTL_ADD, nHandle, &tEvent);
+  if (0 == ret_Ctl) {
+    tEvent.data.fd = nAbortEventFd;
+    ret_Ctl = epoll_ctl(nEpollFd, EPOLL_CTL_ADD, nAbortEventFd, &tEvent);
+  }
+  if (0 != ret_Ctl) {
+    NXPLOG_TML_E("_i2c_open() epoll_ctl failed errno : %x", errno);
+    phTmlNfc_i2c_close(*pLinkHandle);
+    *pLinkHandle = NULL;
+    return NFCSTATUS_INVALID_DEVICE;
+  }
+
   /*Reset PN54X*/
   phTmlNfc_i2c_reset((void*)((intptr_t)nHandle), 0);
   usleep(10 * 1000);
@@ -100,6 +151,108 @@ NFCSTATUS phTmlNfc_i2c_open_and_configure(pphTmlNfc_Config_t pConfig,
   return NFCSTATUS_SUCCESS;
 }
 
+/*******************************************************************************
+**
+** Function         phTmlNfc_i2c_wait_readable
+**
+** Description      Waits until PN54X device has data to be read, read timeout
+**                  expires or read is aborted by phTmlNfc_i2c_abort_read
+**
+** Parameters       pDevHandle       - valid device handle
+**
+** Returns           0   - device is readable
+**                  -1   - wait failure or timeout
+**                  PH_TMLNFC_READ_ABORTED - read aborted
+**
+*******************************************************************************/
+static int phTmlNfc_i2c_wait_readable(void* pDevHandle) {
+  struct epoll_event tEvents[I2C_EPOLL_MAX_EVENTS];
+  bool_t bReadable = false;
+  uint64_t nAbortCount;
+  int nWaitErrno;
+  int ret_Wait;
+  int i;
+
+  pthread_mutex_lock(&gAbortLock);
+  bReadPending = true;
+  pthread_mutex_unlock(&gAbortLock);
+  do {
+    ret_Wait = epoll_wait(nEpollFd, tEvents, I2C_EPOLL_MAX_EVENTS,
+                          I2C_READ_TIMEOUT_MS);
+  } while ((ret_Wait < 0) && (errno == EINTR));
+  nWaitErrno = errno;
+  /* Consume the abort request, if any, so that it can not abort the next
+     read once this one has completed */
+  pthread_mutex_lock(&gAbortLock);
+  bReadPending = false;
+  (void)read(nAbortEventFd, &nAbortCount, sizeof(nAbortCount));
+  pthread_mutex_unlock(&gAbortLock);
+
+  if (ret_Wait < 0) {
+    NXPLOG_TML_E("i2c epoll_wait() errno : %x", nWaitErrno);
+    return -1;
+  } else if (ret_Wait == 0) {
+    NXPLOG_TML_E("i2c epoll_wait() Timeout");
+    return -1;
+  }
+  for (i = 0; i < ret_Wait; i++) {
+    if (tEvents[i].data.fd == nAbortEventFd) {
+      /* Abort wins over pending data */
+      NXPLOG_TML_D("i2c read aborted");
+      return PH_TMLNFC_READ_ABORTED;
+    } else if (tEvents[i].data.fd == (int)((intptr_t)pDevHandle)) {
+      bReadable = true;
+    }
+  }
+  return bReadable ? 0 : -1;
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_i2c_read_coalesced
+**
+** Description      Reads a complete packet from PN54X device with a single
+**                  read, used when the driver delivers whole packets
+**
+** Parameters       pDevHandle       - valid device handle
+**                  pBuffer          - buffer for read data
+**                  nNbBytesToRead   - size of pBuffer
+**
+** Returns          numRead   - number of successfully read bytes
+**                  -1        - read operation failure
+**
+*******************************************************************************/
+static int phTmlNfc_i2c_read_coalesced(void* pDevHandle, uint8_t* pBuffer,
+                                       int nNbBytesToRead) {
+  int ret_Read;
+  int nExpected;
+
+  ret_Read = read((intptr_t)pDevHandle, pBuffer, nNbBytesToRead);
+  if (ret_Read == 0) {
+    NXPLOG_TML_E("_i2c_read() [pkt] EOF");
+    return -1;
+  } else if (ret_Read < 0) {
+    NXPLOG_TML_E("_i2c_read() [pkt] errno : %x", errno);
+    return -1;
+  }
+  if (true == bFwDnldFlag) {
+    nExpected = (ret_Read > FW_DNLD_LEN_OFFSET)
+                    ? pBuffer[FW_DNLD_LEN_OFFSET] + FW_DNLD_HEADER_LEN +
+                          CRC_LEN
+                    : -1;
+  } else {
+    nExpected = (ret_Read > NORMAL_MODE_LEN_OFFSET)
+                    ? pBuffer[NORMAL_MODE_LEN_OFFSET] + NORMAL_MODE_HEADER_LEN
+                    : -1;
+  }
+  if (ret_Read != nExpected) {
+    NXPLOG_TML_E("_i2c_read() [pkt] length mismatch %d/%d", ret_Read,
+                 nExpected);
+    return -1;
+  }
+  return ret_Read;
+}
+
 /*******************************************************************************
 **
 ** Function         phTmlNfc_i2c_read
@@ -113,17 +266,16 @@ NFCSTATUS phTmlNfc_i2c_open_and_configure(pphTmlNfc_Config_t pConfig,
 **
 ** Returns          numRead   - number of successfully read bytes
 **                  -1        - read operation failure
+**                  PH_TMLNFC_READ_ABORTED - read aborted before any data
+**                                               was read
 **
 *******************************************************************************/
 int phTmlNfc_i2c_read(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToRead) {
   int ret_Read;
-  int ret_Select;
+  int ret_Wait;
   int numRead = 0;
-  struct timeval tv;
-  fd_set rfds;
   uint16_t totalBtyesToRead = 0;
 
-  UNUSED(nNbBytesToRead);
   if (NULL == pDevHandle) {
     return -1;
   }
@@ -134,22 +286,14 @@ int phTmlNfc_i2c_read(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToRead) {
     totalBtyesToRead = FW_DNLD_HEADER_LEN;
   }
 
-  /* Read with 2 second timeout, so that the read thread can be aborted
-     when the PN54X does not respond and we need to switch to FW download
-     mode. This should be done via a control socket instead. */
-  FD_ZERO(&rfds);
-  FD_SET((intptr_t)pDevHandle, &rfds);
-  tv.tv_sec = 2;
-  tv.tv_usec = 1;
-
-  ret_Select =
-      select((int)((intptr_t)pDevHandle + (int)1), &rfds, NULL, NULL, &tv);
-  if (ret_Select < 0) {
-    NXPLOG_TML_E("i2c select() errno : %x", errno);
-    return -1;
-  } else if (ret_Select == 0) {
-    NXPLOG_TML_E("i2c select() Timeout");
-    return -1;
+  /* Read with 2 second timeout, so that the read thread can detect that the
+     PN54X does not respond and we need to switch to FW download mode.
+     ReadAbort and Shutdown wake up the wait through the abort event. */
+  ret_Wait = phTmlNfc_i2c_wait_readable(pDevHandle);
+  if (ret_Wait != 0) {
+    return ret_Wait;
+  } else if (true == bCoalescedRead) {
+    return phTmlNfc_i2c_read_coalesced(pDevHandle, pBuffer, nNbBytesToRead);
   } else {
     ret_Read = read((intptr_t)pDevHandle, pBuffer, totalBtyesToRead - numRead);
     if (ret_Read > 0) {
@@ -208,6 +352,48 @@ int phTmlNfc_i2c_read(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToRead) {
   return numRead;
 }
 
+/*******************************************************************************
+**
+** Function         phTmlNfc_i2c_abort_read
+**
+** Description      Wakes up a read waiting for PN54X device data, the read
+**                  returns PH_TMLNFC_READ_ABORTED. Does nothing if no read
+**                  is waiting.
+**
+** Parameters       None
+**
+** Returns          None
+**
+*******************************************************************************/
+void phTmlNfc_i2c_abort_read(void) {
+  uint64_t nAbortCount = 1;
+
+  if (nAbortEventFd < 0) {
+    return;
+  }
+  pthread_mutex_lock(&gAbortLock);
+  if ((true == bReadPending) &&
+      (write(nAbortEventFd, &nAbortCount, sizeof(nAbortCount)) < 0)) {
+    NXPLOG_TML_E("i2c abort read errno : %x", errno);
+  }
+  pthread_mutex_unlock(&gAbortLock);
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_i2c_set_coalesced_read
+**
+** Description      Enables reading a complete packet with a single read call.
+**                  Only to be enabled if the driver returns a whole NCI/FW
+**                  download packet on read.
+**
+** Parameters       enable - true to read header and payload together
+**
+** Returns          None
+**
+*******************************************************************************/
+void phTmlNfc_i2c_set_coalesced_read(bool_t enable) { bCoalescedRead = enable; }
+
 /*******************************************************************************
 **
 ** Function         phTmlNfc_i2c_write
@@ -610,3 +796,16 @@ NFCSTATUS phTmlNfc_rel_dwpOnOff_wait(void *pDevHandle, long dwplinkActvStatus) {
   return status;
 
 }
+
+/*
+ * I2C transport backend of TML, PN54X kernel driver
+ */
+const phTmlNfc_Transport_t gphTmlNfc_I2cTransport = {
+    "i2c",
+    phTmlNfc_i2c_open_and_configure,
+    phTmlNfc_i2c_close,
+    phTmlNfc_i2c_read,
+    phTmlNfc_i2c_write,
+    phTmlNfc_i2c_reset,
+    phTmlNfc_i2c_abort_read,
+    getDownloadFlag};
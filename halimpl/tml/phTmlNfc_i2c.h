@@ -27,9 +27,12 @@ void phTmlNfc_i2c_close(void* pDevHandle);
 NFCSTATUS phTmlNfc_i2c_open_and_configure(pphTmlNfc_Config_t pConfig,
                                           void** pLinkHandle);
 int phTmlNfc_i2c_read(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToRead);
+void phTmlNfc_i2c_abort_read(void);
+void phTmlNfc_i2c_set_coalesced_read(bool_t enable);
 int phTmlNfc_i2c_write(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToWrite);
 int phTmlNfc_i2c_reset(void* pDevHandle, long level);
 bool_t getDownloadFlag(void);
+extern const phTmlNfc_Transport_t gphTmlNfc_I2cTransport;
 extern bool_t notifyFwrequest;
 extern phTmlNfc_i2cfragmentation_t fragmentation_enabled;
 
@@ -0,0 +1,609 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * TML NFCC simulator transport
+ *
+ * Host side of the link is one end of a SOCK_SEQPACKET socket pair, so each
+ * read returns exactly one packet. Packets written by TML are processed in the
+ * caller context and the resulting response/notification packets are queued
+ * on the other end of the socket pair.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+
+#include <phNxpLog.h>
+#include <phNfcStatus.h>
+#include <phTmlNfc_sim.h>
+
+/* Read times out like the I2C read so that behaviour of TML is unchanged */
+#define SIM_READ_TIMEOUT_MS 2000
+#define SIM_MAX_RULES 32
+#define SIM_MAX_PREFIX_LEN 8
+#define SIM_MAX_RSP 4
+#define SIM_SCRIPT_LINE_LEN 1280
+
+#define SIM_NCI_MT_MASK 0xE0
+#define SIM_NCI_MT_DATA 0x00
+#define SIM_NCI_MT_CMD 0x20
+#define SIM_NCI_GID_MASK 0x0F
+#define SIM_NCI_OID_MASK 0x3F
+
+#define SIM_DNLD_HDR_LEN 2
+#define SIM_DNLD_CRC_LEN 2
+#define SIM_DNLD_FRAGBIT 0x04
+#define SIM_DNLD_CMD_GETVERSION 0xF1
+#define SIM_DNLD_CMD_GETSESSIONSTATE 0xF2
+#define SIM_DNLD_STATUS_OK 0x00
+#define SIM_DNLD_FIRST_FRAGFRAME_RESP 0x2D
+#define SIM_DNLD_NEXT_FRAGFRAME_RESP 0x2E
+
+/* Script rule, packets sent back for a command starting with aPrefix */
+typedef struct phTmlNfc_SimRule {
+  uint8_t aPrefix[SIM_MAX_PREFIX_LEN];
+  uint8_t bPrefixLen;
+  uint8_t bNbRsp;
+  uint16_t wRspLen[SIM_MAX_RSP];
+  uint8_t aRsp[SIM_MAX_RSP][PH_TMLNFC_RX_BUFF_LEN];
+} phTmlNfc_SimRule_t;
+
+/* Simulator state */
+typedef struct phTmlNfc_SimContext {
+  int nSock[2];     /* [0] host (TML) end, [1] NFCC end */
+  int nAbortFd;     /* Wakes up a blocked read */
+  bool_t bDnldMode; /* NFCC is in FW download mode */
+  bool_t bFragment; /* Fragmented FW download write frame ongoing */
+  phTmlNfc_SimRule_t* pRules;
+  uint8_t bNbRules;
+} phTmlNfc_SimContext_t;
+
+static phTmlNfc_SimContext_t gSimCtx = {{-1, -1}, -1, false, false, NULL, 0};
+
+/* NCI 2.0 CORE_RESET_NTF, PN553 hardware, FW 11.01.10 */
+static const uint8_t aSimCoreResetNtf[] = {0x60, 0x00, 0x09, 0x02, 0x00, 0x20,
+                                           0x04, 0x04, 0x41, 0x11, 0x01, 0x10};
+/* NCI 2.0 CORE_INIT_RSP with NFC-DEP, ISO-DEP and frame interfaces */
+static const uint8_t aSimCoreInitRsp[] = {
+    0x40, 0x01, 0x16, 0x00, 0x1A, 0x7E, 0x06, 0x02, 0x01, 0xD0, 0x02, 0xFF,
+    0xFF, 0x01, 0xFF, 0x00, 0x04, 0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03,
+    0x00};
+/* FW download GET_VERSION payload (status excluded), PN553 hardware */
+static const uint8_t aSimDnldVersion[] = {0x41, 0x00, 0x00, 0x00, 0x00,
+                                          0x00, 0x00, 0x01, 0x10};
+/* FW download GET_SESSION_STATE payload (status excluded): session closed,
+ * life cycle operational */
+static const uint8_t aSimDnldSession[] = {0x00, 0x00, 0x11};
+
+static void phTmlNfc_sim_send(const uint8_t* pBuffer, uint16_t wLength);
+static void phTmlNfc_sim_nci_process(uint8_t* pBuffer, uint16_t wLength);
+static void phTmlNfc_sim_dnld_process(uint8_t* pBuffer, uint16_t wLength);
+static void phTmlNfc_sim_load_script(const char* pPath);
+static int phTmlNfc_sim_parse_hex(const char* pStr, uint8_t* pOut, int nMax);
+static uint16_t phTmlNfc_sim_crc16(const uint8_t* pBuff, uint16_t wLen);
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_open_and_configure
+**
+** Description      Creates the simulated NFCC link and loads the optional
+**                  script file named by pConfig->pDevName
+**
+** Parameters       pConfig     - hardware information
+**                  pLinkHandle - device handle
+**
+** Returns          NFC status:
+**                  NFCSTATUS_SUCCESS - open_and_configure operation success
+**                  NFCSTATUS_INVALID_DEVICE - link creation failure
+**
+*******************************************************************************/
+NFCSTATUS phTmlNfc_sim_open_and_configure(pphTmlNfc_Config_t pConfig,
+                                          void** pLinkHandle) {
+  *pLinkHandle = NULL;
+  if (0 != socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0,
+                      gSimCtx.nSock)) {
+    NXPLOG_TML_E("_sim_open() socketpair failed errno : %x", errno);
+    return NFCSTATUS_INVALID_DEVICE;
+  }
+  gSimCtx.nAbortFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (gSimCtx.nAbortFd < 0) {
+    NXPLOG_TML_E("_sim_open() eventfd failed errno : %x", errno);
+    phTmlNfc_sim_close((void*)((intptr_t)gSimCtx.nSock[0]));
+    return NFCSTATUS_INVALID_DEVICE;
+  }
+  gSimCtx.bDnldMode = false;
+  gSimCtx.bFragment = false;
+  if ((NULL != pConfig) && (NULL != pConfig->pDevName)) {
+    phTmlNfc_sim_load_script((const char*)pConfig->pDevName);
+  }
+  NXPLOG_TML_D("NFCC simulator opened, %d script rules", gSimCtx.bNbRules);
+  *pLinkHandle = (void*)((intptr_t)gSimCtx.nSock[0]);
+
+  return NFCSTATUS_SUCCESS;
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_close
+**
+** Description      Closes the simulated NFCC link
+**
+** Parameters       pDevHandle - device handle
+**
+** Returns          None
+**
+*******************************************************************************/
+void phTmlNfc_sim_close(void* pDevHandle) {
+  UNUSED(pDevHandle);
+  if (gSimCtx.nSock[0] >= 0) {
+    close(gSimCtx.nSock[0]);
+    close(gSimCtx.nSock[1]);
+    gSimCtx.nSock[0] = -1;
+    gSimCtx.nSock[1] = -1;
+  }
+  if (gSimCtx.nAbortFd >= 0) {
+    close(gSimCtx.nAbortFd);
+    gSimCtx.nAbortFd = -1;
+  }
+  if (NULL != gSimCtx.pRules) {
+    free(gSimCtx.pRules);
+    gSimCtx.pRules = NULL;
+  }
+  gSimCtx.bNbRules = 0;
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_read
+**
+** Description      Reads the next packet sent by the simulated NFCC
+**
+** Parameters       pDevHandle       - valid device handle
+**                  pBuffer          - buffer for read data
+**                  nNbBytesToRead   - size of pBuffer
+**
+** Returns          numRead   - number of successfully read bytes
+**                  -1        - read operation failure or timeout
+**                  PH_TMLNFC_READ_ABORTED - read aborted
+**
+*******************************************************************************/
+int phTmlNfc_sim_read(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToRead) {
+  struct pollfd tFds[2];
+  uint64_t nAbortCount;
+  int ret;
+
+  if (NULL == pDevHandle) {
+    return -1;
+  }
+  tFds[0].fd = (int)((intptr_t)pDevHandle);
+  tFds[0].events = POLLIN;
+  tFds[1].fd = gSimCtx.nAbortFd;
+  tFds[1].events = POLLIN;
+  do {
+    ret = poll(tFds, 2, SIM_READ_TIMEOUT_MS);
+  } while ((ret < 0) && (errno == EINTR));
+
+  if (ret < 0) {
+    NXPLOG_TML_E("sim poll() errno : %x", errno);
+    return -1;
+  } else if (ret == 0) {
+    NXPLOG_TML_E("sim poll() Timeout");
+    return -1;
+  } else if (tFds[1].revents & POLLIN) {
+    (void)read(gSimCtx.nAbortFd, &nAbortCount, sizeof(nAbortCount));
+    return PH_TMLNFC_READ_ABORTED;
+  }
+  ret = recv(tFds[0].fd, pBuffer, nNbBytesToRead, 0);
+  if (ret <= 0) {
+    NXPLOG_TML_E("_sim_read() errno : %x", errno);
+    return -1;
+  }
+  return ret;
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_write
+**
+** Description      Hands a packet to the simulated NFCC, the NFCC answer is
+**                  queued for phTmlNfc_sim_read before returning
+**
+** Parameters       pDevHandle       - valid device handle
+**                  pBuffer          - packet to be sent
+**                  nNbBytesToWrite  - packet length
+**
+** Returns          numWrote   - number of successfully written bytes
+**                  -1         - write operation failure
+**
+*******************************************************************************/
+int phTmlNfc_sim_write(void* pDevHandle, uint8_t* pBuffer,
+                       int nNbBytesToWrite) {
+  if ((NULL == pDevHandle) || (NULL == pBuffer) || (nNbBytesToWrite <= 0)) {
+    return -1;
+  }
+  if (gSimCtx.bDnldMode) {
+    phTmlNfc_sim_dnld_process(pBuffer, (uint16_t)nNbBytesToWrite);
+  } else {
+    phTmlNfc_sim_nci_process(pBuffer, (uint16_t)nNbBytesToWrite);
+  }
+  return nNbBytesToWrite;
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_reset
+**
+** Description      Simulated VEN control, level 2 enters FW download mode
+**
+** Parameters       pDevHandle     - valid device handle
+**                  level          - reset level
+**
+** Returns           0   - reset operation success
+**                  -1   - reset operation failure
+**
+*******************************************************************************/
+int phTmlNfc_sim_reset(void* pDevHandle, long level) {
+  NXPLOG_TML_D("phTmlNfc_sim_reset(), VEN level %ld", level);
+  if (NULL == pDevHandle) {
+    return -1;
+  }
+  /* eSE reset (level 3) has no effect on the simulated NFCC */
+  if (level != 3) {
+    gSimCtx.bDnldMode = (level == 2) ? true : false;
+    gSimCtx.bFragment = false;
+  }
+  return 0;
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_abort_read
+**
+** Description      Wakes up a blocked phTmlNfc_sim_read
+**
+** Parameters       None
+**
+** Returns          None
+**
+*******************************************************************************/
+void phTmlNfc_sim_abort_read(void) {
+  uint64_t nAbortCount = 1;
+
+  if (gSimCtx.nAbortFd >= 0) {
+    (void)write(gSimCtx.nAbortFd, &nAbortCount, sizeof(nAbortCount));
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_get_download_flag
+**
+** Description      Returns the current mode of the simulated NFCC
+**
+** Parameters       None
+**
+** Returns          true if FW download mode, false otherwise
+**
+*******************************************************************************/
+bool_t phTmlNfc_sim_get_download_flag(void) { return gSimCtx.bDnldMode; }
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_send
+**
+** Description      Queues a packet from the simulated NFCC to the host
+**
+** Parameters       pBuffer - packet
+**                  wLength - packet length
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phTmlNfc_sim_send(const uint8_t* pBuffer, uint16_t wLength) {
+  if (send(gSimCtx.nSock[1], pBuffer, wLength, MSG_NOSIGNAL) != wLength) {
+    NXPLOG_TML_E("_sim_send() errno : %x", errno);
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_nci_process
+**
+** Description      Answers an NCI packet, script rules first then built-in
+**                  NCI 2.0 behaviour
+**
+** Parameters       pBuffer - NCI packet from host
+**                  wLength - packet length
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phTmlNfc_sim_nci_process(uint8_t* pBuffer, uint16_t wLength) {
+  uint8_t aRsp[8];
+  uint8_t bGid, bOid;
+  uint8_t i, j;
+
+  for (i = 0; i < gSimCtx.bNbRules; i++) {
+    phTmlNfc_SimRule_t* pRule = &gSimCtx.pRules[i];
+    if ((wLength >= pRule->bPrefixLen) &&
+        (0 == memcmp(pBuffer, pRule->aPrefix, pRule->bPrefixLen))) {
+      for (j = 0; j < pRule->bNbRsp; j++) {
+        phTmlNfc_sim_send(pRule->aRsp[j], pRule->wRspLen[j]);
+      }
+      return;
+    }
+  }
+
+  if ((pBuffer[0] & SIM_NCI_MT_MASK) == SIM_NCI_MT_DATA) {
+    /* CORE_CONN_CREDITS_NTF, one credit back for the connection */
+    aRsp[0] = 0x60;
+    aRsp[1] = 0x06;
+    aRsp[2] = 0x03;
+    aRsp[3] = 0x01;
+    aRsp[4] = pBuffer[0] & SIM_NCI_GID_MASK;
+    aRsp[5] = 0x01;
+    phTmlNfc_sim_send(aRsp, 6);
+    return;
+  } else if ((pBuffer[0] & SIM_NCI_MT_MASK) != SIM_NCI_MT_CMD) {
+    NXPLOG_TML_E("_sim_nci() unexpected packet type 0x%02x", pBuffer[0]);
+    return;
+  }
+
+  bGid = pBuffer[0] & SIM_NCI_GID_MASK;
+  bOid = pBuffer[1] & SIM_NCI_OID_MASK;
+  aRsp[0] = 0x40 | bGid;
+  aRsp[1] = bOid;
+  aRsp[2] = 0x01;
+  aRsp[3] = 0x00; /* STATUS_OK */
+  if ((bGid == 0x00) && (bOid == 0x00)) {
+    /* CORE_RESET */
+    phTmlNfc_sim_send(aRsp, 4);
+    phTmlNfc_sim_send(aSimCoreResetNtf, sizeof(aSimCoreResetNtf));
+  } else if ((bGid == 0x00) && (bOid == 0x01)) {
+    /* CORE_INIT */
+    phTmlNfc_sim_send(aSimCoreInitRsp, sizeof(aSimCoreInitRsp));
+  } else if (((bGid == 0x00) && ((bOid == 0x02) || (bOid == 0x03))) ||
+             ((bGid == 0x02) && (bOid == 0x00))) {
+    /* CORE_SET_CONFIG/CORE_GET_CONFIG/NFCEE_DISCOVER, no parameters */
+    aRsp[2] = 0x02;
+    aRsp[4] = 0x00;
+    phTmlNfc_sim_send(aRsp, 5);
+  } else if ((bGid == 0x01) && (bOid == 0x06)) {
+    /* RF_DEACTIVATE */
+    phTmlNfc_sim_send(aRsp, 4);
+    aRsp[0] = 0x61;
+    aRsp[2] = 0x02;
+    aRsp[3] = (wLength > 3) ? pBuffer[3] : 0x00;
+    aRsp[4] = 0x00; /* DH request */
+    phTmlNfc_sim_send(aRsp, 5);
+  } else {
+    phTmlNfc_sim_send(aRsp, 4);
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_dnld_process
+**
+** Description      Answers a FW download frame
+**
+** Parameters       pBuffer - FW download frame from host
+**                  wLength - frame length
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phTmlNfc_sim_dnld_process(uint8_t* pBuffer, uint16_t wLength) {
+  uint8_t aRsp[SIM_DNLD_HDR_LEN + 1 + sizeof(aSimDnldVersion) +
+               SIM_DNLD_CRC_LEN];
+  const uint8_t* pPld = NULL;
+  uint16_t wPldLen = 0;
+  uint16_t wCrc;
+  bool_t bFragBit;
+
+  if (wLength <= SIM_DNLD_HDR_LEN) {
+    NXPLOG_TML_E("_sim_dnld() frame too short");
+    return;
+  }
+  bFragBit = (pBuffer[0] & SIM_DNLD_FRAGBIT) ? true : false;
+  aRsp[SIM_DNLD_HDR_LEN] = SIM_DNLD_STATUS_OK;
+  if (bFragBit) {
+    /* Chunked write frame, the last chunk is sent without the frag bit */
+    aRsp[SIM_DNLD_HDR_LEN] = gSimCtx.bFragment ? SIM_DNLD_NEXT_FRAGFRAME_RESP
+                                               : SIM_DNLD_FIRST_FRAGFRAME_RESP;
+    gSimCtx.bFragment = true;
+  } else if (gSimCtx.bFragment) {
+    gSimCtx.bFragment = false;
+  } else if (pBuffer[SIM_DNLD_HDR_LEN] == SIM_DNLD_CMD_GETVERSION) {
+    pPld = aSimDnldVersion;
+    wPldLen = sizeof(aSimDnldVersion);
+  } else if (pBuffer[SIM_DNLD_HDR_LEN] == SIM_DNLD_CMD_GETSESSIONSTATE) {
+    pPld = aSimDnldSession;
+    wPldLen = sizeof(aSimDnldSession);
+  }
+  if (NULL != pPld) {
+    memcpy(&aRsp[SIM_DNLD_HDR_LEN + 1], pPld, wPldLen);
+  }
+  wPldLen++; /* status */
+  aRsp[0] = (uint8_t)(wPldLen >> 8);
+  aRsp[1] = (uint8_t)wPldLen;
+  wCrc = phTmlNfc_sim_crc16(aRsp, SIM_DNLD_HDR_LEN + wPldLen);
+  aRsp[SIM_DNLD_HDR_LEN + wPldLen] = (uint8_t)(wCrc >> 8);
+  aRsp[SIM_DNLD_HDR_LEN + wPldLen + 1] = (uint8_t)wCrc;
+  phTmlNfc_sim_send(aRsp, SIM_DNLD_HDR_LEN + wPldLen + SIM_DNLD_CRC_LEN);
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_load_script
+**
+** Description      Loads the script rules, see phTmlNfc_sim.h for the format.
+**                  Nothing is loaded if pPath is not a regular file.
+**
+** Parameters       pPath - script file path
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phTmlNfc_sim_load_script(const char* pPath) {
+  struct stat tStat;
+  char* pLine;
+  char* pRsp;
+  char* pNext;
+  FILE* pFile;
+  int nLen;
+
+  gSimCtx.bNbRules = 0;
+  if ((0 != stat(pPath, &tStat)) || !S_ISREG(tStat.st_mode)) {
+    return;
+  }
+  pFile = fopen(pPath, "r");
+  pLine = (char*)malloc(SIM_SCRIPT_LINE_LEN);
+  gSimCtx.pRules =
+      (phTmlNfc_SimRule_t*)calloc(SIM_MAX_RULES, sizeof(phTmlNfc_SimRule_t));
+  if ((NULL == pFile) || (NULL == pLine) || (NULL == gSimCtx.pRules)) {
+    NXPLOG_TML_E("_sim_load_script() failed to load %s", pPath);
+  } else {
+    while ((gSimCtx.bNbRules < SIM_MAX_RULES) &&
+           (NULL != fgets(pLine, SIM_SCRIPT_LINE_LEN, pFile))) {
+      phTmlNfc_SimRule_t* pRule = &gSimCtx.pRules[gSimCtx.bNbRules];
+      if (NULL != (pNext = strchr(pLine, '#'))) {
+        *pNext = '\0';
+      }
+      if (NULL == (pRsp = strchr(pLine, '='))) {
+        continue;
+      }
+      *pRsp++ = '\0';
+      nLen = phTmlNfc_sim_parse_hex(pLine, pRule->aPrefix, SIM_MAX_PREFIX_LEN);
+      if (nLen <= 0) {
+        NXPLOG_TML_E("_sim_load_script() invalid command prefix");
+        continue;
+      }
+      pRule->bPrefixLen = (uint8_t)nLen;
+      pRule->bNbRsp = 0;
+      while ((NULL != pRsp) && (pRule->bNbRsp < SIM_MAX_RSP)) {
+        if (NULL != (pNext = strchr(pRsp, ','))) {
+          *pNext++ = '\0';
+        }
+        nLen = phTmlNfc_sim_parse_hex(pRsp, pRule->aRsp[pRule->bNbRsp],
+                                      PH_TMLNFC_RX_BUFF_LEN);
+        if (nLen > 0) {
+          pRule->wRspLen[pRule->bNbRsp++] = (uint16_t)nLen;
+        }
+        pRsp = pNext;
+      }
+      gSimCtx.bNbRules++;
+    }
+  }
+  if (NULL != pLine) {
+    free(pLine);
+  }
+  if (NULL != pFile) {
+    fclose(pFile);
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_parse_hex
+**
+** Description      Converts a hex string into bytes, white space is ignored
+**
+** Parameters       pStr - hex string
+**                  pOut - converted bytes
+**                  nMax - size of pOut
+**
+** Returns          number of bytes converted, -1 on invalid string
+**
+*******************************************************************************/
+static int phTmlNfc_sim_parse_hex(const char* pStr, uint8_t* pOut, int nMax) {
+  int nLen = 0;
+  int nNibble = 0;
+  int nValue;
+
+  for (; *pStr != '\0'; pStr++) {
+    if ((*pStr == ' ') || (*pStr == '\t') || (*pStr == '\r') ||
+        (*pStr == '\n')) {
+      continue;
+    }
+    if ((*pStr >= '0') && (*pStr <= '9')) {
+      nValue = *pStr - '0';
+    } else if ((*pStr >= 'a') && (*pStr <= 'f')) {
+      nValue = *pStr - 'a' + 10;
+    } else if ((*pStr >= 'A') && (*pStr <= 'F')) {
+      nValue = *pStr - 'A' + 10;
+    } else {
+      return -1;
+    }
+    if (nLen >= nMax) {
+      return -1;
+    }
+    if (nNibble == 0) {
+      pOut[nLen] = (uint8_t)(nValue << 4);
+      nNibble = 1;
+    } else {
+      pOut[nLen++] |= (uint8_t)nValue;
+      nNibble = 0;
+    }
+  }
+  return (nNibble == 0) ? nLen : -1;
+}
+
+/*******************************************************************************
+**
+** Function         phTmlNfc_sim_crc16
+**
+** Description      CRC16 (CCITT, initial value 0xFFFF) of a FW download frame
+**
+** Parameters       pBuff - frame
+**                  wLen  - frame length without CRC
+**
+** Returns          CRC16
+**
+*******************************************************************************/
+static uint16_t phTmlNfc_sim_crc16(const uint8_t* pBuff, uint16_t wLen) {
+  uint16_t wCrc = 0xFFFF;
+  uint16_t i;
+  uint8_t bBit;
+
+  for (i = 0; i < wLen; i++) {
+    wCrc ^= (uint16_t)pBuff[i] << 8;
+    for (bBit = 0; bBit < 8; bBit++) {
+      wCrc = (wCrc & 0x8000) ? (uint16_t)((wCrc << 1) ^ 0x1021)
+                             : (uint16_t)(wCrc << 1);
+    }
+  }
+  return wCrc;
+}
+
+/*
+ * NFCC simulator transport backend of TML
+ */
+const phTmlNfc_Transport_t gphTmlNfc_SimTransport = {
+    "simulator",
+    phTmlNfc_sim_open_and_configure,
+    phTmlNfc_sim_close,
+    phTmlNfc_sim_read,
+    phTmlNfc_sim_write,
+    phTmlNfc_sim_reset,
+    phTmlNfc_sim_abort_read,
+    phTmlNfc_sim_get_download_flag};
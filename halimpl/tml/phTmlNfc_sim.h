@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * TML NFCC simulator transport
+ *
+ * In-process NFCC used instead of the PN54X driver to run the HAL without
+ * hardware, e.g. for latency and throughput measurements.
+ *
+ * NCI mode: behaves as an NCI 2.0 controller. CORE_RESET, CORE_INIT,
+ * CORE_GET/SET_CONFIG, NFCEE_DISCOVER and RF_DEACTIVATE get their regular
+ * response (and notification), any other command gets a STATUS_OK response
+ * and data packets get a CORE_CONN_CREDITS_NTF.
+ * FW download mode: every frame gets a CRC protected STATUS_OK response,
+ * GET_VERSION and GET_SESSION_STATE return plausible data and fragmented
+ * write frames get the fragment status responses.
+ *
+ * Script: a text file given as device name overrides/extends the NCI
+ * behaviour. Each line holds a command prefix and the packets to send back,
+ * all in hex, e.g.
+ *   # RF_DISCOVER_CMD : response, then activation of a T2T tag
+ *   2103 = 41030100, 6105...
+ * The first line whose prefix matches the command is used.
+ */
+#ifndef PHTMLNFC_SIM_H
+#define PHTMLNFC_SIM_H
+
+#include <phNfcTypes.h>
+#include <phTmlNfc.h>
+
+/* Function declarations */
+NFCSTATUS phTmlNfc_sim_open_and_configure(pphTmlNfc_Config_t pConfig,
+                                          void** pLinkHandle);
+void phTmlNfc_sim_close(void* pDevHandle);
+int phTmlNfc_sim_read(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToRead);
+int phTmlNfc_sim_write(void* pDevHandle, uint8_t* pBuffer, int nNbBytesToWrite);
+int phTmlNfc_sim_reset(void* pDevHandle, long level);
+void phTmlNfc_sim_abort_read(void);
+bool_t phTmlNfc_sim_get_download_flag(void);
+
+extern const phTmlNfc_Transport_t gphTmlNfc_SimTransport;
+
+#endif /*  PHTMLNFC_SIM_H  */
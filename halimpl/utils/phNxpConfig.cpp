@@ -37,10 +37,24 @@
  ******************************************************************************/
 
 #include <phNxpConfig.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <string>
 #include <vector>
-#include <list>
+#include <memory>
+#include <mutex>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <phNxpLog.h>
@@ -68,6 +82,8 @@ const int transport_config_path_size =
 #endif
 #define extra_config_ext ".conf"
 #define IsStringValue 0x80000000
+/* quiet period after a config file event before the files are re-parsed */
+#define CONFIG_RELOAD_DELAY_MS 200
 
 const char rf_config_timestamp_path[] =
         "/data/vendor/nfc/libnfc-nxpRFConfigState.bin";
@@ -79,28 +95,89 @@ const char default_nxp_config_path[] =
         "/vendor/etc/libnfc-nxp.conf";
 const char nxp_rf_config_path[] =
         "/system/vendor/libnfc-nxp_RF.conf";
+const char config_cache_path[] =
+        "/data/vendor/nfc/libnfc-nxpConfigCache.bin";
+/* CRCs of the main, RF and transit files last applied to the NFCC */
+const char config_state_path[] =
+        "/data/vendor/nfc/libnfc-nxpAllConfigState.bin";
+
+/* Indexes of the config file CRCs */
+enum { CONFIG_CRC_MAIN = 0, CONFIG_CRC_RF, CONFIG_CRC_TR, CONFIG_CRC_NB };
+
+#define CONFIG_STATE_MAGIC 0x5346584EU /* "NXFS" */
+typedef struct {
+  uint32_t magic;
+  uint32_t crc32[CONFIG_CRC_NB];
+  uint32_t checkCrc32; /* CRC of the fields above */
+} tConfigState;
+
+/* Binary config cache layout: header, sources, settings */
+#define CONFIG_CACHE_MAGIC 0x4346584EU /* "NXFC" */
+#define CONFIG_CACHE_VERSION 1
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t nbSources;
+  uint32_t nbParams;
+  uint32_t crc32[3]; /* main, RF and transit file CRCs */
+  uint32_t bodyLen;
+  uint32_t bodyCrc32;
+} tConfigCacheHeader;
+/* Source file state, all zero when the file does not exist */
+typedef struct {
+  uint64_t size;
+  int64_t mtimeSec;
+  int64_t mtimeNsec;
+  uint64_t ino;
+} tConfigFileStat;
+/* followed by the source path, pathLen bytes */
+typedef struct {
+  tConfigFileStat stat;
+  uint32_t pathLen;
+  uint32_t reserved;
+} tConfigCacheSource;
+/* followed by the name and value, each nul terminated */
+typedef struct {
+  uint64_t numValue;
+  uint32_t valueLen; /* 0 for a numerical setting */
+  uint32_t nameLen;
+} tConfigCacheParam;
 
 namespace {
 
-size_t readConfigFile(const char* fileName, uint8_t** p_data) {
-  FILE* fd = fopen(fileName, "rb");
-  if (fd == nullptr) return 0;
+/* Config files are parsed straight from a read-only mapping */
+size_t mapConfigFile(const char* fileName, const uint8_t** p_data) {
+  int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return 0;
 
-  fseek(fd, 0L, SEEK_END);
-  const size_t file_size = ftell(fd);
-  rewind(fd);
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    close(fd);
+    return 0;
+  }
+  const size_t file_size = file_stat.st_size;
 
-  uint8_t* buffer = new uint8_t[file_size];
-  size_t read = fread(buffer, file_size, 1, fd);
-  fclose(fd);
+  void* p_map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p_map == MAP_FAILED) return 0;
 
-  if (read == 1) {
-    *p_data = buffer;
-    return file_size;
-  }
+  *p_data = static_cast<const uint8_t*>(p_map);
+  return file_size;
+}
 
-  delete[] buffer;
-  return 0;
+void unmapConfigFile(const uint8_t* p_data, size_t size) {
+  munmap(const_cast<uint8_t*>(p_data), size);
+}
+
+void statConfigFile(const char* fileName, tConfigFileStat* pStat) {
+  struct stat file_stat;
+  memset(pStat, 0, sizeof(*pStat));
+  if (stat(fileName, &file_stat) == 0) {
+    pStat->size = file_stat.st_size;
+    pStat->mtimeSec = file_stat.st_mtim.tv_sec;
+    pStat->mtimeNsec = file_stat.st_mtim.tv_nsec;
+    pStat->ino = file_stat.st_ino;
+  }
 }
 
 }  // namespace
@@ -110,22 +187,85 @@ using namespace ::std;
 namespace nxp {
 
 void readOptionalConfig(const char* optional);
+void getOptionalConfigPath(const char* extra, string& strPath);
+class CNfcParam;
+bool getByteArrayValue(const CNfcParam* pParam, char* pValue, long len,
+                       long* readlen);
+bool getNumValue(const CNfcParam* pParam, void* pValue, unsigned long len);
+
+/* Size of the chunks holding the setting values */
+#define CONFIG_VALUE_CHUNK_SIZE 4096
+
+/*
+ * Storage of the string and byte array setting values. Values are packed in
+ * chunks, a value larger than a chunk gets its own, and never move until
+ * clear(), so settings refer to them directly.
+ */
+class CNfcValueArena {
+ public:
+  CNfcValueArena() : m_pFree(nullptr), m_left(0) {}
+  const char* store(const string& value);
+  void clear();
+
+ private:
+  vector<unique_ptr<char[]>> m_chunks;
+  char* m_pFree;
+  size_t m_left;
+};
 
 class CNfcParam : public string {
  public:
   CNfcParam();
-  CNfcParam(const char* name, const string& value);
+  CNfcParam(const char* name, const char* value, size_t len);
   CNfcParam(const char* name, unsigned long value);
   virtual ~CNfcParam();
   unsigned long numValue() const { return m_numValue; }
-  const char* str_value() const { return m_str_value.c_str(); }
-  size_t str_len() const { return m_str_value.length(); }
+  /* value stored in the config value arena, nul terminated */
+  const char* str_value() const { return m_str_value; }
+  size_t str_len() const { return m_str_len; }
 
  private:
-  string m_str_value;
+  const char* m_str_value;
+  size_t m_str_len;
   unsigned long m_numValue;
 };
 
+/*
+ * Immutable lookup index over the parsed settings: open addressing table,
+ * linear probing, at most half full. Built when a config file has been
+ * parsed and never modified afterwards, so it is read without locking.
+ */
+class CNfcConfigSnapshot {
+ public:
+  explicit CNfcConfigSnapshot(const vector<const CNfcParam*>& params);
+  const CNfcParam* find(const char* p_name) const;
+  const CNfcParam* find(tNxpConfigId id) const { return m_byId[id]; }
+
+ private:
+  struct Slot {
+    uint32_t hash;
+    uint32_t len;
+    const CNfcParam* pParam;
+  };
+  static uint32_t hash(const char* p_name, size_t len);
+  vector<Slot> m_slots;
+  uint32_t m_mask;
+  /* settings resolved by id at build time */
+  const CNfcParam* m_byId[NXP_CONFIG_ID_NB];
+};
+
+/*
+ * Storage of the settings replaced by a reload, kept until no lookup may
+ * still refer to them
+ */
+struct CNfcConfigStorage {
+  deque<CNfcParam> params;
+  CNfcValueArena values;
+  /* mapping of the config cache the settings were loaded from */
+  const uint8_t* pCache;
+  size_t cacheSize;
+};
+
 class CNfcConfig : public vector<const CNfcParam*> {
  public:
   virtual ~CNfcConfig();
@@ -140,19 +280,76 @@ class CNfcConfig : public vector<const CNfcParam*> {
   bool getValue(const char* name, unsigned short& rValue) const;
   bool getValue(const char* name, char* pValue, long len, long* readlen) const;
   const CNfcParam* find(const char* p_name) const;
+  const CNfcParam* find(tNxpConfigId id) const;
   void readNxpTransitConfig(const char* fileName) const;
   void readNxpRFConfig(const char* fileName) const;
   void clean();
+  bool startWatcher();
+  void stopWatcher();
+  bool getChanges(uint8_t* pBuf, uint16_t* pLen);
+  void hold() { beginRead(); }
+  void release() { endRead(); }
+  uint32_t getGeneration() const { return m_published.load(); }
 
  private:
+  friend class CNfcConfigReader;
   CNfcConfig();
+  void load(bool bUseCache);
+  void reload();
+  void recordChanges(const vector<const CNfcParam*>& old);
+  static void* watcherThread(void* arg);
+  void watch();
   bool readConfig(const char* name, bool bResetContent);
-  void moveFromList();
-  void moveToList();
-  void add(const CNfcParam* pParam);
+  void loadStoredState();
+  bool readCache(const char* name, const char* const* sources,
+                 uint32_t nbSources);
+  void writeCache(const char* name) const;
+  void add(const char* name, const string& value);
+  void add(const char* name, unsigned long value);
+  void append(const CNfcParam* pParam);
+  void sortAndDedup();
   void dump();
   bool isAllowed(const char* name);
-  list<const CNfcParam*> m_list;
+  void publish();
+  void retireStorage();
+  void reclaim();
+  void endRead();
+  void beginRead() { m_readers.fetch_add(1, std::memory_order_seq_cst); }
+  /* storage of every parsed setting, allocated by chunks, stable addresses */
+  deque<CNfcParam> m_params;
+  CNfcValueArena m_values;
+  /* lookup index of the current settings, NULL if none */
+  std::atomic<const CNfcConfigSnapshot*> m_snapshot;
+  /* lookups in progress, retired settings are freed once there is none */
+  std::atomic<uint32_t> m_readers;
+  /* retired settings left to free by the last lookup in progress */
+  std::atomic<bool> m_reclaimPending;
+  /* number of indexes published, identifies the current one */
+  std::atomic<uint32_t> m_published;
+  /* serializes loading, reloading and cleaning of the settings */
+  std::mutex m_lock;
+  /* set while several files are loaded, published once all are read */
+  bool m_loading;
+  /* replaced indexes and settings, freed by reclaim() */
+  vector<const CNfcConfigSnapshot*> m_retired;
+  vector<unique_ptr<CNfcConfigStorage>> m_retiredStorage;
+  /* files read, with their state when read, to validate the cache */
+  vector<pair<string, tConfigFileStat>> m_sources;
+  /* mapping of the config cache the settings were loaded from */
+  const uint8_t* m_pCache;
+  size_t m_cacheSize;
+  /* CRCs last applied to the NFCC, loaded once per config load */
+  bool m_storedLoaded;
+  bool m_storedValid[CONFIG_CRC_NB];
+  uint32_t m_storedCrc32[CONFIG_CRC_NB];
+  /* config file watcher, re-parsing the files when one of them changes */
+  pthread_t m_watcher;
+  bool m_watching;
+  int m_inotifyFd;
+  int m_stopFd;
+  /* names of the settings changed by the reloads, until reported */
+  vector<string> m_changes;
+  uint32_t m_generation;
   bool mValidFile;
   uint32_t config_crc32_;
   uint32_t config_crc32_rf_;
@@ -167,6 +364,24 @@ class CNfcConfig : public vector<const CNfcParam*> {
   inline void Reset(unsigned long f) { state &= ~f; }
 };
 
+/*
+ * Scope of a lookup and of the copy of its result: the settings found stay
+ * stored until the end of the scope, even if a reload or clean() runs
+ * meanwhile. The count is incremented before the index is loaded, both
+ * sequentially consistent, so that reclaim() seeing no reader after
+ * replacing the index implies no reader holds the replaced one.
+ */
+class CNfcConfigReader {
+ public:
+  explicit CNfcConfigReader(CNfcConfig& rConfig) : m_rConfig(rConfig) {
+    m_rConfig.beginRead();
+  }
+  ~CNfcConfigReader() { m_rConfig.endRead(); }
+
+ private:
+  CNfcConfig& m_rConfig;
+};
+
 /*******************************************************************************
 **
 ** Function:    isPrintable()
@@ -246,8 +461,8 @@ void findConfigFilePathFromTransportConfigPaths(const string& configName,
 **
 ** Function:    CNfcConfig::readConfig()
 **
-** Description: read Config settings and parse them into a linked list
-**              move the element from linked list to a array at the end
+** Description: read Config settings in a single pass, appending them to
+**              the array, then sort the array and drop overridden settings
 **
 ** Returns:     1, if there are any config data, 0 otherwise
 **
@@ -263,8 +478,14 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent) {
     END_LINE
   };
 
-  uint8_t* p_config = nullptr;
-  size_t config_size = readConfigFile(name, &p_config);
+  const uint8_t* p_config = nullptr;
+  tConfigFileStat file_stat;
+
+  if (bResetContent) m_sources.clear();
+  statConfigFile(name, &file_stat);
+  m_sources.push_back(make_pair(string(name), file_stat));
+
+  size_t config_size = mapConfigFile(name, &p_config);
   if (p_config == nullptr) {
     ALOGE("%s Cannot open config file %s\n", __func__, name);
     if (bResetContent) {
@@ -277,7 +498,6 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent) {
   string token;
   string strValue;
   unsigned long numValue = 0;
-  CNfcParam* pParam = NULL;
   int i = 0;
   int base = 0;
   char c;
@@ -295,12 +515,9 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent) {
     config_crc32_tr_ = sparse_crc32(0, p_config, config_size);
   }
   mValidFile = true;
-  if (size() > 0) {
-    if (bResetContent)
-      clean();
-    else
-      moveToList();
-  }
+  /* settings of a previous load stay stored until clean(), readers of the
+   * published index may still use them */
+  if (bResetContent) clear();
 
   for (size_t offset = 0; offset != config_size; ++offset) {
     c = p_config[offset];
@@ -403,10 +620,9 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent) {
             while (n-- > 0) strValue.push_back(((numValue >> (n * 8)) & 0xFF));
           }
           if (strValue.length() > 0)
-            pParam = new CNfcParam(token.c_str(), strValue);
+            add(token.c_str(), strValue);
           else
-            pParam = new CNfcParam(token.c_str(), numValue);
-          add(pParam);
+            add(token.c_str(), numValue);
           strValue.erase();
           numValue = 0;
         }
@@ -415,8 +631,7 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent) {
         if (c == '"') {
           strValue.push_back('\0');
           state = END_LINE;
-          pParam = new CNfcParam(token.c_str(), strValue);
-          add(pParam);
+          add(token.c_str(), strValue);
         } else if (isPrintable(c))
           strValue.push_back(c);
         break;
@@ -428,12 +643,341 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent) {
     }
   }
 
-  delete[] p_config;
+  unmapConfigFile(p_config, config_size);
 
-  moveFromList();
+  sortAndDedup();
+  if (!m_loading) publish();
   return size() > 0;
 }
 
+/*******************************************************************************
+**
+** Function:    CNfcConfigSnapshot::CNfcConfigSnapshot()
+**
+** Description: class constructor, index the given settings
+**
+** Returns:     none
+**
+*******************************************************************************/
+CNfcConfigSnapshot::CNfcConfigSnapshot(const vector<const CNfcParam*>& params) {
+  size_t nbSlots = 16;
+  while (nbSlots < 2 * params.size()) nbSlots <<= 1;
+  m_slots.assign(nbSlots, Slot{0, 0, NULL});
+  m_mask = nbSlots - 1;
+
+  for (const CNfcParam* pParam : params) {
+    uint32_t h = hash(pParam->c_str(), pParam->length());
+    uint32_t i = h & m_mask;
+    while (m_slots[i].pParam != NULL) {
+      /* first occurrence wins, as with the former sorted array scan */
+      if (*m_slots[i].pParam == *pParam) break;
+      i = (i + 1) & m_mask;
+    }
+    if (m_slots[i].pParam == NULL) {
+      m_slots[i] = Slot{h, (uint32_t)pParam->length(), pParam};
+    }
+  }
+
+  static const char* const id_names[NXP_CONFIG_ID_NB] = {
+#define NXP_CONFIG_ID_NAME(id, name) name,
+      NXP_CONFIG_ID_LIST(NXP_CONFIG_ID_NAME)
+#undef NXP_CONFIG_ID_NAME
+  };
+  for (int id = 0; id < NXP_CONFIG_ID_NB; id++) {
+    m_byId[id] = find(id_names[id]);
+  }
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfigSnapshot::hash()
+**
+** Description: FNV-1a hash of a setting name
+**
+** Returns:     hash value
+**
+*******************************************************************************/
+uint32_t CNfcConfigSnapshot::hash(const char* p_name, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)p_name[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfigSnapshot::find()
+**
+** Description: search a setting in the index
+**
+** Returns:     pointer to the setting object, NULL if not found
+**
+*******************************************************************************/
+const CNfcParam* CNfcConfigSnapshot::find(const char* p_name) const {
+  size_t len = strlen(p_name);
+  uint32_t h = hash(p_name, len);
+
+  for (uint32_t i = h & m_mask;; i = (i + 1) & m_mask) {
+    const Slot& slot = m_slots[i];
+    if (slot.pParam == NULL) return NULL;
+    if (slot.hash == h && slot.len == len &&
+        memcmp(slot.pParam->c_str(), p_name, len) == 0) {
+      return slot.pParam;
+    }
+  }
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::publish()
+**
+** Description: build the lookup index of the current settings and make it
+**              visible to the readers
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::publish() {
+  const CNfcConfigSnapshot* pSnapshot =
+      (size() > 0) ? new CNfcConfigSnapshot(*this) : NULL;
+  const CNfcConfigSnapshot* pOld =
+      m_snapshot.exchange(pSnapshot, std::memory_order_seq_cst);
+  m_published.fetch_add(1, std::memory_order_release);
+  /* readers may still hold the old index, keep it until reclaim() */
+  if (pOld != NULL) m_retired.push_back(pOld);
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::retireStorage()
+**
+** Description: move the storage of the current settings aside, to be freed
+**              by reclaim() once no reader refers to them. Called with
+**              m_lock held, before the settings are replaced.
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::retireStorage() {
+  if (m_params.empty() && m_pCache == nullptr) return;
+
+  unique_ptr<CNfcConfigStorage> pStorage(new CNfcConfigStorage);
+  pStorage->params = std::move(m_params);
+  pStorage->values = std::move(m_values);
+  pStorage->pCache = m_pCache;
+  pStorage->cacheSize = m_cacheSize;
+  m_retiredStorage.push_back(std::move(pStorage));
+  m_params.clear();
+  m_values.clear();
+  m_pCache = nullptr;
+  m_cacheSize = 0;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::reclaim()
+**
+** Description: free the retired indexes and settings if no lookup is in
+**              progress, otherwise leave them to the last one. Called with
+**              m_lock held, after the retired index has been replaced.
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::reclaim() {
+  if (m_retired.empty() && m_retiredStorage.empty()) return;
+
+  m_reclaimPending.store(true, std::memory_order_seq_cst);
+  if (m_readers.load(std::memory_order_seq_cst) != 0) return;
+  m_reclaimPending.store(false, std::memory_order_relaxed);
+
+  for (const CNfcConfigSnapshot* pSnapshot : m_retired) delete pSnapshot;
+  m_retired.clear();
+  for (const auto& pStorage : m_retiredStorage) {
+    if (pStorage->pCache != nullptr) {
+      unmapConfigFile(pStorage->pCache, pStorage->cacheSize);
+    }
+  }
+  m_retiredStorage.clear();
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::endRead()
+**
+** Description: end a lookup scope, the last one frees the retired settings
+**              left by reclaim(). If m_lock is busy they are freed by a
+**              later lookup, reload or clean()
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::endRead() {
+  if (m_readers.fetch_sub(1, std::memory_order_seq_cst) != 1) return;
+  if (!m_reclaimPending.load(std::memory_order_seq_cst)) return;
+  if (!m_lock.try_lock()) return;
+  reclaim();
+  m_lock.unlock();
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::readCache()
+**
+** Description: load the settings from the binary config cache, provided it
+**              was built from the given source files and none of them has
+**              changed since. The settings refer to the cache mapping, which
+**              is kept until clean().
+**
+** Returns:     true if the settings are loaded from the cache
+**
+*******************************************************************************/
+bool CNfcConfig::readCache(const char* name, const char* const* sources,
+                           uint32_t nbSources) {
+  const uint8_t* p_cache = nullptr;
+  size_t cache_size = mapConfigFile(name, &p_cache);
+  if (p_cache == nullptr) return false;
+
+  tConfigCacheHeader header;
+  const uint8_t* p_cur = p_cache + sizeof(header);
+  const uint8_t* p_end = p_cache + cache_size;
+  uint32_t i;
+
+  m_sources.clear();
+  if (cache_size < sizeof(header)) goto invalid;
+  memcpy(&header, p_cache, sizeof(header));
+  if (header.magic != CONFIG_CACHE_MAGIC ||
+      header.version != CONFIG_CACHE_VERSION ||
+      header.nbSources != nbSources ||
+      header.bodyLen != cache_size - sizeof(header) ||
+      header.bodyCrc32 != sparse_crc32(0, p_cur, header.bodyLen)) {
+    goto invalid;
+  }
+
+  for (i = 0; i < nbSources; i++) {
+    tConfigCacheSource source;
+    tConfigFileStat file_stat;
+    if ((size_t)(p_end - p_cur) < sizeof(source)) goto invalid;
+    memcpy(&source, p_cur, sizeof(source));
+    p_cur += sizeof(source);
+    if ((size_t)(p_end - p_cur) < source.pathLen ||
+        strlen(sources[i]) != source.pathLen ||
+        memcmp(p_cur, sources[i], source.pathLen) != 0) {
+      goto invalid;
+    }
+    p_cur += source.pathLen;
+    statConfigFile(sources[i], &file_stat);
+    if (memcmp(&file_stat, &source.stat, sizeof(file_stat)) != 0) {
+      ALOGD("%s %s changed", __func__, sources[i]);
+      goto invalid;
+    }
+    m_sources.push_back(make_pair(string(sources[i]), file_stat));
+  }
+
+  for (i = 0; i < header.nbParams; i++) {
+    tConfigCacheParam param;
+    if ((size_t)(p_end - p_cur) < sizeof(param)) goto invalid;
+    memcpy(&param, p_cur, sizeof(param));
+    p_cur += sizeof(param);
+    if ((size_t)(p_end - p_cur) < (size_t)param.nameLen + param.valueLen + 2 ||
+        p_cur[param.nameLen] != '\0' ||
+        p_cur[param.nameLen + 1 + param.valueLen] != '\0') {
+      goto invalid;
+    }
+    const char* p_name = (const char*)p_cur;
+    p_cur += param.nameLen + 1;
+    if (param.valueLen > 0)
+      m_params.emplace_back(p_name, (const char*)p_cur, param.valueLen);
+    else
+      m_params.emplace_back(p_name, (unsigned long)param.numValue);
+    p_cur += param.valueLen + 1;
+    push_back(&m_params.back());
+  }
+
+  m_pCache = p_cache;
+  m_cacheSize = cache_size;
+  config_crc32_ = header.crc32[0];
+  config_crc32_rf_ = header.crc32[1];
+  config_crc32_tr_ = header.crc32[2];
+  mValidFile = true;
+  if (!m_loading) publish();
+  ALOGD("%s %u settings loaded from %s", __func__, header.nbParams, name);
+  return size() > 0;
+
+invalid:
+  ALOGD("%s %s not valid, parsing config files", __func__, name);
+  clear();
+  m_params.clear();
+  m_sources.clear();
+  unmapConfigFile(p_cache, cache_size);
+  return false;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::writeCache()
+**
+** Description: save the parsed settings and the state of their source files
+**              to the binary config cache
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::writeCache(const char* name) const {
+  tConfigCacheHeader header;
+  string body;
+
+  if (size() == 0) return;
+
+  for (const auto& source : m_sources) {
+    tConfigCacheSource entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.stat = source.second;
+    entry.pathLen = source.first.length();
+    body.append((const char*)&entry, sizeof(entry));
+    body.append(source.first);
+  }
+  for (const_iterator it = begin(), itEnd = end(); it != itEnd; ++it) {
+    tConfigCacheParam param;
+    param.numValue = (*it)->numValue();
+    param.valueLen = (*it)->str_len();
+    param.nameLen = (*it)->length();
+    body.append((const char*)&param, sizeof(param));
+    body.append((*it)->c_str(), param.nameLen + 1);
+    body.append((*it)->str_value(), param.valueLen);
+    body.push_back('\0');
+  }
+
+  header.magic = CONFIG_CACHE_MAGIC;
+  header.version = CONFIG_CACHE_VERSION;
+  header.nbSources = m_sources.size();
+  header.nbParams = size();
+  header.crc32[0] = config_crc32_;
+  header.crc32[1] = config_crc32_rf_;
+  header.crc32[2] = config_crc32_tr_;
+  header.bodyLen = body.length();
+  header.bodyCrc32 = sparse_crc32(0, body.data(), body.length());
+
+  /* written aside then renamed, so a reader never sees a partial cache */
+  string tmpPath(name);
+  tmpPath += ".tmp";
+  FILE* fd = fopen(tmpPath.c_str(), "wb");
+  if (fd == nullptr) {
+    ALOGE("%s Unable to open file '%s' for writing", __func__,
+          tmpPath.c_str());
+    return;
+  }
+  bool written = (fwrite(&header, sizeof(header), 1, fd) == 1) &&
+                 (fwrite(body.data(), body.length(), 1, fd) == 1);
+  if (fclose(fd) != 0 || !written ||
+      rename(tmpPath.c_str(), name) != 0) {
+    ALOGE("%s Unable to write '%s'", __func__, name);
+    remove(tmpPath.c_str());
+  }
+}
+
 /*******************************************************************************
 **
 ** Function:    CNfcConfig::CNfcConfig()
@@ -443,7 +987,24 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent) {
 ** Returns:     none
 **
 *******************************************************************************/
-CNfcConfig::CNfcConfig() : mValidFile(true), state(0) {}
+CNfcConfig::CNfcConfig()
+    : m_snapshot(NULL),
+      m_readers(0),
+      m_reclaimPending(false),
+      m_published(0),
+      m_loading(false),
+      m_pCache(nullptr),
+      m_cacheSize(0),
+      m_storedLoaded(false),
+      m_watching(false),
+      m_inotifyFd(-1),
+      m_stopFd(-1),
+      m_generation(0),
+      mValidFile(true),
+      config_crc32_(0),
+      config_crc32_rf_(0),
+      config_crc32_tr_(0),
+      state(0) {}
 
 /*******************************************************************************
 **
@@ -454,7 +1015,16 @@ CNfcConfig::CNfcConfig() : mValidFile(true), state(0) {}
 ** Returns:     none
 **
 *******************************************************************************/
-CNfcConfig::~CNfcConfig() {}
+CNfcConfig::~CNfcConfig() {
+  stopWatcher();
+  delete m_snapshot.load();
+  for (const CNfcConfigSnapshot* pSnapshot : m_retired) delete pSnapshot;
+  for (const auto& pStorage : m_retiredStorage) {
+    if (pStorage->pCache != nullptr) {
+      unmapConfigFile(pStorage->pCache, pStorage->cacheSize);
+    }
+  }
+}
 
 /*******************************************************************************
 **
@@ -468,25 +1038,58 @@ CNfcConfig::~CNfcConfig() {}
 CNfcConfig& CNfcConfig::GetInstance() {
   static CNfcConfig theInstance;
 
-  if (theInstance.size() == 0 && theInstance.mValidFile) {
-    string strPath;
-    if (alternative_config_path[0] != '\0') {
-      strPath.assign(alternative_config_path);
-      strPath += config_name;
-      theInstance.readConfig(strPath.c_str(), true);
-      if (!theInstance.empty()) {
-        return theInstance;
-      }
+  if (theInstance.m_snapshot.load(std::memory_order_acquire) == NULL) {
+    std::lock_guard<std::mutex> lock(theInstance.m_lock);
+    if (theInstance.size() == 0 && theInstance.mValidFile) {
+      theInstance.load(true);
     }
+  }
+  return theInstance;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::load()
+**
+** Description: read the settings of all the config files, from the config
+**              cache if allowed and valid, and publish them at once.
+**              Called with m_lock held.
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::load(bool bUseCache) {
+  string strPath;
+
+  m_loading = true;
+  clear();
+  if (alternative_config_path[0] != '\0') {
+    strPath.assign(alternative_config_path);
+    strPath += config_name;
+    readConfig(strPath.c_str(), true);
+  }
+  if (empty()) {
     findConfigFilePathFromTransportConfigPaths(config_name, strPath);
-    theInstance.readConfig(strPath.c_str(), true);
 #if (NXP_EXTNS == TRUE)
-    readOptionalConfig("brcm");
-    theInstance.readNxpTransitConfig(transit_config_path);
-    theInstance.readNxpRFConfig(nxp_rf_config_path);
+    string strBrcmPath;
+    getOptionalConfigPath("brcm", strBrcmPath);
+    const char* sources[] = {strPath.c_str(), strBrcmPath.c_str(),
+                             transit_config_path, nxp_rf_config_path};
+    if (!bUseCache ||
+        !readCache(config_cache_path, sources,
+                   sizeof(sources) / sizeof(sources[0]))) {
+      readConfig(strPath.c_str(), true);
+      readConfig(strBrcmPath.c_str(), false);
+      readConfig(transit_config_path, false);
+      readConfig(nxp_rf_config_path, false);
+      writeCache(config_cache_path);
+    }
+#else
+    readConfig(strPath.c_str(), true);
 #endif
   }
-  return theInstance;
+  m_loading = false;
+  publish();
 }
 
 /*******************************************************************************
@@ -513,7 +1116,21 @@ bool CNfcConfig::getValue(const char* name, char* pValue, size_t len) const {
 
 bool CNfcConfig::getValue(const char* name, char* pValue, long len,
                           long* readlen) const {
-  const CNfcParam* pParam = find(name);
+  return getByteArrayValue(find(name), pValue, len, readlen);
+}
+
+/*******************************************************************************
+**
+** Function:    getByteArrayValue()
+**
+** Description: get the byte array value of a setting
+**
+** Returns:     true if setting exists
+**              false if setting does not exist
+**
+*******************************************************************************/
+bool getByteArrayValue(const CNfcParam* pParam, char* pValue, long len,
+                       long* readlen) {
   if (pParam == NULL) return false;
 
   if (pParam->str_len() > 0) {
@@ -582,24 +1199,38 @@ bool CNfcConfig::getValue(const char* name, unsigned short& rValue) const {
 **
 *******************************************************************************/
 const CNfcParam* CNfcConfig::find(const char* p_name) const {
-  if (size() == 0) return NULL;
-
-  for (const_iterator it = begin(), itEnd = end(); it != itEnd; ++it) {
-    if (**it < p_name) {
-      continue;
-    } else if (**it == p_name) {
-      if ((*it)->str_len() > 0) {
-        NXPLOG_EXTNS_D("%s found %s=%s\n", __func__, p_name,
-                       (*it)->str_value());
-      } else {
-        NXPLOG_EXTNS_D("%s found %s=(0x%lx)\n", __func__, p_name,
-                       (*it)->numValue());
-      }
-      return *it;
-    } else
-      break;
+  const CNfcConfigSnapshot* pSnapshot =
+      m_snapshot.load(std::memory_order_seq_cst);
+  if (pSnapshot == NULL) return NULL;
+
+  const CNfcParam* pParam = pSnapshot->find(p_name);
+  if (pParam != NULL) {
+    if (pParam->str_len() > 0) {
+      NXPLOG_EXTNS_D("%s found %s=%s\n", __func__, p_name,
+                     pParam->str_value());
+    } else {
+      NXPLOG_EXTNS_D("%s found %s=(0x%lx)\n", __func__, p_name,
+                     pParam->numValue());
+    }
   }
-  return NULL;
+  return pParam;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::find()
+**
+** Description: get the setting of a given id
+**
+** Returns:     pointer to the setting object, NULL if not set
+**
+*******************************************************************************/
+const CNfcParam* CNfcConfig::find(tNxpConfigId id) const {
+  const CNfcConfigSnapshot* pSnapshot =
+      m_snapshot.load(std::memory_order_seq_cst);
+  if (pSnapshot == NULL || id >= NXP_CONFIG_ID_NB) return NULL;
+
+  return pSnapshot->find(id);
 }
 
 /*******************************************************************************
@@ -640,44 +1271,326 @@ void CNfcConfig::readNxpRFConfig(const char* fileName) const {
 **
 *******************************************************************************/
 void CNfcConfig::clean() {
+  std::lock_guard<std::mutex> lock(m_lock);
   if (size() == 0) return;
 
-  for (iterator it = begin(), itEnd = end(); it != itEnd; ++it) delete *it;
   clear();
+  publish();
+  retireStorage();
+  /* grace period: lookups started on a retired index are over once the
+   * reader count drops to zero, new ones find no index */
+  while (m_readers.load(std::memory_order_seq_cst) != 0) sched_yield();
+  reclaim();
+  m_storedLoaded = false;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::reload()
+**
+** Description: re-parse the config files into new settings and publish
+**              them in place of the current ones. The replaced settings are
+**              freed once no reader refers to them.
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::reload() {
+  std::lock_guard<std::mutex> lock(m_lock);
+  /* nothing loaded yet, the next lookup reads the files */
+  if (size() == 0) return;
+
+  vector<const CNfcParam*> old(begin(), end());
+  retireStorage();
+  load(false);
+  recordChanges(old);
+  reclaim();
 }
 
 /*******************************************************************************
 **
-** Function:    CNfcConfig::Add()
+** Function:    CNfcConfig::recordChanges()
 **
-** Description: add a setting object to the list
+** Description: compare the current settings with the given former ones, both
+**              sorted by name, and record the names of the settings added,
+**              removed or whose value differs
 **
 ** Returns:     none
 **
 *******************************************************************************/
-void CNfcConfig::add(const CNfcParam* pParam) {
-  if (m_list.size() == 0) {
-    m_list.push_back(pParam);
+void CNfcConfig::recordChanges(const vector<const CNfcParam*>& old) {
+  const_iterator itOld = old.begin(), itNew = begin();
+  size_t nbChanges = m_changes.size();
+
+  while (itOld != old.end() || itNew != end()) {
+    if (itNew == end() || (itOld != old.end() && **itOld < **itNew)) {
+      m_changes.push_back(**itOld++);
+    } else if (itOld == old.end() || **itNew < **itOld) {
+      m_changes.push_back(**itNew++);
+    } else {
+      const CNfcParam* pOld = *itOld++;
+      const CNfcParam* pNew = *itNew++;
+      if (pOld->numValue() != pNew->numValue() ||
+          pOld->str_len() != pNew->str_len() ||
+          memcmp(pOld->str_value(), pNew->str_value(), pNew->str_len()) != 0) {
+        m_changes.push_back(*pNew);
+      }
+    }
+  }
+  if (m_changes.size() == nbChanges) {
+    ALOGD("%s config reloaded, no setting changed", __func__);
     return;
   }
-  if ((mCurrentFile.find("nxpTransit") != std::string::npos) &&
+  m_generation++;
+  for (size_t i = nbChanges; i < m_changes.size(); i++) {
+    ALOGD("%s %s changed", __func__, m_changes[i].c_str());
+  }
+  sort(m_changes.begin(), m_changes.end());
+  m_changes.erase(unique(m_changes.begin(), m_changes.end()), m_changes.end());
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::getChanges()
+**
+** Description: report the settings changed by the reloads since the last
+**              call: reload generation on 4 bytes (little endian) followed by
+**              the nul terminated names. Names which do not fit in the buffer
+**              are kept for the next call.
+**
+** Returns:     true if all the changed settings are reported
+**
+*******************************************************************************/
+bool CNfcConfig::getChanges(uint8_t* pBuf, uint16_t* pLen) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  uint16_t len = 4;
+  size_t i;
+
+  if (*pLen < len) return false;
+  pBuf[0] = (uint8_t)m_generation;
+  pBuf[1] = (uint8_t)(m_generation >> 8);
+  pBuf[2] = (uint8_t)(m_generation >> 16);
+  pBuf[3] = (uint8_t)(m_generation >> 24);
+  for (i = 0; i < m_changes.size(); i++) {
+    size_t nameLen = m_changes[i].length() + 1;
+    if (nameLen > (size_t)(*pLen - len)) break;
+    memcpy(pBuf + len, m_changes[i].c_str(), nameLen);
+    len += nameLen;
+  }
+  m_changes.erase(m_changes.begin(), m_changes.begin() + i);
+  *pLen = len;
+  return m_changes.empty();
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::startWatcher()
+**
+** Description: watch the directories of the config files read and reload
+**              the settings when one of the files is written, replaced or
+**              removed
+**
+** Returns:     true if the watcher is running
+**
+*******************************************************************************/
+bool CNfcConfig::startWatcher() {
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (m_watching) return true;
+
+  m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  m_stopFd = eventfd(0, EFD_CLOEXEC);
+  if (m_inotifyFd < 0 || m_stopFd < 0) {
+    ALOGE("%s Unable to create the watcher fds", __func__);
+    goto error;
+  }
+  for (const auto& source : m_sources) {
+    size_t sep = source.first.rfind('/');
+    if (sep == string::npos) continue;
+    string dir = source.first.substr(0, sep + 1);
+    if (inotify_add_watch(m_inotifyFd, dir.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                              IN_DELETE) < 0) {
+      ALOGD("%s Unable to watch %s", __func__, dir.c_str());
+    }
+  }
+  if (pthread_create(&m_watcher, NULL, watcherThread, this) != 0) {
+    ALOGE("%s Unable to create the watcher thread", __func__);
+    goto error;
+  }
+  m_watching = true;
+  return true;
+
+error:
+  if (m_inotifyFd >= 0) close(m_inotifyFd);
+  if (m_stopFd >= 0) close(m_stopFd);
+  m_inotifyFd = m_stopFd = -1;
+  return false;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::stopWatcher()
+**
+** Description: stop the config file watcher and wait for its thread, along
+**              with any reload in progress
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::stopWatcher() {
+  if (!m_watching) return;
+
+  uint64_t stop = 1;
+  if (write(m_stopFd, &stop, sizeof(stop)) != sizeof(stop)) {
+    ALOGE("%s Unable to signal the watcher thread", __func__);
+  }
+  pthread_join(m_watcher, NULL);
+  close(m_inotifyFd);
+  close(m_stopFd);
+  m_inotifyFd = m_stopFd = -1;
+  m_watching = false;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::watcherThread()
+**
+** Description: config file watcher thread entry
+**
+** Returns:     NULL
+**
+*******************************************************************************/
+void* CNfcConfig::watcherThread(void* arg) {
+  static_cast<CNfcConfig*>(arg)->watch();
+  return NULL;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::watch()
+**
+** Description: wait for events on the config files, reload the settings once
+**              the files have been quiet for CONFIG_RELOAD_DELAY_MS so that
+**              a file being rewritten in several steps is parsed once
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::watch() {
+  vector<string> names;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (const auto& source : m_sources) {
+      names.push_back(source.first.substr(source.first.rfind('/') + 1));
+    }
+  }
+
+  struct pollfd fds[2] = {{m_inotifyFd, POLLIN, 0}, {m_stopFd, POLLIN, 0}};
+  alignas(struct inotify_event) char events[1024];
+  bool pending = false;
+
+  for (;;) {
+    int ret = poll(fds, 2, pending ? CONFIG_RELOAD_DELAY_MS : -1);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      ALOGE("%s poll failed, errno = 0x%x", __func__, errno);
+      break;
+    }
+    if (fds[1].revents != 0) break;
+    if (ret == 0) {
+      pending = false;
+      reload();
+      continue;
+    }
+    ssize_t len;
+    while ((len = read(m_inotifyFd, events, sizeof(events))) > 0) {
+      for (char* p = events; p < events + len;) {
+        const struct inotify_event* pEvent = (const struct inotify_event*)p;
+        if (pEvent->mask & IN_Q_OVERFLOW) pending = true;
+        if (pEvent->len > 0 &&
+            std::find(names.begin(), names.end(), pEvent->name) !=
+                names.end()) {
+          pending = true;
+        }
+        p += sizeof(struct inotify_event) + pEvent->len;
+      }
+    }
+  }
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::add()
+**
+** Description: store a string setting and append it to the array
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::add(const char* name, const string& value) {
+  m_params.emplace_back(name, m_values.store(value), value.length());
+  append(&m_params.back());
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::add()
+**
+** Description: store a numerical setting and append it to the array
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::add(const char* name, unsigned long value) {
+  m_params.emplace_back(name, value);
+  append(&m_params.back());
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcConfig::append()
+**
+** Description: append a setting object to the array, the array is sorted
+**              once the whole file is parsed
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::append(const CNfcParam* pParam) {
+  if (size() > 0 && (mCurrentFile.find("nxpTransit") != std::string::npos) &&
       !isAllowed(pParam->c_str())) {
     ALOGD("%s Token restricted. Returning", __func__);
     return;
   }
-  for (list<const CNfcParam*>::iterator it = m_list.begin(),
-                                        itEnd = m_list.end();
-       it != itEnd; ++it) {
-    if (**it < pParam->c_str()) continue;
-    if (**it == pParam->c_str())
-      m_list.insert(m_list.erase(it), pParam);
-    else
-      m_list.insert(it, pParam);
+  push_back(pParam);
+}
 
-    return;
+/*******************************************************************************
+**
+** Function:    CNfcConfig::sortAndDedup()
+**
+** Description: sort the setting array by name and keep only the last setting
+**              of each name, so a file read later overrides the former ones
+**              and the last occurrence within a file wins
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcConfig::sortAndDedup() {
+  std::stable_sort(begin(), end(),
+                   [](const CNfcParam* a, const CNfcParam* b) {
+                     return *a < *b;
+                   });
+
+  iterator out = begin();
+  for (iterator it = begin(), itEnd = end(); it != itEnd; ++it) {
+    iterator next = it + 1;
+    if (next != itEnd && **next == **it) continue;
+    *out++ = *it;
   }
-  m_list.push_back(pParam);
+  erase(out, end());
 }
+
 /*******************************************************************************
 **
 ** Function:    CNfcConfig::dump()
@@ -690,9 +1603,7 @@ void CNfcConfig::add(const CNfcParam* pParam) {
 void CNfcConfig::dump() {
   ALOGD("%s Enter", __func__);
 
-  for (list<const CNfcParam*>::iterator it = m_list.begin(),
-                                        itEnd = m_list.end();
-       it != itEnd; ++it) {
+  for (iterator it = begin(), itEnd = end(); it != itEnd; ++it) {
     if ((*it)->str_len() > 0)
       ALOGD("%s %s \t= %s", __func__, (*it)->c_str(), (*it)->str_value());
     else
@@ -729,113 +1640,124 @@ bool CNfcConfig::isAllowed(const char* name) {
 }
 /*******************************************************************************
 **
-** Function:    CNfcConfig::moveFromList()
-**
-** Description: move the setting object from list to array
-**
-** Returns:     none
-**
-*******************************************************************************/
-void CNfcConfig::moveFromList() {
-  if (m_list.size() == 0) return;
-
-  for (list<const CNfcParam*>::iterator it = m_list.begin(),
-                                        itEnd = m_list.end();
-       it != itEnd; ++it)
-    push_back(*it);
-  m_list.clear();
-}
-
-/*******************************************************************************
-**
-** Function:    CNfcConfig::moveToList()
+** Function:    CNfcConfig::loadStoredState()
 **
-** Description: move the setting object from array to list
+** Description: read the CRCs of the config files last applied to the NFCC,
+**              from the state file or else from the former per file
+**              timestamp files
 **
 ** Returns:     none
 **
 *******************************************************************************/
-void CNfcConfig::moveToList() {
-  if (m_list.size() != 0) m_list.clear();
+void CNfcConfig::loadStoredState() {
+  static const char* const legacy_paths[CONFIG_CRC_NB] = {
+      config_timestamp_path, rf_config_timestamp_path,
+      tr_config_timestamp_path};
+  tConfigState config_state;
+  FILE* fd;
+
+  m_storedLoaded = true;
+  memset(m_storedValid, 0, sizeof(m_storedValid));
+
+  fd = fopen(config_state_path, "r");
+  if (fd != nullptr) {
+    size_t read = fread(&config_state, sizeof(config_state), 1, fd);
+    fclose(fd);
+    if (read == 1 && config_state.magic == CONFIG_STATE_MAGIC &&
+        config_state.checkCrc32 ==
+            sparse_crc32(0, &config_state,
+                         offsetof(tConfigState, checkCrc32))) {
+      for (int i = 0; i < CONFIG_CRC_NB; i++) {
+        m_storedCrc32[i] = config_state.crc32[i];
+        m_storedValid[i] = true;
+      }
+      return;
+    }
+    ALOGE("%s Invalid file '%s'", __func__, config_state_path);
+  }
 
-  for (iterator it = begin(), itEnd = end(); it != itEnd; ++it)
-    m_list.push_back(*it);
-  clear();
+  for (int i = 0; i < CONFIG_CRC_NB; i++) {
+    fd = fopen(legacy_paths[i], "r");
+    if (fd == nullptr) continue;
+    m_storedCrc32[i] = 0;
+    fread(&m_storedCrc32[i], sizeof(uint32_t), 1, fd);
+    fclose(fd);
+    m_storedValid[i] = true;
+  }
 }
 
 bool CNfcConfig::isModified() {
-  FILE* fd = fopen(config_timestamp_path, "r+");
-  if (fd == nullptr) {
-    ALOGE("%s Unable to open file '%s' - assuming modified", __func__,
-          config_timestamp_path);
+  /* CRCs are updated by the reloads of the watcher thread */
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (!m_storedLoaded) loadStoredState();
+  if (!m_storedValid[CONFIG_CRC_MAIN]) {
+    ALOGE("%s No stored state - assuming modified", __func__);
     return true;
   }
 
-  uint32_t stored_crc32 = 0;
-  fread(&stored_crc32, sizeof(uint32_t), 1, fd);
-  fclose(fd);
-
-  return stored_crc32 != config_crc32_;
+  return m_storedCrc32[CONFIG_CRC_MAIN] != config_crc32_;
 }
 
 bool CNfcConfig::isModified(const char* pName) {
-  FILE* fd = nullptr;
-  bool isRfFile = false;
+  std::lock_guard<std::mutex> lock(m_lock);
+  int index;
+  uint32_t crc32;
   if (strcmp(nxp_rf_config_path, pName) == 0) {
-    isRfFile = true;
-    fd = fopen(rf_config_timestamp_path, "r+");
+    index = CONFIG_CRC_RF;
+    crc32 = config_crc32_rf_;
   }
   else if (strcmp(transit_config_path, pName) == 0) {
-    fd = fopen(tr_config_timestamp_path, "r+");
+    index = CONFIG_CRC_TR;
+    crc32 = config_crc32_tr_;
   }
-  if (fd == nullptr) {
+  else {
     return true;
   }
 
-  uint32_t stored_crc32 = 0;
-  fread(&stored_crc32, sizeof(uint32_t), 1, fd);
-  fclose(fd);
+  if (!m_storedLoaded) loadStoredState();
+  if (!m_storedValid[index]) {
+    return true;
+  }
 
-  if(isRfFile)
-    return stored_crc32 != config_crc32_rf_;
-  else
-    return stored_crc32 != config_crc32_tr_;
+  return m_storedCrc32[index] != crc32;
 }
 
 void CNfcConfig::resetModified() {
-  FILE* fd = nullptr;
-
-  fd = fopen(config_timestamp_path, "w+");
-  if (fd == nullptr) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  tConfigState config_state;
+  string tmpPath(config_state_path);
+  tmpPath += ".tmp";
+
+  config_state.magic = CONFIG_STATE_MAGIC;
+  config_state.crc32[CONFIG_CRC_MAIN] = config_crc32_;
+  config_state.crc32[CONFIG_CRC_RF] = config_crc32_rf_;
+  config_state.crc32[CONFIG_CRC_TR] = config_crc32_tr_;
+  config_state.checkCrc32 =
+      sparse_crc32(0, &config_state, offsetof(tConfigState, checkCrc32));
+
+  /* All the CRCs are replaced at once: written aside, synced, renamed */
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0660);
+  if (fd < 0) {
     ALOGE("%s Unable to open file '%s' for writing", __func__,
-          config_timestamp_path);
-  }
-  else
-  {
-    fwrite(&config_crc32_, sizeof(uint32_t), 1, fd);
-    fclose(fd);
-  }
-  fd = fopen(rf_config_timestamp_path, "w+");
-  if (fd == nullptr) {
-    ALOGE("%s Unable to open file '%s' for writing", __func__,
-        rf_config_timestamp_path);
+          tmpPath.c_str());
+    return;
   }
-  else
-  {
-    fwrite(&config_crc32_rf_, sizeof(uint32_t), 1, fd);
-    fclose(fd);
+  bool written = (write(fd, &config_state, sizeof(config_state)) ==
+                  (ssize_t)sizeof(config_state)) &&
+                 (fsync(fd) == 0);
+  close(fd);
+  if (!written || rename(tmpPath.c_str(), config_state_path) != 0) {
+    ALOGE("%s Unable to write '%s'", __func__, config_state_path);
+    remove(tmpPath.c_str());
+    return;
   }
 
-  fd = fopen(tr_config_timestamp_path, "w+");
-  if (fd == nullptr) {
-    ALOGE("%s Unable to open file '%s' for writing", __func__,
-        tr_config_timestamp_path);
-  }
-  else
-  {
-    fwrite(&config_crc32_tr_, sizeof(uint32_t), 1, fd);
-    fclose(fd);
+  for (int i = 0; i < CONFIG_CRC_NB; i++) {
+    m_storedCrc32[i] = config_state.crc32[i];
+    m_storedValid[i] = true;
   }
+  m_storedLoaded = true;
 }
 
 /*******************************************************************************
@@ -847,7 +1769,7 @@ void CNfcConfig::resetModified() {
 ** Returns:     none
 **
 *******************************************************************************/
-CNfcParam::CNfcParam() : m_numValue(0) {}
+CNfcParam::CNfcParam() : m_str_value(""), m_str_len(0), m_numValue(0) {}
 
 /*******************************************************************************
 **
@@ -869,8 +1791,8 @@ CNfcParam::~CNfcParam() {}
 ** Returns:     none
 **
 *******************************************************************************/
-CNfcParam::CNfcParam(const char* name, const string& value)
-    : string(name), m_str_value(value), m_numValue(0) {}
+CNfcParam::CNfcParam(const char* name, const char* value, size_t len)
+    : string(name), m_str_value(value), m_str_len(len), m_numValue(0) {}
 
 /*******************************************************************************
 **
@@ -882,7 +1804,53 @@ CNfcParam::CNfcParam(const char* name, const string& value)
 **
 *******************************************************************************/
 CNfcParam::CNfcParam(const char* name, unsigned long value)
-    : string(name), m_numValue(value) {}
+    : string(name), m_str_value(""), m_str_len(0), m_numValue(value) {}
+
+/*******************************************************************************
+**
+** Function:    CNfcValueArena::store()
+**
+** Description: copy a value into the arena, followed by a nul character
+**
+** Returns:     address of the stored value
+**
+*******************************************************************************/
+const char* CNfcValueArena::store(const string& value) {
+  size_t size = value.length() + 1;
+  char* pValue;
+
+  if (size > CONFIG_VALUE_CHUNK_SIZE) {
+    m_chunks.emplace_back(new char[size]);
+    pValue = m_chunks.back().get();
+  } else {
+    if (size > m_left) {
+      m_chunks.emplace_back(new char[CONFIG_VALUE_CHUNK_SIZE]);
+      m_pFree = m_chunks.back().get();
+      m_left = CONFIG_VALUE_CHUNK_SIZE;
+    }
+    pValue = m_pFree;
+    m_pFree += size;
+    m_left -= size;
+  }
+  memcpy(pValue, value.data(), value.length());
+  pValue[value.length()] = '\0';
+  return pValue;
+}
+
+/*******************************************************************************
+**
+** Function:    CNfcValueArena::clear()
+**
+** Description: free all the stored values
+**
+** Returns:     none
+**
+*******************************************************************************/
+void CNfcValueArena::clear() {
+  m_chunks.clear();
+  m_pFree = nullptr;
+  m_left = 0;
+}
 
 /*******************************************************************************
 **
@@ -895,6 +1863,21 @@ CNfcParam::CNfcParam(const char* name, unsigned long value)
 *******************************************************************************/
 void readOptionalConfig(const char* extra) {
   string strPath;
+
+  getOptionalConfigPath(extra, strPath);
+  CNfcConfig::GetInstance().readConfig(strPath.c_str(), false);
+}
+
+/*******************************************************************************
+**
+** Function:    getOptionalConfigPath()
+**
+** Description: get the path of an optional conf file
+**
+** Returns:     none
+**
+*******************************************************************************/
+void getOptionalConfigPath(const char* extra, string& strPath) {
   string configName(extra_config_base);
   configName += extra;
   configName += extra_config_ext;
@@ -905,8 +1888,6 @@ void readOptionalConfig(const char* extra) {
   } else {
     findConfigFilePathFromTransportConfigPaths(configName, strPath);
   }
-
-  CNfcConfig::GetInstance().readConfig(strPath.c_str(), false);
 }
 
 }  // namespace nxp
@@ -922,6 +1903,7 @@ void readOptionalConfig(const char* extra) {
 extern int GetNxpStrValue(const char* name, char* pValue,
                               unsigned long len) {
   nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  nxp::CNfcConfigReader reader(rConfig);
 
   return rConfig.getValue(name, pValue, len);
 }
@@ -946,10 +1928,41 @@ extern int GetNxpStrValue(const char* name, char* pValue,
 extern int GetNxpByteArrayValue(const char* name, char* pValue,
                                     long bufflen, long* len) {
   nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  nxp::CNfcConfigReader reader(rConfig);
 
   return rConfig.getValue(name, pValue, bufflen, len);
 }
 
+/*******************************************************************************
+**
+** Function:    GetNxpByteArrayValuePtr()
+**
+** Description: Get byte array value from the config file without copy.
+**
+** Parameters:
+**              name - name of the config param to read.
+**              ppValue - out parameter to return the address of the value,
+**                        valid until the next reload, or until
+**                        releaseNxpConfig() if the config is held with
+**                        holdNxpConfig().
+**              len - out parameter to return the number of bytes of value.
+**
+** Returns:     true[1] if config param name is found in the config file, else
+**              false[0]
+**
+*******************************************************************************/
+extern int GetNxpByteArrayValuePtr(const char* name, const uint8_t** ppValue,
+                                   long* len) {
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  nxp::CNfcConfigReader reader(rConfig);
+  const nxp::CNfcParam* pParam = rConfig.find(name);
+
+  if (pParam == NULL || pParam->str_len() == 0) return false;
+  *ppValue = (const uint8_t*)pParam->str_value();
+  *len = pParam->str_len();
+  return true;
+}
+
 /*******************************************************************************
 **
 ** Function:    GetNumValue
@@ -964,8 +1977,61 @@ extern int GetNxpNumValue(const char* name, void* pValue,
   if (!pValue) return false;
 
   nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
-  const nxp::CNfcParam* pParam = rConfig.find(name);
+  nxp::CNfcConfigReader reader(rConfig);
 
+  return nxp::getNumValue(rConfig.find(name), pValue, len);
+}
+
+/*******************************************************************************
+**
+** Function:    GetNxpNumValueById
+**
+** Description: API function for getting a numerical value of a setting
+**              from its id
+**
+** Returns:     true, if successful
+**
+*******************************************************************************/
+extern int GetNxpNumValueById(tNxpConfigId id, void* pValue,
+                              unsigned long len) {
+  if (!pValue) return false;
+
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  nxp::CNfcConfigReader reader(rConfig);
+
+  return nxp::getNumValue(rConfig.find(id), pValue, len);
+}
+
+/*******************************************************************************
+**
+** Function:    GetNxpByteArrayValueById()
+**
+** Description: Read byte array value of a setting from its id, see
+**              GetNxpByteArrayValue()
+**
+** Returns:     true[1] if config param is found in the config file, else
+**              false[0]
+**
+*******************************************************************************/
+extern int GetNxpByteArrayValueById(tNxpConfigId id, char* pValue,
+                                    long bufflen, long* len) {
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  nxp::CNfcConfigReader reader(rConfig);
+
+  return nxp::getByteArrayValue(rConfig.find(id), pValue, bufflen, len);
+}
+
+/*******************************************************************************
+**
+** Function:    nxp::getNumValue
+**
+** Description: convert the value of a setting to a number of len bytes
+**
+** Returns:     true, if successful
+**
+*******************************************************************************/
+bool nxp::getNumValue(const nxp::CNfcParam* pParam, void* pValue,
+                      unsigned long len) {
   if (pParam == NULL) return false;
   unsigned long v = pParam->numValue();
   if (v == 0 && pParam->str_len() > 0 && pParam->str_len() < 4) {
@@ -1054,3 +2120,99 @@ extern int updateNxpConfigTimestamp() {
   rConfig.resetModified();
   return 0;
 }
+
+/*******************************************************************************
+**
+** Function:    getNxpConfigGeneration()
+**
+** Description: identify the current settings, the value changes whenever
+**              the settings are reset or reloaded
+**
+** Returns:     generation of the current settings
+**
+*******************************************************************************/
+extern uint32_t getNxpConfigGeneration() {
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  return rConfig.getGeneration();
+}
+
+/*******************************************************************************
+**
+** Function:    holdNxpConfig()
+**
+** Description: keep the current settings stored, even if a reload replaces
+**              them, until releaseNxpConfig(). Used around the use of the
+**              values returned by GetNxpByteArrayValuePtr().
+**
+** Returns:     none
+**
+*******************************************************************************/
+extern void holdNxpConfig() {
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  rConfig.hold();
+}
+
+/*******************************************************************************
+**
+** Function:    releaseNxpConfig()
+**
+** Description: end a holdNxpConfig(), the settings replaced meanwhile are
+**              freed once no other lookup refers to them
+**
+** Returns:     none
+**
+*******************************************************************************/
+extern void releaseNxpConfig() {
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  rConfig.release();
+}
+
+/*******************************************************************************
+**
+** Function:    startNxpConfigWatcher()
+**
+** Description: reload the settings in the background whenever one of the
+**              config files read is modified, e.g. the transit config
+**
+** Returns:     1 if the watcher is running, 0 otherwise.
+**
+*******************************************************************************/
+extern int startNxpConfigWatcher() {
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  return rConfig.startWatcher();
+}
+
+/*******************************************************************************
+**
+** Function:    stopNxpConfigWatcher()
+**
+** Description: stop reloading the settings on config file modifications
+**
+** Returns:     none
+**
+*******************************************************************************/
+extern void stopNxpConfigWatcher() {
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  rConfig.stopWatcher();
+}
+
+/*******************************************************************************
+**
+** Function:    getNxpConfigChanges()
+**
+** Description: report the names of the settings changed by the background
+**              reloads since the last call.
+**
+** Parameters:
+**              pBuf - output buffer: reload generation on 4 bytes (little
+**                     endian) followed by the nul terminated names.
+**              pLen - in: size of pBuf, out: number of bytes written.
+**
+** Returns:     1 if all changes are reported, 0 if some are left for the
+**              next call.
+**
+*******************************************************************************/
+extern int getNxpConfigChanges(uint8_t* pBuf, uint16_t* pLen) {
+  nxp::CNfcConfig& rConfig = nxp::CNfcConfig::GetInstance();
+  return rConfig.getChanges(pBuf, pLen);
+}
@@ -39,14 +39,24 @@
 #ifndef __CONFIG_H
 #define __CONFIG_H
 
+#include <stdint.h>
+
 int GetNxpStrValue(const char* name, char* p_value, unsigned long len);
 int GetNxpNumValue(const char* name, void* p_value, unsigned long len);
 int GetNxpByteArrayValue(const char* name, char* pValue, long bufflen,
                          long* len);
+int GetNxpByteArrayValuePtr(const char* name, const uint8_t** ppValue,
+                            long* len);
 void resetNxpConfig(void);
 int isNxpRFConfigModified();
 int isNxpConfigModified();
 int updateNxpConfigTimestamp();
+uint32_t getNxpConfigGeneration(void);
+void holdNxpConfig(void);
+void releaseNxpConfig(void);
+int startNxpConfigWatcher(void);
+void stopNxpConfigWatcher(void);
+int getNxpConfigChanges(uint8_t* pBuf, uint16_t* pLen);
 
 #define NAME_NXPLOG_EXTNS_LOGLEVEL "NXPLOG_EXTNS_LOGLEVEL"
 #define NAME_NXPLOG_NCIHAL_LOGLEVEL "NXPLOG_NCIHAL_LOGLEVEL"
@@ -90,6 +100,11 @@ int updateNxpConfigTimestamp();
 #define NAME_NXP_SWP_FULL_PWR_ON "NXP_SWP_FULL_PWR_ON"
 #define NAME_NXP_CORE_RF_FIELD "NXP_CORE_RF_FIELD"
 #define NAME_NXP_I2C_FRAGMENTATION_ENABLED "NXP_I2C_FRAGMENTATION_ENABLED"
+#define NAME_NXP_I2C_COALESCED_READ "NXP_I2C_COALESCED_READ"
+#define NAME_NXP_TML_READ_STREAMING_DEPTH "NXP_TML_READ_STREAMING_DEPTH"
+#define NAME_NXP_TML_TRANSPORT "NXP_TML_TRANSPORT"
+#define NAME_NXP_TML_SIM_SCRIPT "NXP_TML_SIM_SCRIPT"
+#define NAME_NXP_FW_DNLD_PIPELINE "NXP_FW_DNLD_PIPELINE"
 #define NAME_RF_STATUS_UPDATE_ENABLE "RF_STATUS_UPDATE_ENABLE"
 #define NAME_ISO_DEP_MAX_TRANSCEIVE "ISO_DEP_MAX_TRANSCEIVE"
 #define NAME_NFA_POLL_BAIL_OUT_MODE "NFA_POLL_BAIL_OUT_MODE"
@@ -150,4 +165,23 @@ int updateNxpConfigTimestamp();
   "NXP_ALLOW_WIRED_IN_MIFARE_DESFIRE_CLT"
 #define NAME_NXP_DWP_INTF_RESET_ENABLE "NXP_DWP_INTF_RESET_ENABLE"
 #define NAME_NXP_MF_CLT_JCOP_CFG "NXP_MF_CLT_JCOP_CFG"
+
+/* Settings read on the NCI packet paths. They are also accessible by id,
+ * which resolves to a table load instead of a hashed name lookup.
+ * Each entry maps the id to the NAME_* setting name. */
+#define NXP_CONFIG_ID_LIST(ID)                              \
+  ID(MIFARE_READER_ENABLE, NAME_MIFARE_READER_ENABLE)       \
+  ID(RF_STATUS_UPDATE_ENABLE, NAME_RF_STATUS_UPDATE_ENABLE)
+
+typedef enum {
+#define NXP_CONFIG_ID_ENUM(id, name) NXP_CONFIG_ID_##id,
+  NXP_CONFIG_ID_LIST(NXP_CONFIG_ID_ENUM)
+#undef NXP_CONFIG_ID_ENUM
+  NXP_CONFIG_ID_NB
+} tNxpConfigId;
+
+int GetNxpNumValueById(tNxpConfigId id, void* p_value, unsigned long len);
+int GetNxpByteArrayValueById(tNxpConfigId id, char* pValue, long bufflen,
+                             long* len);
+
 #endif
@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <phNxpConfig.h>
+#include <phNxpLog.h>
+#include <phNxpNciHal_cfgdiff.h>
+#include "sparse_crc32.h"
+
+#define CFGDIFF_STATE_PATH "/data/vendor/nfc/libnfc-nxpAppliedConfig.bin"
+#define CFGDIFF_STATE_MAGIC 0x4146584EU /* "NXFA" */
+/* CORE_SET_CONFIG_CMD: 20 02, payload length, number of parameters */
+#define CFGDIFF_HDR_LEN 4
+/* Tags starting with this byte are 2 bytes long */
+#define CFGDIFF_EXT_TAG 0xA0
+
+/* State file: header, then per entry the tag length (1 byte), the value
+ * length (2 bytes, little endian), the tag and the value */
+typedef struct phNxpNciHal_CfgDiffHdr {
+  uint32_t magic;
+  uint32_t fwVersion;
+  uint32_t nbEntries;
+  uint32_t bodyLen;
+  uint32_t bodyCrc32;
+} phNxpNciHal_CfgDiffHdr_t;
+
+/* Parameter of a CORE_SET_CONFIG_CMD */
+typedef struct phNxpNciHal_CfgDiffTlv {
+  uint16_t offset; /* in the command */
+  uint16_t len;    /* tag, length and value */
+  uint8_t tagLen;
+} phNxpNciHal_CfgDiffTlv_t;
+
+typedef enum {
+  CFGDIFF_BLK_PENDING = 0,
+  CFGDIFF_BLK_DONE,
+  CFGDIFF_BLK_FAILED
+} phNxpNciHal_CfgDiffBlkState_t;
+
+/* Block registered in the current session */
+typedef struct phNxpNciHal_CfgDiffBlk {
+  const uint8_t* p_cmd;
+  uint16_t cmd_len;
+  std::vector<phNxpNciHal_CfgDiffTlv_t> tlvs;
+  std::vector<uint8_t> reduced;
+  const uint8_t* p_send; /* NULL - nothing to send */
+  uint16_t send_len;
+  phNxpNciHal_CfgDiffBlkState_t state;
+} phNxpNciHal_CfgDiffBlk_t;
+
+/* Tag set by the blocks of the current session */
+typedef struct phNxpNciHal_CfgDiffTag {
+  std::string value; /* length and value of every occurrence */
+  std::vector<int> blocks;
+  bool bChanged;
+} phNxpNciHal_CfgDiffTag_t;
+
+static struct phNxpNciHal_CfgDiff {
+  /* bLoaded, dwFwVersion, applied and bDirty are shared with the NCI write
+   * path and the client thread: protected by sCfgDiffLock */
+  bool bLoaded;
+  uint32_t dwFwVersion;
+  /* tag -> length and value of every occurrence last applied */
+  std::map<std::string, std::string> applied;
+  bool bDirty; /* applied differs from the state file */
+  /* current session */
+  bool bActive;
+  bool bFull;
+  bool bOpaque; /* a block could not be parsed, everything is sent */
+  std::vector<phNxpNciHal_CfgDiffBlk_t> blocks;
+  std::map<std::string, phNxpNciHal_CfgDiffTag_t> tags;
+} gCfgDiff;
+
+static std::mutex sCfgDiffLock;
+/* Serializes the state file updates, taken before sCfgDiffLock */
+static std::mutex sCfgDiffSaveLock;
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_parse
+**
+** Description      Split a CORE_SET_CONFIG_CMD into its parameters
+**
+** Returns          true if the command is a well formed CORE_SET_CONFIG_CMD
+**
+*******************************************************************************/
+static bool phNxpNciHal_cfgdiff_parse(
+    const uint8_t* p_cmd, uint16_t cmd_len,
+    std::vector<phNxpNciHal_CfgDiffTlv_t>* pTlvs) {
+  uint16_t offset = CFGDIFF_HDR_LEN;
+
+  pTlvs->clear();
+  if (cmd_len < CFGDIFF_HDR_LEN || p_cmd[0] != 0x20 || p_cmd[1] != 0x02 ||
+      p_cmd[2] != cmd_len - 3) {
+    return false;
+  }
+  while (offset < cmd_len) {
+    phNxpNciHal_CfgDiffTlv_t tlv;
+    tlv.offset = offset;
+    tlv.tagLen = (p_cmd[offset] == CFGDIFF_EXT_TAG) ? 2 : 1;
+    if (offset + tlv.tagLen + 1 > cmd_len) return false;
+    tlv.len = tlv.tagLen + 1 + p_cmd[offset + tlv.tagLen];
+    if (offset + tlv.len > cmd_len) return false;
+    pTlvs->push_back(tlv);
+    offset += tlv.len;
+  }
+  return pTlvs->size() == p_cmd[3];
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_load
+**
+** Description      Read the applied values from the state file, once. An
+**                  invalid file is removed. Called with sCfgDiffLock held.
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phNxpNciHal_cfgdiff_load(void) {
+  phNxpNciHal_CfgDiffHdr_t hdr;
+  std::string body;
+  struct stat st;
+
+  if (gCfgDiff.bLoaded) return;
+  gCfgDiff.bLoaded = true;
+  gCfgDiff.applied.clear();
+
+  int fd = open(CFGDIFF_STATE_PATH, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+  /* the body length is checked against the file before it is allocated */
+  bool bRead = (fstat(fd, &st) == 0) &&
+               (read(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr)) &&
+               (hdr.magic == CFGDIFF_STATE_MAGIC) &&
+               ((off_t)hdr.bodyLen == (st.st_size - (off_t)sizeof(hdr)));
+  if (bRead) {
+    body.resize(hdr.bodyLen);
+    bRead = (read(fd, &body[0], hdr.bodyLen) == (ssize_t)hdr.bodyLen) &&
+            (sparse_crc32(0, body.data(), body.length()) == hdr.bodyCrc32);
+  }
+  close(fd);
+  if (!bRead) {
+    NXPLOG_NCIHAL_E("%s invalid %s", __func__, CFGDIFF_STATE_PATH);
+    remove(CFGDIFF_STATE_PATH);
+    return;
+  }
+
+  size_t pos = 0;
+  for (uint32_t i = 0; i < hdr.nbEntries; i++) {
+    if (body.length() - pos < 3) goto invalid;
+    uint8_t tagLen = body[pos];
+    uint16_t valueLen = (uint8_t)body[pos + 1] | ((uint8_t)body[pos + 2] << 8);
+    pos += 3;
+    if (body.length() - pos < (size_t)tagLen + valueLen) goto invalid;
+    gCfgDiff.applied[body.substr(pos, tagLen)] =
+        body.substr(pos + tagLen, valueLen);
+    pos += tagLen + valueLen;
+  }
+  gCfgDiff.dwFwVersion = hdr.fwVersion;
+  return;
+
+invalid:
+  NXPLOG_NCIHAL_E("%s invalid %s", __func__, CFGDIFF_STATE_PATH);
+  remove(CFGDIFF_STATE_PATH);
+  gCfgDiff.applied.clear();
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_save
+**
+** Description      Replace the state file: written aside, synced, renamed
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phNxpNciHal_cfgdiff_save(const phNxpNciHal_CfgDiffHdr_t& hdr,
+                                     const std::string& body) {
+  const char* tmpPath = CFGDIFF_STATE_PATH ".tmp";
+
+  int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0660);
+  if (fd < 0) {
+    NXPLOG_NCIHAL_E("%s Unable to open %s", __func__, tmpPath);
+    return;
+  }
+  bool bWritten = (write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr)) &&
+                  (write(fd, body.data(), body.length()) ==
+                   (ssize_t)body.length()) &&
+                  (fsync(fd) == 0);
+  close(fd);
+  if (!bWritten || rename(tmpPath, CFGDIFF_STATE_PATH) != 0) {
+    NXPLOG_NCIHAL_E("%s Unable to write %s", __func__, CFGDIFF_STATE_PATH);
+    remove(tmpPath);
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_flush
+**
+** Description      Write the applied values to the state file if they changed
+**                  since it was last written. The file is written without
+**                  sCfgDiffLock held, so the NCI write path never waits for
+**                  it.
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_cfgdiff_flush(void) {
+  phNxpNciHal_CfgDiffHdr_t hdr;
+  std::string body;
+  std::lock_guard<std::mutex> saveLock(sCfgDiffSaveLock);
+
+  {
+    std::lock_guard<std::mutex> lock(sCfgDiffLock);
+    if (!gCfgDiff.bDirty) return;
+    gCfgDiff.bDirty = false;
+    for (const auto& entry : gCfgDiff.applied) {
+      body.push_back((char)entry.first.length());
+      body.push_back((char)entry.second.length());
+      body.push_back((char)(entry.second.length() >> 8));
+      body.append(entry.first);
+      body.append(entry.second);
+    }
+    hdr.magic = CFGDIFF_STATE_MAGIC;
+    hdr.fwVersion = gCfgDiff.dwFwVersion;
+    hdr.nbEntries = gCfgDiff.applied.size();
+    hdr.bodyLen = body.length();
+  }
+  hdr.bodyCrc32 = sparse_crc32(0, body.data(), body.length());
+  phNxpNciHal_cfgdiff_save(hdr, body);
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_begin
+**
+** Description      Start a session. The values applied with another firmware
+**                  are not trusted. The config is held until the session
+**                  ends, as the blocks are sent straight from its values.
+**
+** Parameters       dwFwVersion - firmware version of the NFCC
+**                  bFull - send all the parameters, e.g. after a firmware
+**                          download
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_cfgdiff_begin(uint32_t dwFwVersion, bool bFull) {
+  phNxpNciHal_cfgdiff_end();
+  holdNxpConfig();
+  {
+    std::lock_guard<std::mutex> lock(sCfgDiffLock);
+    phNxpNciHal_cfgdiff_load();
+    if (gCfgDiff.dwFwVersion != dwFwVersion) {
+      gCfgDiff.applied.clear();
+      gCfgDiff.dwFwVersion = dwFwVersion;
+    }
+  }
+  gCfgDiff.bActive = true;
+  gCfgDiff.bFull = bFull;
+  gCfgDiff.bOpaque = false;
+  gCfgDiff.blocks.clear();
+  gCfgDiff.tags.clear();
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_add
+**
+** Description      Register the next block of the session. The command must
+**                  stay valid until phNxpNciHal_cfgdiff_end().
+**
+** Returns          Block index
+**
+*******************************************************************************/
+int phNxpNciHal_cfgdiff_add(const uint8_t* p_cmd, uint16_t cmd_len) {
+  int iBlock = gCfgDiff.blocks.size();
+
+  gCfgDiff.blocks.emplace_back();
+  phNxpNciHal_CfgDiffBlk_t& blk = gCfgDiff.blocks.back();
+  blk.p_cmd = p_cmd;
+  blk.cmd_len = cmd_len;
+  blk.p_send = p_cmd;
+  blk.send_len = cmd_len;
+  blk.state = CFGDIFF_BLK_PENDING;
+  if (!phNxpNciHal_cfgdiff_parse(p_cmd, cmd_len, &blk.tlvs)) {
+    NXPLOG_NCIHAL_E("%s block %d is not a valid CORE_SET_CONFIG", __func__,
+                    iBlock);
+    gCfgDiff.bOpaque = true;
+    return iBlock;
+  }
+  for (const phNxpNciHal_CfgDiffTlv_t& tlv : blk.tlvs) {
+    phNxpNciHal_CfgDiffTag_t& tag = gCfgDiff.tags[std::string(
+        (const char*)p_cmd + tlv.offset, tlv.tagLen)];
+    tag.value.append((const char*)p_cmd + tlv.offset + tlv.tagLen,
+                     tlv.len - tlv.tagLen);
+    if (tag.blocks.empty() || tag.blocks.back() != iBlock) {
+      tag.blocks.push_back(iBlock);
+    }
+  }
+  return iBlock;
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_prepare
+**
+** Description      Compare the values set by the registered blocks with the
+**                  applied ones, drop the applied values of the changed tags
+**                  from the state file before any block is sent and build
+**                  the reduced commands
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_cfgdiff_prepare(void) {
+  size_t nbChanged = 0;
+
+  if (gCfgDiff.bOpaque) {
+    /* the parameters set are unknown, nothing can be trusted any more */
+    {
+      std::lock_guard<std::mutex> lock(sCfgDiffLock);
+      gCfgDiff.applied.clear();
+      gCfgDiff.bDirty = true;
+    }
+    phNxpNciHal_cfgdiff_flush();
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(sCfgDiffLock);
+    for (auto& entry : gCfgDiff.tags) {
+      auto it = gCfgDiff.applied.find(entry.first);
+      entry.second.bChanged = gCfgDiff.bFull ||
+                              it == gCfgDiff.applied.end() ||
+                              it->second != entry.second.value;
+      if (entry.second.bChanged) {
+        nbChanged++;
+        if (it != gCfgDiff.applied.end()) {
+          gCfgDiff.applied.erase(it);
+          gCfgDiff.bDirty = true;
+        }
+      }
+    }
+  }
+  phNxpNciHal_cfgdiff_flush();
+
+  for (phNxpNciHal_CfgDiffBlk_t& blk : gCfgDiff.blocks) {
+    blk.reduced.assign(blk.p_cmd, blk.p_cmd + CFGDIFF_HDR_LEN);
+    blk.reduced[3] = 0;
+    for (const phNxpNciHal_CfgDiffTlv_t& tlv : blk.tlvs) {
+      const std::string tag((const char*)blk.p_cmd + tlv.offset, tlv.tagLen);
+      if (gCfgDiff.tags[tag].bChanged) {
+        blk.reduced.insert(blk.reduced.end(), blk.p_cmd + tlv.offset,
+                           blk.p_cmd + tlv.offset + tlv.len);
+        blk.reduced[3]++;
+      }
+    }
+    blk.reduced[2] = blk.reduced.size() - 3;
+    if (blk.reduced[3] == 0) {
+      blk.p_send = NULL;
+      blk.send_len = 0;
+      blk.state = CFGDIFF_BLK_DONE;
+    } else if (blk.reduced.size() < blk.cmd_len) {
+      blk.p_send = blk.reduced.data();
+      blk.send_len = blk.reduced.size();
+    }
+  }
+  NXPLOG_NCIHAL_D("%s %zu of %zu parameters to set", __func__, nbChanged,
+                  gCfgDiff.tags.size());
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_cmd
+**
+** Description      Get the command to send for a registered block
+**
+** Returns          Command, NULL if the block sets nothing new
+**
+*******************************************************************************/
+const uint8_t* phNxpNciHal_cfgdiff_cmd(int iBlock, uint16_t* p_len) {
+  if (iBlock < 0 || iBlock >= (int)gCfgDiff.blocks.size()) return NULL;
+
+  *p_len = gCfgDiff.blocks[iBlock].send_len;
+  return gCfgDiff.blocks[iBlock].p_send;
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_applied
+**
+** Description      Report the result of the command of a registered block
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_cfgdiff_applied(int iBlock, bool bSuccess) {
+  if (iBlock < 0 || iBlock >= (int)gCfgDiff.blocks.size()) return;
+
+  if (gCfgDiff.blocks[iBlock].p_send != NULL) {
+    gCfgDiff.blocks[iBlock].state =
+        bSuccess ? CFGDIFF_BLK_DONE : CFGDIFF_BLK_FAILED;
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_end
+**
+** Description      End the session: record the values of the changed tags
+**                  whose blocks have all been acknowledged and release the
+**                  config. Does nothing if no session is active.
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_cfgdiff_end(void) {
+  if (!gCfgDiff.bActive) return;
+  gCfgDiff.bActive = false;
+  if (!gCfgDiff.bOpaque) {
+    std::lock_guard<std::mutex> lock(sCfgDiffLock);
+    for (const auto& entry : gCfgDiff.tags) {
+      if (!entry.second.bChanged) continue;
+      bool bDone = true;
+      for (int iBlock : entry.second.blocks) {
+        bDone &= (gCfgDiff.blocks[iBlock].state == CFGDIFF_BLK_DONE);
+      }
+      if (bDone) {
+        gCfgDiff.applied[entry.first] = entry.second.value;
+        gCfgDiff.bDirty = true;
+      }
+    }
+  }
+  phNxpNciHal_cfgdiff_flush();
+  gCfgDiff.blocks.clear();
+  gCfgDiff.tags.clear();
+  releaseNxpConfig();
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_written
+**
+** Description      Drop the applied values of the tags set by a
+**                  CORE_SET_CONFIG_CMD about to be sent to the NFCC. Called
+**                  on the NCI write path: the state file is only updated by
+**                  the next phNxpNciHal_cfgdiff_flush().
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_cfgdiff_written(const uint8_t* p_cmd, uint16_t cmd_len) {
+  std::vector<phNxpNciHal_CfgDiffTlv_t> tlvs;
+  std::lock_guard<std::mutex> lock(sCfgDiffLock);
+
+  phNxpNciHal_cfgdiff_load();
+  if (gCfgDiff.applied.empty()) return;
+  if (!phNxpNciHal_cfgdiff_parse(p_cmd, cmd_len, &tlvs)) {
+    gCfgDiff.applied.clear();
+    gCfgDiff.bDirty = true;
+  }
+  for (const phNxpNciHal_CfgDiffTlv_t& tlv : tlvs) {
+    if (gCfgDiff.applied.erase(
+            std::string((const char*)p_cmd + tlv.offset, tlv.tagLen)) > 0) {
+      gCfgDiff.bDirty = true;
+    }
+  }
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_cfgdiff_reset
+**
+** Description      Forget all the applied values, e.g. when the NFCC
+**                  configuration may have been reset. Like
+**                  phNxpNciHal_cfgdiff_written(), leaves the state file to
+**                  the next phNxpNciHal_cfgdiff_flush().
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_cfgdiff_reset(void) {
+  std::lock_guard<std::mutex> lock(sCfgDiffLock);
+
+  phNxpNciHal_cfgdiff_load();
+  if (gCfgDiff.applied.empty()) return;
+  gCfgDiff.applied.clear();
+  gCfgDiff.bDirty = true;
+}
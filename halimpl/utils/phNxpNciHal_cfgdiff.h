@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Differential application of CORE_SET_CONFIG blocks
+ *
+ * The values last applied to the NFCC are kept per parameter tag in
+ * /data/vendor/nfc/libnfc-nxpAppliedConfig.bin. A session registers the
+ * blocks to apply, in their application order, and gets back for each of
+ * them a CORE_SET_CONFIG command reduced to the parameters whose value
+ * differs from the applied one. A tag set several times by the blocks (e.g.
+ * register writes through A0 0D) is compared and sent as a whole.
+ *
+ * The applied values of the changed parameters are dropped from the file
+ * before any of them is sent and recorded again only once all their blocks
+ * are acknowledged, so an interrupted session never leaves a stale value.
+ * Any other CORE_SET_CONFIG sent to the NFCC drops the applied values of
+ * the parameters it sets. Those are only dropped in memory on the NCI write
+ * path, phNxpNciHal_cfgdiff_flush() writes them to the file once the
+ * command is answered.
+ */
+#ifndef _PHNXPNCIHAL_CFGDIFF_H_
+#define _PHNXPNCIHAL_CFGDIFF_H_
+
+#include <stdint.h>
+
+/* Function declarations */
+void phNxpNciHal_cfgdiff_begin(uint32_t dwFwVersion, bool bFull);
+int phNxpNciHal_cfgdiff_add(const uint8_t* p_cmd, uint16_t cmd_len);
+void phNxpNciHal_cfgdiff_prepare(void);
+const uint8_t* phNxpNciHal_cfgdiff_cmd(int iBlock, uint16_t* p_len);
+void phNxpNciHal_cfgdiff_applied(int iBlock, bool bSuccess);
+void phNxpNciHal_cfgdiff_end(void);
+void phNxpNciHal_cfgdiff_written(const uint8_t* p_cmd, uint16_t cmd_len);
+void phNxpNciHal_cfgdiff_reset(void);
+void phNxpNciHal_cfgdiff_flush(void);
+
+#endif /* _PHNXPNCIHAL_CFGDIFF_H_ */
@@ -0,0 +1,479 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <time.h>
+#include <string.h>
+#include <atomic>
+
+#include <phNxpLog.h>
+#include <phNxpNciHal_latency.h>
+
+/* NCI packet header */
+#define LAT_NCI_MT_MASK 0xE0
+#define LAT_NCI_MT_CMD 0x20
+#define LAT_NCI_MT_RSP 0x40
+#define LAT_NCI_GID_MASK 0x0F
+#define LAT_NCI_OID_MASK 0x3F
+
+/* Intervals between consecutive points plus the complete round trip */
+#define LAT_NB_SEGMENTS PH_NXPNCIHAL_LAT_NB_POINTS
+#define LAT_SEG_ROUND_TRIP (LAT_NB_SEGMENTS - 1)
+/* Histogram tracking at most LAT_MAX_KEYS different GID/OID */
+#define LAT_MAX_KEYS 32
+/* 4 sub-buckets per power of two, values above 2^24 us are clamped */
+#define LAT_SUB_BUCKET_BITS 2
+#define LAT_SUB_BUCKETS (1 << LAT_SUB_BUCKET_BITS)
+#define LAT_MAX_VALUE_BITS 24
+#define LAT_NB_BUCKETS \
+  ((LAT_MAX_VALUE_BITS - LAT_SUB_BUCKET_BITS + 1) * LAT_SUB_BUCKETS)
+/* ioctl response: status, header, count, then p50/p90/p99/max per segment */
+#define LAT_RSP_STATS_LEN (1 + 2 + 4 + (LAT_NB_SEGMENTS * 4 * 4))
+#define LAT_RSP_ENTRY_LEN (2 + 4)
+
+typedef struct phNxpNciHal_LatHisto {
+  std::atomic<uint16_t> wKey; /* 0 - free entry */
+  std::atomic<uint32_t> dwCount;
+  std::atomic<uint32_t> aMax[LAT_NB_SEGMENTS];
+  std::atomic<uint32_t> aBucket[LAT_NB_SEGMENTS][LAT_NB_BUCKETS];
+} phNxpNciHal_LatHisto_t;
+
+/* Time stamps of the outstanding NCI command */
+typedef struct phNxpNciHal_LatPending {
+  std::atomic<uint16_t> wKey; /* 0 - no command outstanding */
+  std::atomic<uint64_t> aTs[PH_NXPNCIHAL_LAT_NB_POINTS];
+} phNxpNciHal_LatPending_t;
+
+static phNxpNciHal_LatHisto_t gLatHisto[LAT_MAX_KEYS];
+static phNxpNciHal_LatPending_t gLatPending;
+static std::atomic<uint32_t> gLatDropCount;
+/* Last dequeue time, only used from the HAL client thread */
+static uint64_t gLatDequeueUs;
+
+static const char* gLatSegName[LAT_NB_SEGMENTS] = {"hal-tx", "nfcc", "queue",
+                                                   "hal-rx", "total"};
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_now
+**
+** Description      Monotonic time in microseconds
+**
+*******************************************************************************/
+static uint64_t phNxpNciHal_latency_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_key
+**
+** Description      Histogram key of an NCI packet, 0 if it is not a command or
+**                  response (expected type bMt)
+**
+*******************************************************************************/
+static uint16_t phNxpNciHal_latency_key(const uint8_t* pPacket,
+                                        uint16_t wLength, uint8_t bMt) {
+  if ((NULL == pPacket) || (wLength < 2) ||
+      ((pPacket[0] & LAT_NCI_MT_MASK) != bMt)) {
+    return 0;
+  }
+  return (uint16_t)(0x8000 | ((pPacket[0] & LAT_NCI_GID_MASK) << 8) |
+                    (pPacket[1] & LAT_NCI_OID_MASK));
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_bucket
+**
+** Description      Log-linear bucket of a value in microseconds
+**
+*******************************************************************************/
+static uint32_t phNxpNciHal_latency_bucket(uint32_t dwValue) {
+  uint32_t dwExp;
+
+  if (dwValue < LAT_SUB_BUCKETS) {
+    return dwValue;
+  }
+  if (dwValue >= (1U << LAT_MAX_VALUE_BITS)) {
+    return LAT_NB_BUCKETS - 1;
+  }
+  dwExp = 31 - __builtin_clz(dwValue);
+  return ((dwExp - LAT_SUB_BUCKET_BITS + 1) << LAT_SUB_BUCKET_BITS) |
+         ((dwValue >> (dwExp - LAT_SUB_BUCKET_BITS)) & (LAT_SUB_BUCKETS - 1));
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_bucket_high
+**
+** Description      Highest value in microseconds accounted in a bucket
+**
+*******************************************************************************/
+static uint32_t phNxpNciHal_latency_bucket_high(uint32_t dwBucket) {
+  uint32_t dwExp;
+  uint32_t dwSub;
+
+  dwBucket++;
+  if (dwBucket >= LAT_NB_BUCKETS) {
+    return UINT32_MAX;
+  }
+  if (dwBucket < LAT_SUB_BUCKETS) {
+    return dwBucket - 1;
+  }
+  dwExp = (dwBucket >> LAT_SUB_BUCKET_BITS) + LAT_SUB_BUCKET_BITS - 1;
+  dwSub = dwBucket & (LAT_SUB_BUCKETS - 1);
+  return ((LAT_SUB_BUCKETS | dwSub) << (dwExp - LAT_SUB_BUCKET_BITS)) - 1;
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_find
+**
+** Description      Finds the histogram of a GID/OID, allocates it if bCreate
+**
+** Returns          histogram, NULL if not found or table is full
+**
+*******************************************************************************/
+static phNxpNciHal_LatHisto_t* phNxpNciHal_latency_find(uint16_t wKey,
+                                                        bool bCreate) {
+  uint32_t dwIdx = (wKey ^ (wKey >> 5)) % LAT_MAX_KEYS;
+  uint32_t i;
+
+  for (i = 0; i < LAT_MAX_KEYS; i++) {
+    phNxpNciHal_LatHisto_t* pHisto = &gLatHisto[(dwIdx + i) % LAT_MAX_KEYS];
+    uint16_t wCurrKey = pHisto->wKey.load(std::memory_order_acquire);
+    if (wCurrKey == wKey) {
+      return pHisto;
+    }
+    if (wCurrKey == 0) {
+      if (!bCreate) {
+        return NULL;
+      }
+      if (pHisto->wKey.compare_exchange_strong(wCurrKey, wKey) ||
+          (wCurrKey == wKey)) {
+        return pHisto;
+      }
+    }
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_record
+**
+** Description      Accounts the intervals of a completed command
+**
+*******************************************************************************/
+static void phNxpNciHal_latency_record(uint16_t wKey, const uint64_t* pTs) {
+  phNxpNciHal_LatHisto_t* pHisto = phNxpNciHal_latency_find(wKey, true);
+  uint64_t qwValue;
+  uint32_t dwValue;
+  uint32_t dwMax;
+  int i;
+
+  if (NULL == pHisto) {
+    gLatDropCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  for (i = 0; i < LAT_NB_SEGMENTS; i++) {
+    const uint64_t qwStart = (i == LAT_SEG_ROUND_TRIP) ? pTs[0] : pTs[i];
+    const uint64_t qwEnd = pTs[(i == LAT_SEG_ROUND_TRIP) ? i : i + 1];
+    /* Not every command reaches all points, e.g. when answered by the HAL */
+    if ((0 == qwStart) || (0 == qwEnd)) {
+      continue;
+    }
+    /* Sim transport may queue the response before the write returns */
+    qwValue = (qwEnd > qwStart) ? (qwEnd - qwStart) : 0;
+    dwValue = (qwValue > UINT32_MAX) ? UINT32_MAX : (uint32_t)qwValue;
+    pHisto->aBucket[i][phNxpNciHal_latency_bucket(dwValue)].fetch_add(
+        1, std::memory_order_relaxed);
+    dwMax = pHisto->aMax[i].load(std::memory_order_relaxed);
+    while ((dwValue > dwMax) &&
+           !pHisto->aMax[i].compare_exchange_weak(dwMax, dwValue)) {
+    }
+  }
+  pHisto->dwCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_mark
+**
+** Description      Time stamps a point reached by the outstanding command,
+**                  pPacket is the command for PH_NXPNCIHAL_LAT_HAL_WRITE and
+**                  PH_NXPNCIHAL_LAT_TML_WRITE and the response otherwise.
+**                  Packets other than NCI commands/responses are ignored, so
+**                  is any response not matching the outstanding command.
+**
+** Parameters       ePoint  - time stamping point
+**                  pPacket - NCI packet
+**                  wLength - packet length
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_latency_mark(phNxpNciHal_LatPoint_t ePoint,
+                              const uint8_t* pPacket, uint16_t wLength) {
+  uint64_t aTs[PH_NXPNCIHAL_LAT_NB_POINTS];
+  uint16_t wKey;
+  int i;
+
+  if (ePoint <= PH_NXPNCIHAL_LAT_TML_WRITE) {
+    wKey = phNxpNciHal_latency_key(pPacket, wLength, LAT_NCI_MT_CMD);
+  } else {
+    wKey = phNxpNciHal_latency_key(pPacket, wLength, LAT_NCI_MT_RSP);
+  }
+  if (0 == wKey) {
+    return;
+  }
+
+  if (PH_NXPNCIHAL_LAT_HAL_WRITE == ePoint) {
+    /* A new command, any previous one is left unaccounted */
+    gLatPending.wKey.store(0, std::memory_order_relaxed);
+    for (i = 1; i < PH_NXPNCIHAL_LAT_NB_POINTS; i++) {
+      gLatPending.aTs[i].store(0, std::memory_order_relaxed);
+    }
+    gLatPending.aTs[0].store(phNxpNciHal_latency_now(),
+                             std::memory_order_relaxed);
+    gLatPending.wKey.store(wKey, std::memory_order_release);
+    return;
+  }
+  if (gLatPending.wKey.load(std::memory_order_acquire) != wKey) {
+    return;
+  }
+  /* Latest packet wins, earlier ones may be HAL internal commands */
+  if (PH_NXPNCIHAL_LAT_DEQUEUE == ePoint) {
+    gLatPending.aTs[ePoint].store(
+        gLatDequeueUs ? gLatDequeueUs : phNxpNciHal_latency_now(),
+        std::memory_order_relaxed);
+    return;
+  } else if (PH_NXPNCIHAL_LAT_STACK_CB != ePoint) {
+    gLatPending.aTs[ePoint].store(phNxpNciHal_latency_now(),
+                                  std::memory_order_relaxed);
+    return;
+  }
+
+  aTs[PH_NXPNCIHAL_LAT_STACK_CB] = phNxpNciHal_latency_now();
+  if (!gLatPending.wKey.compare_exchange_strong(wKey, 0)) {
+    return;
+  }
+  for (i = 0; i < PH_NXPNCIHAL_LAT_STACK_CB; i++) {
+    aTs[i] = gLatPending.aTs[i].load(std::memory_order_relaxed);
+  }
+  phNxpNciHal_latency_record(wKey, aTs);
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_dequeued
+**
+** Description      Time stamps a message dequeued by the HAL client thread,
+**                  used for PH_NXPNCIHAL_LAT_DEQUEUE by the read callback.
+**                  Shall only be called from the HAL client thread.
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_latency_dequeued(void) {
+  gLatDequeueUs = phNxpNciHal_latency_now();
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_reset
+**
+** Description      Clears all latency histograms
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_latency_reset(void) {
+  int i, j, k;
+
+  for (i = 0; i < LAT_MAX_KEYS; i++) {
+    gLatHisto[i].dwCount.store(0, std::memory_order_relaxed);
+    for (j = 0; j < LAT_NB_SEGMENTS; j++) {
+      gLatHisto[i].aMax[j].store(0, std::memory_order_relaxed);
+      for (k = 0; k < LAT_NB_BUCKETS; k++) {
+        gLatHisto[i].aBucket[j][k].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+  gLatDropCount.store(0, std::memory_order_relaxed);
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_percentiles
+**
+** Description      Computes p50/p90/p99/max of a histogram segment
+**
+** Returns          number of samples in the segment
+**
+*******************************************************************************/
+static uint32_t phNxpNciHal_latency_percentiles(phNxpNciHal_LatHisto_t* pHisto,
+                                                int nSeg, uint32_t* pValues) {
+  static const uint32_t aPercent[] = {50, 90, 99};
+  uint32_t aCount[LAT_NB_BUCKETS];
+  uint64_t qwTotal = 0;
+  uint64_t qwCumul = 0;
+  uint32_t i, p = 0;
+
+  for (i = 0; i < LAT_NB_BUCKETS; i++) {
+    aCount[i] = pHisto->aBucket[nSeg][i].load(std::memory_order_relaxed);
+    qwTotal += aCount[i];
+  }
+  memset(pValues, 0, 4 * sizeof(uint32_t));
+  for (i = 0; (i < LAT_NB_BUCKETS) && (qwTotal > 0) && (p < 3); i++) {
+    qwCumul += aCount[i];
+    while ((p < 3) && (qwCumul * 100 >= qwTotal * aPercent[p])) {
+      pValues[p++] = phNxpNciHal_latency_bucket_high(i);
+    }
+  }
+  pValues[3] = pHisto->aMax[nSeg].load(std::memory_order_relaxed);
+  /* Bucket bound may exceed the highest value seen */
+  for (p = 0; p < 3; p++) {
+    if (pValues[p] > pValues[3]) {
+      pValues[p] = pValues[3];
+    }
+  }
+  return (qwTotal > UINT32_MAX) ? UINT32_MAX : (uint32_t)qwTotal;
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_dump
+**
+** Description      Logs percentiles of all latency histograms
+**
+** Returns          None
+**
+*******************************************************************************/
+void phNxpNciHal_latency_dump(void) {
+  uint32_t aValues[4];
+  uint32_t dwCount;
+  uint16_t wKey;
+  int i, j;
+
+  for (i = 0; i < LAT_MAX_KEYS; i++) {
+    wKey = gLatHisto[i].wKey.load(std::memory_order_acquire);
+    if (0 == wKey) {
+      continue;
+    }
+    for (j = 0; j < LAT_NB_SEGMENTS; j++) {
+      dwCount = phNxpNciHal_latency_percentiles(&gLatHisto[i], j, aValues);
+      NXPLOG_NCIHAL_D(
+          "latency %02X%02X %-6s n=%u p50=%u p90=%u p99=%u max=%u us",
+          LAT_NCI_MT_CMD | ((wKey >> 8) & LAT_NCI_GID_MASK), wKey & 0xFF,
+          gLatSegName[j], dwCount, aValues[0], aValues[1], aValues[2],
+          aValues[3]);
+    }
+  }
+  NXPLOG_NCIHAL_D("latency commands not accounted (table full) : %u",
+                  gLatDropCount.load(std::memory_order_relaxed));
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_put32
+**
+** Description      Little endian serialization
+**
+*******************************************************************************/
+static uint8_t* phNxpNciHal_latency_put32(uint8_t* pBuff, uint32_t dwValue) {
+  *pBuff++ = (uint8_t)dwValue;
+  *pBuff++ = (uint8_t)(dwValue >> 8);
+  *pBuff++ = (uint8_t)(dwValue >> 16);
+  *pBuff++ = (uint8_t)(dwValue >> 24);
+  return pBuff;
+}
+
+/*******************************************************************************
+**
+** Function         phNxpNciHal_latency_get
+**
+** Description      Serves HAL_NFC_IOCTL_GET_LATENCY_STATS. Multi-byte values
+**                  are little endian, times in microseconds.
+**                  wCmdLen 0: histograms are logged, pRsp is
+**                    status, nb, {hdr0, hdr1, count} * nb
+**                  wCmdLen 1: histograms are cleared, pRsp is status
+**                  wCmdLen 2: pCmd is a command header, pRsp is
+**                    status, hdr0, hdr1, count,
+**                    {p50, p90, p99, max} * (hal-tx, nfcc, queue, hal-rx,
+**                    total)
+**                  status is 0x00 on success, 0x01 for an unknown command
+**
+** Parameters       pCmd     - ioctl input
+**                  wCmdLen  - ioctl input length
+**                  pRsp     - ioctl output
+**                  pRspLen  - in: size of pRsp, out: length of ioctl output
+**
+** Returns          0 on success, -1 if pRsp is too small
+**
+*******************************************************************************/
+int phNxpNciHal_latency_get(const uint8_t* pCmd, uint16_t wCmdLen,
+                            uint8_t* pRsp, uint16_t* pRspLen) {
+  phNxpNciHal_LatHisto_t* pHisto;
+  uint32_t aValues[4];
+  uint8_t* pOut = pRsp;
+  uint16_t wKey;
+  uint8_t bNb = 0;
+  int i, j;
+
+  if (*pRspLen < LAT_RSP_STATS_LEN) {
+    return -1;
+  }
+  *pOut++ = 0x00;
+  if (wCmdLen == 0) {
+    phNxpNciHal_latency_dump();
+    pOut++;
+    for (i = 0; i < LAT_MAX_KEYS; i++) {
+      wKey = gLatHisto[i].wKey.load(std::memory_order_acquire);
+      if ((0 == wKey) || ((pOut - pRsp) + LAT_RSP_ENTRY_LEN > *pRspLen)) {
+        continue;
+      }
+      *pOut++ = LAT_NCI_MT_CMD | ((wKey >> 8) & LAT_NCI_GID_MASK);
+      *pOut++ = (uint8_t)wKey;
+      pOut = phNxpNciHal_latency_put32(
+          pOut, gLatHisto[i].dwCount.load(std::memory_order_relaxed));
+      bNb++;
+    }
+    pRsp[1] = bNb;
+  } else if (wCmdLen == 1) {
+    phNxpNciHal_latency_reset();
+  } else {
+    wKey = phNxpNciHal_latency_key(pCmd, wCmdLen, LAT_NCI_MT_CMD);
+    pHisto = (0 == wKey) ? NULL : phNxpNciHal_latency_find(wKey, false);
+    if (NULL == pHisto) {
+      pRsp[0] = 0x01;
+    } else {
+      *pOut++ = pCmd[0];
+      *pOut++ = pCmd[1];
+      pOut = phNxpNciHal_latency_put32(
+          pOut, pHisto->dwCount.load(std::memory_order_relaxed));
+      for (i = 0; i < LAT_NB_SEGMENTS; i++) {
+        phNxpNciHal_latency_percentiles(pHisto, i, aValues);
+        for (j = 0; j < 4; j++) {
+          pOut = phNxpNciHal_latency_put32(pOut, aValues[j]);
+        }
+      }
+    }
+  }
+  *pRspLen = (uint16_t)(pOut - pRsp);
+  return 0;
+}
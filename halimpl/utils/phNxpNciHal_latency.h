@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * NCI command round-trip latency statistics
+ *
+ * The outstanding NCI command is time stamped when it enters the HAL, when
+ * the TML transport write returns, when the TML transport read of its
+ * response returns, when the client thread dequeues the response and when
+ * the stack callback returns. Intervals are accumulated per GID/OID into
+ * log-linear histograms (4 sub-buckets per power of two, microseconds) which
+ * can be updated concurrently without locking.
+ */
+#ifndef _PHNXPNCIHAL_LATENCY_H_
+#define _PHNXPNCIHAL_LATENCY_H_
+
+#include <stdint.h>
+
+/* Time stamping points, in the order they are reached by a command */
+typedef enum phNxpNciHal_LatPoint {
+  PH_NXPNCIHAL_LAT_HAL_WRITE = 0, /* phNxpNciHal_write entry */
+  PH_NXPNCIHAL_LAT_TML_WRITE,     /* TML transport write returned */
+  PH_NXPNCIHAL_LAT_TML_READ,      /* TML transport read of the RSP returned */
+  PH_NXPNCIHAL_LAT_DEQUEUE,       /* RSP dequeued by the HAL client thread */
+  PH_NXPNCIHAL_LAT_STACK_CB,      /* stack data callback returned */
+  PH_NXPNCIHAL_LAT_NB_POINTS
+} phNxpNciHal_LatPoint_t;
+
+/* Function declarations */
+void phNxpNciHal_latency_mark(phNxpNciHal_LatPoint_t ePoint,
+                              const uint8_t* pPacket, uint16_t wLength);
+void phNxpNciHal_latency_dequeued(void);
+void phNxpNciHal_latency_reset(void);
+void phNxpNciHal_latency_dump(void);
+int phNxpNciHal_latency_get(const uint8_t* pCmd, uint16_t wCmdLen,
+                            uint8_t* pRsp, uint16_t* pRspLen);
+
+#endif /* _PHNXPNCIHAL_LATENCY_H_ */
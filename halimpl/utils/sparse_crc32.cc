@@ -44,6 +44,16 @@
 
 /* Code taken from FreeBSD 8 */
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 static uint32_t crc32_tab[] = {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -90,6 +100,196 @@ static uint32_t crc32_tab[] = {
     0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d};
 
+/*
+ * Slice-by-8: crc32_slice_tab[k][b] is the CRC of byte b followed by k zero
+ * bytes, so 8 input bytes are folded with 8 independent table lookups.
+ * Derived from crc32_tab on first use.
+ */
+typedef struct {
+  uint32_t tab[8][256];
+} crc32_slice_tab_t;
+
+static const crc32_slice_tab_t* crc32_slice_tab(void) {
+  static const crc32_slice_tab_t* p_tab = [] {
+    static crc32_slice_tab_t slice_tab;
+    for (int b = 0; b < 256; b++) {
+      uint32_t crc = crc32_tab[b];
+      slice_tab.tab[0][b] = crc;
+      for (int k = 1; k < 8; k++) {
+        crc = crc32_tab[crc & 0xFF] ^ (crc >> 8);
+        slice_tab.tab[k][b] = crc;
+      }
+    }
+    return &slice_tab;
+  }();
+  return p_tab;
+}
+
+static uint32_t crc32_bytes(uint32_t crc, const uint8_t* p, size_t size) {
+  while (size--) crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t* p, size_t size) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  const crc32_slice_tab_t* t = crc32_slice_tab();
+  uint32_t lo, hi;
+
+  while (size >= 8) {
+    memcpy(&lo, p, sizeof(lo));
+    memcpy(&hi, p + 4, sizeof(hi));
+    lo ^= crc;
+    crc = t->tab[7][lo & 0xFF] ^ t->tab[6][(lo >> 8) & 0xFF] ^
+          t->tab[5][(lo >> 16) & 0xFF] ^ t->tab[4][lo >> 24] ^
+          t->tab[3][hi & 0xFF] ^ t->tab[2][(hi >> 8) & 0xFF] ^
+          t->tab[1][(hi >> 16) & 0xFF] ^ t->tab[0][hi >> 24];
+    p += 8;
+    size -= 8;
+  }
+#endif
+  return crc32_bytes(crc, p, size);
+}
+
+#if defined(__aarch64__)
+/*
+ * ARMv8 CRC32 instructions use this same (reflected 0x04C11DB7) polynomial.
+ */
+#if defined(__clang__)
+#define CRC32_TARGET __attribute__((target("crc")))
+#define CRC32_X(crc, v) __builtin_arm_crc32d(crc, v)
+#define CRC32_B(crc, v) __builtin_arm_crc32b(crc, v)
+#else
+#define CRC32_TARGET __attribute__((target("+crc")))
+#define CRC32_X(crc, v) __builtin_aarch64_crc32x(crc, v)
+#define CRC32_B(crc, v) __builtin_aarch64_crc32b(crc, v)
+#endif
+
+CRC32_TARGET static uint32_t crc32_armv8(uint32_t crc, const uint8_t* p,
+                                         size_t size) {
+  uint64_t v;
+
+  while (size >= 8) {
+    memcpy(&v, p, sizeof(v));
+    crc = CRC32_X(crc, v);
+    p += 8;
+    size -= 8;
+  }
+  while (size--) crc = CRC32_B(crc, *p++);
+  return crc;
+}
+#elif defined(__x86_64__) || defined(__i386__)
+/*
+ * The x86 SSE4.2 crc32 instruction uses the Castagnoli polynomial, not this
+ * one. Carry-less multiplication (PCLMULQDQ) folds 64 bytes at a time
+ * instead, then reduces to 32 bits (Barrett), as described in Intel's "Fast
+ * CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction". The
+ * constants are the x^n mod P folding factors of the reflected polynomial.
+ */
+#define CRC32_CLMUL_MIN 64
+
+__attribute__((target("pclmul,sse4.1"))) static uint32_t crc32_clmul(
+    uint32_t crc, const uint8_t* p, size_t size) {
+  alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+  alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+  alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+  alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+  if (size < CRC32_CLMUL_MIN) return crc32_slice8(crc, p, size);
+
+  x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+  x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+  x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+  x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  x0 = _mm_load_si128((const __m128i*)k1k2);
+  p += 64;
+  size -= 64;
+
+  /* fold 4 x 128 bits in parallel */
+  while (size >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128((const __m128i*)(p + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                       _mm_loadu_si128((const __m128i*)(p + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                       _mm_loadu_si128((const __m128i*)(p + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                       _mm_loadu_si128((const __m128i*)(p + 0x30)));
+    p += 64;
+    size -= 64;
+  }
+
+  /* fold into 128 bits, then the remaining 16 byte blocks */
+  x0 = _mm_load_si128((const __m128i*)k3k4);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+  while (size >= 16) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128((const __m128i*)p));
+    p += 16;
+    size -= 16;
+  }
+
+  /* fold 128 bits to 64 bits */
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  /* Barrett reduction to 32 bits */
+  x0 = _mm_load_si128((const __m128i*)poly);
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  crc = (uint32_t)_mm_extract_epi32(x1, 1);
+
+  return crc32_slice8(crc, p, size);
+}
+#endif
+
+typedef uint32_t (*crc32_update_t)(uint32_t crc, const uint8_t* p,
+                                   size_t size);
+
+/* Fastest implementation available on the running CPU, chosen once */
+static crc32_update_t crc32_update(void) {
+  static const crc32_update_t p_update = [] {
+#if defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32) return &crc32_armv8;
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+      return &crc32_clmul;
+    }
+#endif
+    return &crc32_slice8;
+  }();
+  return p_update;
+}
+
 /*
  * A function that calculates the CRC-32 based on the table above is
  * given below for documentation purposes. An equivalent implementation
@@ -102,6 +302,6 @@ uint32_t sparse_crc32(uint32_t crc_in, const void* buf, size_t size) {
   uint32_t crc;
 
   crc = crc_in ^ ~0U;
-  while (size--) crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  crc = crc32_update()(crc, p, size);
   return crc ^ ~0U;
 }
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of the sparse_crc32 implementations, over the sizes of the
+ * config files and config cache it checksums
+ */
+#include "../sparse_crc32.cc"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+static void run(benchmark::State& state, crc32_update_t update) {
+  std::vector<uint8_t> buf(state.range(0), 0x5A);
+  uint32_t crc = 0;
+
+  for (auto _ : state) {
+    crc = update(crc, buf.data(), buf.size());
+    benchmark::DoNotOptimize(crc);
+  }
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+
+static void BM_Crc32Bytes(benchmark::State& state) {
+  run(state, &crc32_bytes);
+}
+BENCHMARK(BM_Crc32Bytes)->Arg(64)->Arg(4096)->Arg(64 * 1024);
+
+static void BM_Crc32Slice8(benchmark::State& state) {
+  run(state, &crc32_slice8);
+}
+BENCHMARK(BM_Crc32Slice8)->Arg(64)->Arg(4096)->Arg(64 * 1024);
+
+#if defined(__aarch64__)
+static void BM_Crc32Armv8(benchmark::State& state) {
+  if (!(getauxval(AT_HWCAP) & HWCAP_CRC32)) {
+    state.SkipWithError("CRC32 instructions not supported");
+    return;
+  }
+  run(state, &crc32_armv8);
+}
+BENCHMARK(BM_Crc32Armv8)->Arg(64)->Arg(4096)->Arg(64 * 1024);
+#elif defined(__x86_64__) || defined(__i386__)
+static void BM_Crc32Clmul(benchmark::State& state) {
+  if (!__builtin_cpu_supports("pclmul") || !__builtin_cpu_supports("sse4.1")) {
+    state.SkipWithError("PCLMULQDQ instructions not supported");
+    return;
+  }
+  run(state, &crc32_clmul);
+}
+BENCHMARK(BM_Crc32Clmul)->Arg(64)->Arg(4096)->Arg(64 * 1024);
+#endif
+
+static void BM_SparseCrc32(benchmark::State& state) {
+  std::vector<uint8_t> buf(state.range(0), 0x5A);
+  uint32_t crc = 0;
+
+  for (auto _ : state) {
+    crc = sparse_crc32(crc, buf.data(), buf.size());
+    benchmark::DoNotOptimize(crc);
+  }
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(BM_SparseCrc32)->Arg(64)->Arg(4096)->Arg(64 * 1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks every sparse_crc32 implementation against a bit-wise reference,
+ * across lengths, alignments and chained calls. The source is included so
+ * that the implementations not selected on the running CPU are tested too.
+ */
+#include "../sparse_crc32.cc"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+/* Bit-wise CRC-32 (reflected 0x04C11DB7), with sparse_crc32 conventions */
+uint32_t crc32_reference(uint32_t crc_in, const uint8_t* p, size_t size) {
+  uint32_t crc = crc_in ^ ~0U;
+  while (size--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+  }
+  return crc ^ ~0U;
+}
+
+/* Runs an implementation with the pre and post inversion of sparse_crc32 */
+uint32_t crc32_with(crc32_update_t update, uint32_t crc_in, const uint8_t* p,
+                    size_t size) {
+  return update(crc_in ^ ~0U, p, size) ^ ~0U;
+}
+
+std::vector<uint8_t> random_buffer(size_t size, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::vector<uint8_t> buf(size);
+  for (auto& b : buf) b = gen();
+  return buf;
+}
+
+std::vector<crc32_update_t> implementations() {
+  std::vector<crc32_update_t> impls = {&crc32_bytes, &crc32_slice8};
+#if defined(__aarch64__)
+  if (getauxval(AT_HWCAP) & HWCAP_CRC32) impls.push_back(&crc32_armv8);
+#elif defined(__x86_64__) || defined(__i386__)
+  if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+    impls.push_back(&crc32_clmul);
+  }
+#endif
+  return impls;
+}
+
+}  // namespace
+
+TEST(SparseCrc32Test, CheckValue) {
+  const char check[] = "123456789";
+  EXPECT_EQ(0xCBF43926U, sparse_crc32(0, check, sizeof(check) - 1));
+  EXPECT_EQ(0U, sparse_crc32(0, check, 0));
+}
+
+TEST(SparseCrc32Test, LengthsAndAlignments) {
+  const std::vector<uint8_t> buf = random_buffer(4096 + 8, 1);
+
+  for (crc32_update_t update : implementations()) {
+    for (size_t align = 0; align < 8; align++) {
+      for (size_t size = 0; size <= 4096; size++) {
+        const uint8_t* p = buf.data() + align;
+        ASSERT_EQ(crc32_reference(0, p, size), crc32_with(update, 0, p, size))
+            << "align " << align << " size " << size;
+      }
+    }
+  }
+}
+
+TEST(SparseCrc32Test, EveryByteValueAtEveryLanePosition) {
+  std::vector<uint8_t> buf = random_buffer(24, 2);
+
+  for (crc32_update_t update : implementations()) {
+    for (size_t pos = 0; pos < buf.size(); pos++) {
+      const uint8_t saved = buf[pos];
+      for (int b = 0; b < 256; b++) {
+        buf[pos] = b;
+        ASSERT_EQ(crc32_reference(0, buf.data(), buf.size()),
+                  crc32_with(update, 0, buf.data(), buf.size()))
+            << "pos " << pos << " byte " << b;
+      }
+      buf[pos] = saved;
+    }
+  }
+}
+
+TEST(SparseCrc32Test, ChainedCalls) {
+  const std::vector<uint8_t> buf = random_buffer(1 << 16, 3);
+  const uint32_t whole = crc32_reference(0, buf.data(), buf.size());
+  std::mt19937 gen(4);
+
+  for (int run = 0; run < 64; run++) {
+    uint32_t crc = 0;
+    size_t offset = 0;
+    while (offset < buf.size()) {
+      size_t size = std::min<size_t>(gen() % 300, buf.size() - offset);
+      crc = sparse_crc32(crc, buf.data() + offset, size);
+      offset += size;
+    }
+    ASSERT_EQ(whole, crc) << "run " << run;
+  }
+}
+
+TEST(SparseCrc32Test, SelectedImplementation) {
+#if defined(__aarch64__)
+  const bool hw = getauxval(AT_HWCAP) & HWCAP_CRC32;
+  EXPECT_EQ(hw ? &crc32_armv8 : &crc32_slice8, crc32_update());
+#elif defined(__x86_64__) || defined(__i386__)
+  const bool hw =
+      __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+  EXPECT_EQ(hw ? &crc32_clmul : &crc32_slice8, crc32_update());
+#else
+  EXPECT_EQ(&crc32_slice8, crc32_update());
+#endif
+}